@@ -385,9 +385,6 @@ h_LightSource::h_LightSource( h_BlockType type, unsigned char light_level )
 	: h_Block( type, light_level )
 {}
 
-h_LightSource::~h_LightSource()
-{}
-
 unsigned char h_LightSource::LightLevel() const
 {
 	return h_Block::additional_data_;
@@ -407,9 +404,6 @@ h_Fire::h_Fire( unsigned char power )
 	, power_( power )
 {}
 
-h_Fire::~h_Fire()
-{}
-
 /*
 ----------------h_FailingBlock--------------
 */
@@ -59,6 +59,7 @@ public:
 	void DecreaseLiquidLevel( unsigned short l );
 
 	unsigned char x_, y_, z_, reserved_; // relative liquid block coordinates ( in chunk )
+	unsigned short list_index_; // index in chunk water list
 };
 
 class h_LightSource : public h_Block
@@ -67,8 +68,6 @@ class h_LightSource : public h_Block
 public:
 	h_LightSource( h_BlockType type, unsigned char light_level= H_MAX_FIRE_LIGHT );
 
-	virtual ~h_LightSource();
-
 	unsigned char LightLevel() const;
 	void SetLightLevel( unsigned char level );
 
@@ -79,7 +78,6 @@ class h_Fire : public h_LightSource
 {
 public:
 	h_Fire( unsigned char power= c_power_after_build_ );
-	virtual ~h_Fire() override;
 
 	static constexpr unsigned char c_max_power_= 128;
 	static constexpr unsigned char c_power_after_build_= 0;
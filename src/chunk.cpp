@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cstring>
+
 #include "chunk.hpp"
 #include "world.hpp"
 #include "math_lib/assert.hpp"
@@ -35,8 +38,13 @@ inline static bool InChunkBorders( int x, int y )
 
 h_Chunk::h_Chunk( h_World* world, int longitude, int latitude, const g_WorldGenerator* generator )
 	: world_(world)
+	, shared_blocks_( world->SharedBlocks() )
 	, longitude_(longitude), latitude_(latitude)
-	, need_update_light_(false)
+	, modification_generation_(1) // Generated chunk is not saved yet.
+	, saved_generation_(0)
+	, block_ids_() // Block ids and height map are updated in SetBlock, so they must be initialized before generation.
+	, unsettled_water_bits_()
+	, height_map_()
 {
 	GenChunk( generator );
 	PlantGrass();
@@ -44,23 +52,36 @@ h_Chunk::h_Chunk( h_World* world, int longitude, int latitude, const g_WorldGene
 	GenWaterBlocks();
 	ActivateGrass();
 	MakeLight();
+	WakeAllWater();
 }
 
 h_Chunk::h_Chunk( h_World* world, const HEXCHUNK_header& header, h_BinaryInputStream& stream )
 	: world_(world)
+	, shared_blocks_( world->SharedBlocks() )
 	, longitude_(header.longitude)
 	, latitude_ (header.latitude )
-	, need_update_light_(false)
+	, modification_generation_(0)
+	, block_ids_()
+	, unsettled_water_bits_()
+	, height_map_()
 {
-	GenChunkFromFile( stream );
+	const bool is_old_format=
+		!( std::memcmp( header.format_key, H_CHUNK_FORMAT_HEADER, sizeof(header.format_key) ) == 0 &&
+		header.version == H_CHUNK_FORMAT_VERSION );
+	if( is_old_format )
+		GenChunkFromFileV1( stream );
+	else
+		GenChunkFromFile( stream );
 	MakeLight();
+	// Settled state is not saved, so, simulate all water of loaded chunk at least once.
+	WakeAllWater();
+
+	// Loaded data is same, as in chunk loader.
+	saved_generation_= modification_generation_;
 }
 
 h_Chunk::~h_Chunk()
-{
-	for( h_LightSource* source : light_source_list_ )
-		delete source;
-}
+{}
 
 bool h_Chunk::IsEdgeChunk() const
 {
@@ -73,7 +94,11 @@ bool h_Chunk::IsEdgeChunk() const
 void h_Chunk::SaveBlock( h_BinaryOuptutStream& stream, const h_Block* block ) const
 {
 	stream << ((unsigned short)block->Type());
+	SaveBlockData( stream, block );
+}
 
+void h_Chunk::SaveBlockData( h_BinaryOuptutStream& stream, const h_Block* block ) const
+{
 	switch(block->Type())
 	{
 	case h_BlockType::Air:
@@ -129,8 +154,12 @@ h_Block* h_Chunk::LoadBlock( h_BinaryInputStream& stream, unsigned int block_add
 	unsigned short s_block_id;
 	//HACK. if block type basic integer type changed, this must be changed too
 	stream >> s_block_id;
-	h_BlockType block_id= (h_BlockType)s_block_id;
 
+	return LoadBlock( (h_BlockType)s_block_id, stream, block_addr );
+}
+
+h_Block* h_Chunk::LoadBlock( h_BlockType block_id, h_BinaryInputStream& stream, unsigned int block_addr )
+{
 	h_Block* block;
 
 	switch(block_id)
@@ -148,14 +177,12 @@ h_Block* h_Chunk::LoadBlock( h_BinaryInputStream& stream, unsigned int block_add
 
 	case h_BlockType::FireStone:
 		{
-			h_LightSource* light_source= new h_LightSource( h_BlockType::FireStone, H_MAX_FIRE_LIGHT );
-			light_source->x_= BlockAddrToX(block_addr);
-			light_source->y_= BlockAddrToY(block_addr);
-			light_source->z_= BlockAddrToZ(block_addr);
-
-			light_source_list_.push_back( light_source );
-
-			block= light_source;
+			block=
+				NewLightSource(
+					BlockAddrToX(block_addr),
+					BlockAddrToY(block_addr),
+					BlockAddrToZ(block_addr),
+					h_BlockType::FireStone );
 		}
 		break;
 
@@ -232,17 +259,12 @@ h_Block* h_Chunk::LoadBlock( h_BinaryInputStream& stream, unsigned int block_add
 			unsigned char power;
 			stream >> power;
 
-			h_Fire* fire= new h_Fire();
-
-			fire->x_= BlockAddrToX(block_addr);
-			fire->y_= BlockAddrToY(block_addr);
-			fire->z_= BlockAddrToZ(block_addr);
-			fire->power_= power;
-
-			fire_list_.push_back( fire );
-			light_source_list_.push_back( fire );
-
-			block= fire;
+			block=
+				NewFire(
+					BlockAddrToX(block_addr),
+					BlockAddrToY(block_addr),
+					BlockAddrToZ(block_addr),
+					power );
 		} break;
 
 	default:
@@ -292,19 +314,231 @@ void h_Chunk::GenChunk( const g_WorldGenerator* generator )
 	}//for x
 }
 
+/*
+Chunk data format (version 2):
+For each column - runs count (unsigned char), then runs: type (unsigned char), length (unsigned char).
+After columns - tables with data of stateful blocks, in order of block address:
+water levels, grass activity, fire power, nonstandard form blocks directions, failing blocks.
+Failing blocks table placed last, because failing block data have variable size.
+*/
+
+// Tables of stateful blocks data.
+enum class ChunkDataTable
+{
+	Water,
+	Grass,
+	Fire,
+	NonstandardForm,
+	FailingBlock,
+	NumTables,
+	None, // For blocks without data.
+};
+
+static ChunkDataTable GetBlockDataTable( h_BlockType type )
+{
+	switch(type)
+	{
+	case h_BlockType::Water:
+		return ChunkDataTable::Water;
+	case h_BlockType::Grass:
+		return ChunkDataTable::Grass;
+	case h_BlockType::Fire:
+		return ChunkDataTable::Fire;
+	case h_BlockType::BrickPlate:
+	case h_BlockType::BrickHalfblock:
+		return ChunkDataTable::NonstandardForm;
+	case h_BlockType::FailingBlock:
+		return ChunkDataTable::FailingBlock;
+	default:
+		return ChunkDataTable::None;
+	};
+}
+
+// Size of element of table. Table of failing blocks not included.
+static unsigned int GetDataTableElementSize( ChunkDataTable table )
+{
+	switch(table)
+	{
+	case ChunkDataTable::Water:
+		return sizeof(unsigned short);
+	case ChunkDataTable::Grass:
+		return sizeof(bool);
+	case ChunkDataTable::Fire:
+		return sizeof(unsigned char);
+	case ChunkDataTable::NonstandardForm:
+		return sizeof(unsigned char);
+	default:
+		H_ASSERT(false);
+		return 0;
+	};
+}
+
+// Table of blocks without state, which are shared between all chunks.
+// Such blocks loaded without per-block LoadBlock call.
+struct NormalBlocksTable
+{
+	bool is_normal[ size_t(h_BlockType::NumBlockTypes) ];
+
+	NormalBlocksTable()
+	{
+		for( unsigned int i= 0; i < (unsigned int)h_BlockType::NumBlockTypes; i++ )
+		{
+			const h_BlockType type= h_BlockType(i);
+			is_normal[i]= GetBlockDataTable( type ) == ChunkDataTable::None && type != h_BlockType::FireStone;
+		}
+	}
+};
+
+static const NormalBlocksTable g_normal_blocks_table;
+
 void h_Chunk::GenChunkFromFile( h_BinaryInputStream& stream )
 {
-	for( int i= 0; i< H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT; i++ )
+	const unsigned int c_table_count= (unsigned int)ChunkDataTable::NumTables;
+
+	// Column runs - pairs of type and length.
+	unsigned char runs[ H_CHUNK_HEIGHT * 2 ];
+
+	// First pass - count stateful blocks, for tables positions calculation.
+	unsigned int table_sizes[ c_table_count ]= { 0 };
+	h_BinaryInputStream tables_stream( stream );
+	for( unsigned int column= 0; column < H_CHUNK_WIDTH * H_CHUNK_WIDTH; column++ )
+	{
+		unsigned char run_count;
+		tables_stream >> run_count;
+		tables_stream.ReadArray( runs, run_count * 2u );
+		for( unsigned int r= 0; r < run_count; r++ )
+		{
+			ChunkDataTable table= GetBlockDataTable( (h_BlockType)runs[ r * 2u ] );
+			if( table != ChunkDataTable::None )
+				table_sizes[ (unsigned int)table ]+= runs[ r * 2u + 1u ];
+		}
+	}
+
+	h_BinaryInputStream water_stream( tables_stream );
+	h_BinaryInputStream grass_stream( water_stream );
+	grass_stream.Skip( table_sizes[ (unsigned int)ChunkDataTable::Water ] * GetDataTableElementSize( ChunkDataTable::Water ) );
+	h_BinaryInputStream fire_stream( grass_stream );
+	fire_stream.Skip( table_sizes[ (unsigned int)ChunkDataTable::Grass ] * GetDataTableElementSize( ChunkDataTable::Grass ) );
+	h_BinaryInputStream nonstandard_form_stream( fire_stream );
+	nonstandard_form_stream.Skip( table_sizes[ (unsigned int)ChunkDataTable::Fire ] * GetDataTableElementSize( ChunkDataTable::Fire ) );
+	h_BinaryInputStream failing_stream( nonstandard_form_stream );
+	failing_stream.Skip( table_sizes[ (unsigned int)ChunkDataTable::NonstandardForm ] * GetDataTableElementSize( ChunkDataTable::NonstandardForm ) );
+
+	h_BinaryInputStream* const tables_streams[ c_table_count ]=
+	{
+		&water_stream, &grass_stream, &fire_stream, &nonstandard_form_stream, &failing_stream,
+	};
+
+	water_block_list_.reserve( table_sizes[ (unsigned int)ChunkDataTable::Water ] );
+
+	// Second pass - fill blocks.
+	// Runs of normal blocks filled at once, only stateful blocks created one by one.
+	// Write blocks directly, modification generation is not needed for loading.
+	for( unsigned int column= 0; column < H_CHUNK_WIDTH * H_CHUNK_WIDTH; column++ )
+	{
+		const unsigned int column_end= ( column + 1 ) << H_CHUNK_HEIGHT_LOG2;
+		unsigned int addr= column << H_CHUNK_HEIGHT_LOG2;
+
+		unsigned char run_count;
+		stream >> run_count;
+		stream.ReadArray( runs, run_count * 2u );
+		for( unsigned int r= 0; r < run_count; r++ )
+		{
+			unsigned char type= runs[ r * 2u ];
+
+			// Protect from broken data.
+			const unsigned int run_end= std::min( addr + runs[ r * 2u + 1u ], column_end );
+			if( type >= (unsigned char)h_BlockType::NumBlockTypes )
+				type= (unsigned char)h_BlockType::Air;
+
+			const h_BlockType block_type= (h_BlockType)type;
+			if( g_normal_blocks_table.is_normal[ type ] )
+			{
+				H_ASSERT( world_->NormalBlock( block_type ) == shared_blocks_[ type ] );
+				std::fill( block_ids_ + addr, block_ids_ + run_end, (unsigned short)block_type );
+				std::memset( transparency_ + addr, shared_blocks_[ type ]->CombinedTransparency(), run_end - addr );
+				addr= run_end;
+			}
+			else
+			{
+				const ChunkDataTable table= GetBlockDataTable( block_type );
+				h_BinaryInputStream& block_data_stream= table == ChunkDataTable::None ? stream : *tables_streams[ (unsigned int)table ];
+				for( ; addr < run_end; addr++ )
+				{
+					h_Block* const block= LoadBlock( block_type, block_data_stream, addr );
+					WriteBlock( addr, block );
+					transparency_[addr]= block->CombinedTransparency();
+				}
+			}
+		}
+
+		H_ASSERT( addr == column_end );
+		if( addr < column_end )
+		{
+			std::fill( block_ids_ + addr, block_ids_ + column_end, (unsigned short)h_BlockType::Air );
+			std::memset( transparency_ + addr, world_->NormalBlock( h_BlockType::Air )->CombinedTransparency(), column_end - addr );
+		}
+	}
+}
+
+void h_Chunk::GenChunkFromFileV1( h_BinaryInputStream& stream )
+{
+	for( unsigned int addr= 0; addr < H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT; addr++ )
 	{
-		h_Block* block= LoadBlock( stream, i );
-		SetBlock( i, block );
+		unsigned short block_id;
+		stream >> block_id;
+
+		h_Block* const block=
+			block_id < (unsigned short)h_BlockType::NumBlockTypes && g_normal_blocks_table.is_normal[ block_id ]
+				? world_->NormalBlock( (h_BlockType)block_id )
+				: LoadBlock( (h_BlockType)block_id, stream, addr );
+
+		WriteBlock( addr, block );
+		transparency_[addr]= block->CombinedTransparency();
 	}
 }
 
 void h_Chunk::SaveChunkToFile( h_BinaryOuptutStream& stream ) const
 {
-	for( int i= 0; i< H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT; i++ )
-		SaveBlock( stream, blocks_[i] );
+	// Bit mask of nonempty data tables. Empty tables are skipped on second pass.
+	unsigned int used_tables= 0;
+
+	for( unsigned int column= 0; column < H_CHUNK_WIDTH * H_CHUNK_WIDTH; column++ )
+	{
+		const unsigned short* const column_block_ids= block_ids_ + ( column << H_CHUNK_HEIGHT_LOG2 );
+
+		// Build column in local buffer and write it at once.
+		// First byte - run count, next - pairs of type and length.
+		unsigned char column_data[ 1 + H_CHUNK_HEIGHT * 2 ];
+		unsigned int column_data_size= 1;
+		for( unsigned int z= 0; z < H_CHUNK_HEIGHT; )
+		{
+			const h_BlockType type= hBlockIdType( column_block_ids[z] );
+			unsigned int run_end= z + 1;
+			while( run_end < H_CHUNK_HEIGHT && hBlockIdType( column_block_ids[run_end] ) == type )
+				run_end++;
+
+			column_data[ column_data_size++ ]= (unsigned char)type;
+			column_data[ column_data_size++ ]= (unsigned char)( run_end - z );
+			used_tables|= 1u << (unsigned int)GetBlockDataTable( type );
+			z= run_end;
+		}
+		column_data[0]= (unsigned char)( ( column_data_size - 1 ) / 2 );
+
+		stream.WriteArray( column_data, column_data_size );
+	}
+
+	for( unsigned int table= 0; table < (unsigned int)ChunkDataTable::NumTables; table++ )
+	{
+		if( ( used_tables & ( 1u << table ) ) == 0 )
+			continue;
+
+		for( unsigned int i= 0; i< H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT; i++ )
+		{
+			if( GetBlockDataTable( hBlockIdType( block_ids_[i] ) ) == (ChunkDataTable)table )
+				SaveBlockData( stream, GetBlock(i) );
+		}
+	}
 }
 
 void h_Chunk::PlantTrees( const g_WorldGenerator* generator )
@@ -461,9 +695,9 @@ void h_Chunk::PlantGrass()
 		int addr= BlockAddr( x, y, 0 );
 
 		for( int z= H_CHUNK_HEIGHT - 2; z > 0; z-- )
-			if ( blocks_[ addr + z ]->Type() != h_BlockType::Air )
+			if ( GetBlockType( addr + z ) != h_BlockType::Air )
 			{
-				if( blocks_[ addr + z ]->Type() == h_BlockType::Soil )
+				if( GetBlockType( addr + z ) == h_BlockType::Soil )
 					SetBlock( addr + z, world_->UnactiveGrassBlock() );
 
 				break;
@@ -479,8 +713,8 @@ void h_Chunk::ActivateGrass()
 		int addr= BlockAddr( x, y, 0 );
 
 		for( int z= H_CHUNK_HEIGHT - 2; z > 0; z-- )
-			if ( blocks_[ addr + z ]->Type() == h_BlockType::Grass )
-				blocks_[ addr + z ]= NewActiveGrassBlock( x, y, z );
+			if ( GetBlockType( addr + z ) == h_BlockType::Grass )
+				WriteBlock( addr + z, NewActiveGrassBlock( x, y, z ) );
 	}
 }
 
@@ -488,7 +722,7 @@ unsigned int h_Chunk::CalculateWaterBlockCount()
 {
 	unsigned int c= 0;
 	for( unsigned int i= 0; i< H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT; i++ )
-		if( blocks_[i]->Type() == h_BlockType::Water )
+		if( GetBlockType(i) == h_BlockType::Water )
 			c++;
 	return c;
 }
@@ -500,97 +734,109 @@ void h_Chunk::GenWaterBlocks()
 	for( y= 0; y< H_CHUNK_WIDTH; y++ )
 	for( z= 0; z< H_CHUNK_HEIGHT; z++, addr++ )
 	{
-		if( blocks_[ addr ]->Type() == h_BlockType::Water )
+		if( GetBlockType( addr ) == h_BlockType::Water )
 		{
-			h_LiquidBlock* block= water_blocks_allocator_.New();
+			h_LiquidBlock* block= NewWaterBlock();
 			block->x_= x;
 			block->y_= y;
 			block->z_= z;
-			blocks_[ addr ]= block;
+			WriteBlock( addr, block );
 			block->SetLiquidLevel( H_MAX_WATER_LEVEL );
-			water_block_list_.push_back( block );
 		}
 	}
 }
 
 void h_Chunk::MakeLight()
 {
-	for( unsigned int x= 0; x< H_CHUNK_WIDTH; x++ )
-		for( unsigned int y= 0; y< H_CHUNK_WIDTH; y++ )
-		{
-			unsigned int addr= BlockAddr( x, y, H_CHUNK_HEIGHT-2 );
-			unsigned int z;
+	// Chunk data may be written directly, bypassing SetBlock, so rebuild height map here.
+	for( unsigned int column= 0; column < H_CHUNK_WIDTH * H_CHUNK_WIDTH; column++ )
+	{
+		const unsigned char* const column_transparency= transparency_ + ( column << H_CHUNK_HEIGHT_LOG2 );
 
-			for( z= H_CHUNK_HEIGHT-2; z> 0; z--, addr-- )
-			{
-				if( !( transparency_[ addr ] & H_DIRECT_SUN_LIGHT_TRANSPARENCY_BIT ) )
-					break;
-				sun_light_map_[ addr ]= H_MAX_SUN_LIGHT;
-				fire_light_map_[ addr ]= 0;
-			}
-			for( ; z > 0; z--, addr-- )
-			{
-				sun_light_map_[ addr ]= 0;
-				fire_light_map_[ addr ]= 0;
-			}
-		}
+		unsigned int z= H_CHUNK_HEIGHT - 2;
+		while( z > 0 && ( column_transparency[z] & H_DIRECT_SUN_LIGHT_TRANSPARENCY_BIT ) )
+			z--;
+		height_map_[ column ]= z;
+	}
+
+	// Whole light map is read in world lighting, including lowest and highest blocks.
+	std::memset( light_map_, 0, sizeof(light_map_) );
+	SunRelight();
 }
 
 void h_Chunk::SunRelight()
 {
-	for( unsigned int x= 0; x< H_CHUNK_WIDTH; x++ )
-		for( unsigned int y= 0; y< H_CHUNK_WIDTH; y++ )
-		{
-			unsigned int addr= BlockAddr( x, y, H_CHUNK_HEIGHT-2 );
-			unsigned int z;
+	for( unsigned int column= 0; column < H_CHUNK_WIDTH * H_CHUNK_WIDTH; column++ )
+	{
+		const unsigned int column_addr= column << H_CHUNK_HEIGHT_LOG2;
+		const unsigned int height= height_map_[ column ];
 
-			for( z= H_CHUNK_HEIGHT-2; z> 0; z--, addr-- )
-			{
-				if( !( transparency_[ addr ] & H_DIRECT_SUN_LIGHT_TRANSPARENCY_BIT ) )
-					break;
-				sun_light_map_[ addr ]= H_MAX_SUN_LIGHT;
-			}
-			for( ; z > 0; z--, addr-- )
-				sun_light_map_[ addr ]= 0;
-		}
+		SetSunLightLevelColumn( column_addr, 0, height + 1, 0 );
+		SetSunLightLevelColumn( column_addr, height + 1, H_CHUNK_HEIGHT - 1, H_MAX_SUN_LIGHT );
+		SetSunLightLevelColumn( column_addr, H_CHUNK_HEIGHT - 1, H_CHUNK_HEIGHT, 0 );
+	}
 }
 
 h_LiquidBlock* h_Chunk::NewWaterBlock()
 {
 	h_LiquidBlock* b= water_blocks_allocator_.New();
+	b->list_index_= (unsigned short)water_block_list_.size();
 	water_block_list_.push_back( b );
 	return b;
 }
 
 void h_Chunk::DeleteWaterBlock( h_LiquidBlock* b )
 {
-	// Do not remove block from list here.
-	//This must did outer code.
+	// Move last block of list into place of deleted block.
+	H_ASSERT( water_block_list_[ b->list_index_ ] == b );
+	h_LiquidBlock* const last_block= water_block_list_.back();
+	water_block_list_[ b->list_index_ ]= last_block;
+	last_block->list_index_= b->list_index_;
+	water_block_list_.pop_back();
 
 	water_blocks_allocator_.Delete(b);
 }
 
+void h_Chunk::WakeAllWater()
+{
+	unsettled_water_.reserve( water_block_list_.size() );
+	for( const h_LiquidBlock* const b : water_block_list_ )
+		WakeWater( BlockAddr( b->x_, b->y_, b->z_ ) );
+}
+
 h_LightSource* h_Chunk::NewLightSource( int x, int y, int z, h_BlockType type )
 {
-	h_LightSource* s= new h_LightSource( type );
-	light_source_list_.push_back(s);
+	h_LightSource* s= light_sources_allocator_.New( type );
+	light_source_list_.push_back( BlockAddr( x, y, z ) );
 	s->x_= x;
 	s->y_= y;
 	s->z_= z;
 	return s;
 }
 
-void h_Chunk::DeleteLightSource( h_LightSource* source )
+h_Fire* h_Chunk::NewFire( int x, int y, int z, unsigned char power )
+{
+	h_Fire* fire= fires_allocator_.New( power );
+	const unsigned short addr= BlockAddr( x, y, z );
+	light_source_list_.push_back( addr );
+	fire_list_.push_back( addr );
+	fire->x_= x;
+	fire->y_= y;
+	fire->z_= z;
+	return fire;
+}
+
+// Remove address from unordered list. Last address is moved into place of removed.
+static void RemoveAddress( std::vector<unsigned short>& list, const unsigned short addr )
 {
-	for( size_t i= 0; i < light_source_list_.size(); i++ )
+	for( size_t i= 0; i < list.size(); i++ )
 	{
-		if( light_source_list_[i] == source )
+		if( list[i] == addr )
 		{
-			delete source;
-			if( i + 1 < light_source_list_.size() )
-				light_source_list_[i]= light_source_list_.back();
+			if( i + 1 < list.size() )
+				list[i]= list.back();
 
-			light_source_list_.pop_back();
+			list.pop_back();
 			return;
 		}
 	}
@@ -598,6 +844,20 @@ void h_Chunk::DeleteLightSource( h_LightSource* source )
 	H_ASSERT( false );
 }
 
+void h_Chunk::DeleteLightSource( h_LightSource* source )
+{
+	const unsigned short addr= BlockAddr( source->x_, source->y_, source->z_ );
+	RemoveAddress( light_source_list_, addr );
+
+	if( source->Type() == h_BlockType::Fire )
+	{
+		RemoveAddress( fire_list_, addr );
+		fires_allocator_.Delete( static_cast<h_Fire*>(source) );
+	}
+	else
+		light_sources_allocator_.Delete( source );
+}
+
 void h_Chunk::DeleteLightSource( int x, int y, int z )
 {
 	DeleteLightSource( static_cast<h_LightSource*>( GetBlock( x, y, z ) ) );
@@ -643,7 +903,7 @@ void h_Chunk::ProcessFailingBlocks()
 			int global_x= b->GetX() + ( (longitude_ - world_->Longitude()) << H_CHUNK_WIDTH_LOG2 );
 			int global_y= b->GetY() + ( (latitude_  - world_->Latitude ()) << H_CHUNK_WIDTH_LOG2 );
 
-			h_Block* lower_block= blocks_[ block_addr + old_z - 1 ];
+			h_Block* lower_block= GetBlock( block_addr + old_z - 1 );
 			if( lower_block->Type() != h_BlockType::Air )
 			{
 				// failing blocks can fall to water.
@@ -694,9 +954,9 @@ unsigned int h_Chunk::GetWaterColumnHeight( int x, int y, int z )
 {
 	unsigned int h= (z-1) * H_MAX_WATER_LEVEL;
 	unsigned int addr= BlockAddr( x, y, z );
-	while(  blocks_[addr]->Type() == h_BlockType::Water )
+	while( GetBlockType( addr ) == h_BlockType::Water )
 	{
-		unsigned int level= ((h_LiquidBlock*)blocks_[addr])->LiquidLevel();
+		unsigned int level= ((h_LiquidBlock*)GetBlock( addr ))->LiquidLevel();
 		if( level > H_MAX_WATER_LEVEL )
 			level= H_MAX_WATER_LEVEL;
 		h+= level;
@@ -6,12 +6,24 @@
 #include "block.hpp"
 #include "world_loading.hpp"
 #include "math_lib/binary_stream.hpp"
-#include "math_lib/small_objects_allocator.hpp"
+#include "math_lib/short_key_hash_map.hpp"
+#include "math_lib/aligned_small_objects_allocator.hpp"
 
 #define BlockAddr( x, y, z ) ( (z) |\
 	( (y) << H_CHUNK_HEIGHT_LOG2 ) |\
 	( (x) << ( H_CHUNK_HEIGHT_LOG2 + H_CHUNK_WIDTH_LOG2 ) ) )
 
+// Block id of chunk cell - block type and flag of block with own state.
+// Objects of such blocks are stored in chunk, other blocks are shared, see h_World::SharedBlocks.
+#define H_BLOCK_STATE_BIT 0x8000u
+
+static_assert( (unsigned int)h_BlockType::NumBlockTypes < H_BLOCK_STATE_BIT, "Block type does not fit into block id" );
+
+inline h_BlockType hBlockIdType( const unsigned short block_id )
+{
+	return h_BlockType( block_id & ~H_BLOCK_STATE_BIT );
+}
+
 class h_Chunk
 {
 	friend class h_World;
@@ -30,14 +42,27 @@ public:
 	const h_Block* GetBlock( int x, int y, int z ) const;
 	h_Block* GetBlock( unsigned int addr );
 	const h_Block* GetBlock( unsigned int addr ) const;
-	const h_Block* const* GetBlocksData() const;
+	// Type of block. Faster, than GetBlock()->Type().
+	h_BlockType GetBlockType( int x, int y, int z ) const;
+	h_BlockType GetBlockType( unsigned int addr ) const;
+	// Block ids of cells. See hBlockIdType.
+	const unsigned short* GetBlockIdsData() const;
 
 	const std::vector<h_FailingBlock*>& GetFailingBlocks() const;
 
 	const std::vector< h_LiquidBlock* >& GetWaterList() const;
+	// Addresses of water blocks, which may flow in next water tick. Other water blocks are still.
+	const std::vector<unsigned short>& GetUnsettledWaterList() const;
 	const std::vector< h_NonstandardFormBlock* >& GetNonstandartFormBlocksList() const;
-	const std::vector< h_LightSource* >& GetLightSourceList() const;
-	const std::vector< h_Fire* >& GetFireList() const;
+	// Addresses of light source blocks ( fire stones and fires ) and fire blocks.
+	const std::vector<unsigned short>& GetLightSourceList() const;
+	const std::vector<unsigned short>& GetFireList() const;
+	// Block at address must be light source or fire.
+	const h_LightSource* GetLightSource( unsigned int addr ) const;
+	h_Fire* GetFire( unsigned int addr );
+	const h_Fire* GetFire( unsigned int addr ) const;
+	// Memory blocks of allocators of objects of blocks with state. Objects are allocated by blocks, not one by one.
+	size_t ObjectsAllocatorsBlockCount() const;
 
 
 	h_World* GetWorld();
@@ -54,21 +79,38 @@ public:
 	unsigned char SunLightLevel( unsigned int addr ) const;
 	unsigned char FireLightLevel( unsigned int addr ) const;
 
+	// z of highest block, opaque for direct sun light. All blocks above are lit by direct sun.
+	unsigned char HeightMapValue( int x, int y ) const;
+
 	// Get sun and fire light levels. out_lights[0]= sun, out_lights[1]= fire
 	void GetLightsLevel( int x, int y, int z, unsigned char* out_lights ) const;
+	// Get sun and fire light levels of cells with z in range [ z_begin; z_end ) at once.
+	void GetLightsLevelColumn( int x, int y, int z_begin, int z_end, unsigned char* out_sun_light, unsigned char* out_fire_light ) const;
 
-	const unsigned char* GetSunLightData () const;
-	const unsigned char* GetFireLightData() const;
+	// Packed light of cells. See hPackLight.
+	const unsigned char* GetLightData() const;
+
+	// Write chunk data in current format.
+	void SaveChunkToFile( h_BinaryOuptutStream& stream ) const;
+
+	// Generation increases on each change of chunk data, which is saved.
+	unsigned int ModificationGeneration() const;
+	// Returns true, if chunk was modified after loading or last saving.
+	bool IsModified() const;
 
 private:
+	// Block type and data.
 	void SaveBlock( h_BinaryOuptutStream& stream, const h_Block* block ) const;
+	// Block data only, without type.
+	void SaveBlockData( h_BinaryOuptutStream& stream, const h_Block* block ) const;
 	h_Block* LoadBlock( h_BinaryInputStream& stream, unsigned int block_addr );
+	h_Block* LoadBlock( h_BlockType block_id, h_BinaryInputStream& stream, unsigned int block_addr );
 
 	void GenChunk( const g_WorldGenerator* generator );
 
 	//chunk save\load
 	void GenChunkFromFile( h_BinaryInputStream& stream );
-	void SaveChunkToFile( h_BinaryOuptutStream& stream ) const;
+	void GenChunkFromFileV1( h_BinaryInputStream& stream );
 
 	void PlantTrees( const g_WorldGenerator* generator );
 	void PlantTree( int x, int y, int z );//local coordinates
@@ -79,12 +121,19 @@ private:
 	void GenWaterBlocks();
 	void MakeLight();
 	void SunRelight();
+	void UpdateHeightMap( unsigned int addr );
 
 //water management
 	h_LiquidBlock* NewWaterBlock();
+	// Removes block from water list and deletes it.
 	void DeleteWaterBlock( h_LiquidBlock* b );
+	// Add water block at address to list of unsettled water. Does nothing for other blocks.
+	void WakeWater( unsigned int addr );
+	void WakeAllWater();
 //lights management
 	h_LightSource* NewLightSource( int x, int y, int z, h_BlockType type );
+	h_Fire* NewFire( int x, int y, int z, unsigned char power= h_Fire::c_power_after_build_ );
+	// Removes source from lists. Fire is removed from fire list too.
 	void DeleteLightSource( h_LightSource* source );
 	void DeleteLightSource( int x, int y, int z );
 
@@ -99,47 +148,75 @@ private:
 	void SetSunLightLevel( int x, int y, int z, unsigned char l );
 	void SetFireLightLevel( int x, int y, int z, unsigned char l );
 
+	// Light of sun or fire channel. Used in lighting code, same for both channels.
+	unsigned char LightLevel( unsigned int addr, bool sun ) const;
+	void SetLightLevel( unsigned int addr, bool sun, unsigned char l );
+	// Set sun light of cells with z in range [ z_begin; z_end ), fire light is not changed.
+	void SetSunLightLevelColumn( unsigned int column_addr, unsigned int z_begin, unsigned int z_end, unsigned char l );
+
 	void SetBlock( int x, int y, int z, h_Block* b );
 	void SetBlock( unsigned int addr, h_Block* b );
+	// Put block into cell without updating of transparency, height map and modification generation.
+	void WriteBlock( unsigned int addr, h_Block* b );
+	h_Block* ResolveBlock( unsigned int addr ) const;
+
+	// Call it after modification of blocks, not using SetBlock.
+	void MarkModified();
 
 private:
 	h_World* const world_;
+	h_Block* const* const shared_blocks_;
 	const int longitude_;
 	const int latitude_ ;
 
-	bool need_update_light_;
+	// Addresses of blocks, where water appeared or disappeared. Sun light is not updated for them yet.
+	std::vector<unsigned short> water_light_updates_;
 
-	// TODO - select memory block size for allocatiors
+	unsigned int modification_generation_;
+	unsigned int saved_generation_; // Generation of data in chunk loader.
+
+	// Allocators blocks sizes are selected for typical count of objects of each kind in chunk.
 
 	// water management
-	SmallObjectsAllocator< h_LiquidBlock, 256, unsigned char > water_blocks_allocator_;
+	AlignedSmallObjectsAllocator< h_LiquidBlock, 4096 > water_blocks_allocator_;
 	std::vector< h_LiquidBlock* > water_block_list_;
+	// Water blocks, which must be simulated in next water tick. Blocks, which did nothing, are removed from here.
+	// Entries may be stale - block at address may be not water already.
+	std::vector<unsigned short> unsettled_water_;
 
 	// failing blocks management
-	SmallObjectsAllocator< h_FailingBlock, 32, unsigned char > failing_blocks_alocatior_;
+	AlignedSmallObjectsAllocator< h_FailingBlock, 1024 > failing_blocks_alocatior_;
 	std::vector<h_FailingBlock*> failing_blocks_;
 
-	SmallObjectsAllocator< h_NonstandardFormBlock, 32, unsigned char > nonstandard_form_blocks_allocator_;
+	AlignedSmallObjectsAllocator< h_NonstandardFormBlock, 512 > nonstandard_form_blocks_allocator_;
 	std::vector<h_NonstandardFormBlock*> nonstandard_form_blocks_;
 
 	// Active grass. Grass blocks, which can reproduce, placed here.
 	// If grass block has no free space around, it becomes "unactive".
 	// Unactive block is unique object, placed in h_World. See h_World::unactive_grass_block_.
-	SmallObjectsAllocator< h_GrassBlock, 64, unsigned char > active_grass_blocks_allocator_;
+	AlignedSmallObjectsAllocator< h_GrassBlock, 1024 > active_grass_blocks_allocator_;
 	std::vector<h_GrassBlock*> active_grass_blocks_;
 
 	//light management
-	std::vector< h_LightSource* > light_source_list_;
+	AlignedSmallObjectsAllocator< h_LightSource, 512 > light_sources_allocator_;
+	AlignedSmallObjectsAllocator< h_Fire, 1024 > fires_allocator_;
+	std::vector<unsigned short> light_source_list_;
+	std::vector<unsigned short> fire_list_;
 
-	std::vector< h_Fire* > fire_list_;
+	// Objects of blocks with own state ( water, active grass, fire, etc. ). Key - cell address.
+	ShortKeyHashMap<h_Block*> block_states_;
 
 	// Large arrays - put back.
-	h_Block* blocks_                     [ H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT ];
+	unsigned short block_ids_            [ H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT ];
 	h_CombinedTransparency transparency_ [ H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT ];
-	unsigned char sun_light_map_         [ H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT ];
-	unsigned char fire_light_map_        [ H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT ];
-
-	unsigned char height_map_    [ H_CHUNK_WIDTH * H_CHUNK_WIDTH ];//z coordinates of first nonair block
+	// Sun and fire light, packed together, so, both are fetched from same cache line.
+	unsigned char light_map_             [ H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT ];
+	// Bit per cell - is address in list of unsettled water.
+	uint32_t unsettled_water_bits_       [ H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT / 32 ];
+
+	// z coordinates of highest blocks, opaque for direct sun light, or 0, if column is fully transparent.
+	// Highest chunk block is ignored. Blocks above height map value are lit by direct sun.
+	unsigned char height_map_    [ H_CHUNK_WIDTH * H_CHUNK_WIDTH ];
 };
 
 inline unsigned char h_Chunk::Transparency( int x, int y, int z ) const
@@ -162,7 +239,7 @@ inline h_Block* h_Chunk::GetBlock( int x, int y, int z )
 	H_ASSERT( y >= 0 && y < H_CHUNK_WIDTH );
 	H_ASSERT( z >= 0 && z < H_CHUNK_HEIGHT );
 
-	return blocks_[ BlockAddr( x, y, z ) ];
+	return ResolveBlock( BlockAddr( x, y, z ) );
 }
 
 inline const h_Block* h_Chunk::GetBlock( int x, int y, int z ) const
@@ -171,24 +248,39 @@ inline const h_Block* h_Chunk::GetBlock( int x, int y, int z ) const
 	H_ASSERT( y >= 0 && y < H_CHUNK_WIDTH );
 	H_ASSERT( z >= 0 && z < H_CHUNK_HEIGHT );
 
-	return blocks_[ BlockAddr( x, y, z ) ];
+	return ResolveBlock( BlockAddr( x, y, z ) );
 }
 
 inline h_Block* h_Chunk::GetBlock( unsigned int addr )
 {
 	H_ASSERT( addr < H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT );
-	return blocks_[addr];
+	return ResolveBlock( addr );
 }
 
 inline const h_Block* h_Chunk::GetBlock( unsigned int addr ) const
 {
 	H_ASSERT( addr < H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT );
-	return blocks_[addr];
+	return ResolveBlock( addr );
 }
 
-inline const h_Block* const* h_Chunk::GetBlocksData() const
+inline h_BlockType h_Chunk::GetBlockType( int x, int y, int z ) const
 {
-	return blocks_;
+	H_ASSERT( x >= 0 && x < H_CHUNK_WIDTH );
+	H_ASSERT( y >= 0 && y < H_CHUNK_WIDTH );
+	H_ASSERT( z >= 0 && z < H_CHUNK_HEIGHT );
+
+	return hBlockIdType( block_ids_[ BlockAddr( x, y, z ) ] );
+}
+
+inline h_BlockType h_Chunk::GetBlockType( unsigned int addr ) const
+{
+	H_ASSERT( addr < H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT );
+	return hBlockIdType( block_ids_[addr] );
+}
+
+inline const unsigned short* h_Chunk::GetBlockIdsData() const
+{
+	return block_ids_;
 }
 
 inline const std::vector<h_FailingBlock*>& h_Chunk::GetFailingBlocks() const
@@ -201,21 +293,58 @@ inline const std::vector< h_LiquidBlock* >& h_Chunk::GetWaterList() const
 	return water_block_list_;
 }
 
+inline const std::vector<unsigned short>& h_Chunk::GetUnsettledWaterList() const
+{
+	return unsettled_water_;
+}
+
 inline const std::vector< h_NonstandardFormBlock* >& h_Chunk::GetNonstandartFormBlocksList() const
 {
 	return nonstandard_form_blocks_;
 }
 
-inline const std::vector<h_LightSource*>& h_Chunk::GetLightSourceList() const
+inline const std::vector<unsigned short>& h_Chunk::GetLightSourceList() const
 {
 	return light_source_list_;
 }
 
-inline const std::vector< h_Fire* >& h_Chunk::GetFireList() const
+inline const std::vector<unsigned short>& h_Chunk::GetFireList() const
 {
 	return fire_list_;
 }
 
+inline const h_LightSource* h_Chunk::GetLightSource( const unsigned int addr ) const
+{
+	const h_Block* const block= GetBlock( addr );
+	H_ASSERT( block->Type() == h_BlockType::FireStone || block->Type() == h_BlockType::Fire );
+	return static_cast<const h_LightSource*>( block );
+}
+
+inline h_Fire* h_Chunk::GetFire( const unsigned int addr )
+{
+	h_Block* const block= GetBlock( addr );
+	H_ASSERT( block->Type() == h_BlockType::Fire );
+	return static_cast<h_Fire*>( block );
+}
+
+inline const h_Fire* h_Chunk::GetFire( const unsigned int addr ) const
+{
+	const h_Block* const block= GetBlock( addr );
+	H_ASSERT( block->Type() == h_BlockType::Fire );
+	return static_cast<const h_Fire*>( block );
+}
+
+inline size_t h_Chunk::ObjectsAllocatorsBlockCount() const
+{
+	return
+		water_blocks_allocator_.BlockCount() +
+		failing_blocks_alocatior_.BlockCount() +
+		nonstandard_form_blocks_allocator_.BlockCount() +
+		active_grass_blocks_allocator_.BlockCount() +
+		light_sources_allocator_.BlockCount() +
+		fires_allocator_.BlockCount();
+}
+
 inline const h_World* h_Chunk::GetWorld() const
 {
 	return world_;
@@ -242,7 +371,7 @@ inline unsigned char h_Chunk::SunLightLevel( int x, int y, int z ) const
 	H_ASSERT( y >= 0 && y < H_CHUNK_WIDTH );
 	H_ASSERT( z >= 0 && z < H_CHUNK_HEIGHT );
 
-	return sun_light_map_[ BlockAddr( x, y, z ) ];
+	return hPackedSunLight( light_map_[ BlockAddr( x, y, z ) ] );
 }
 
 inline unsigned char h_Chunk::FireLightLevel( int x, int y, int z ) const
@@ -251,21 +380,29 @@ inline unsigned char h_Chunk::FireLightLevel( int x, int y, int z ) const
 	H_ASSERT( y >= 0 && y < H_CHUNK_WIDTH );
 	H_ASSERT( z >= 0 && z < H_CHUNK_HEIGHT );
 
-	return fire_light_map_[ BlockAddr( x, y, z ) ];
+	return hPackedFireLight( light_map_[ BlockAddr( x, y, z ) ] );
 }
 
 inline unsigned char h_Chunk::SunLightLevel( unsigned int addr ) const
 {
 	H_ASSERT( addr < H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT );
 
-	return sun_light_map_[ addr ];
+	return hPackedSunLight( light_map_[ addr ] );
 }
 
 inline unsigned char h_Chunk::FireLightLevel( unsigned int addr ) const
 {
 	H_ASSERT( addr < H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT );
 
-	return fire_light_map_[ addr ];
+	return hPackedFireLight( light_map_[ addr ] );
+}
+
+inline unsigned char h_Chunk::HeightMapValue( int x, int y ) const
+{
+	H_ASSERT( x >= 0 && x < H_CHUNK_WIDTH );
+	H_ASSERT( y >= 0 && y < H_CHUNK_WIDTH );
+
+	return height_map_[ y | ( x << H_CHUNK_WIDTH_LOG2 ) ];
 }
 
 inline void h_Chunk::GetLightsLevel( int x, int y, int z, unsigned char* out_lights ) const
@@ -274,19 +411,28 @@ inline void h_Chunk::GetLightsLevel( int x, int y, int z, unsigned char* out_lig
 	H_ASSERT( y >= 0 && y < H_CHUNK_WIDTH );
 	H_ASSERT( z >= 0 && z < H_CHUNK_HEIGHT );
 
-	int addr= BlockAddr( x, y, z );
-	out_lights[0]= sun_light_map_ [addr];
-	out_lights[1]= fire_light_map_[addr];
+	const unsigned char light= light_map_[ BlockAddr( x, y, z ) ];
+	out_lights[0]= hPackedSunLight ( light );
+	out_lights[1]= hPackedFireLight( light );
 }
 
-inline const unsigned char* h_Chunk::GetSunLightData() const
+inline void h_Chunk::GetLightsLevelColumn( int x, int y, int z_begin, int z_end, unsigned char* out_sun_light, unsigned char* out_fire_light ) const
 {
-	return sun_light_map_;
+	H_ASSERT( x >= 0 && x < H_CHUNK_WIDTH );
+	H_ASSERT( y >= 0 && y < H_CHUNK_WIDTH );
+	H_ASSERT( z_begin >= 0 && z_begin <= z_end && z_end <= H_CHUNK_HEIGHT );
+
+	const unsigned char* const column_light= light_map_ + BlockAddr( x, y, 0 );
+	for( int z= z_begin; z < z_end; z++ )
+	{
+		out_sun_light [ z - z_begin ]= hPackedSunLight ( column_light[z] );
+		out_fire_light[ z - z_begin ]= hPackedFireLight( column_light[z] );
+	}
 }
 
-inline const unsigned char* h_Chunk::GetFireLightData() const
+inline const unsigned char* h_Chunk::GetLightData() const
 {
-	return fire_light_map_;
+	return light_map_;
 }
 
 inline void h_Chunk::SetSunLightLevel( int x, int y, int z, unsigned char l )
@@ -295,7 +441,8 @@ inline void h_Chunk::SetSunLightLevel( int x, int y, int z, unsigned char l )
 	H_ASSERT( y >= 0 && y < H_CHUNK_WIDTH );
 	H_ASSERT( z >= 0 && z < H_CHUNK_HEIGHT );
 
-	sun_light_map_[ BlockAddr( x, y, z ) ]= l;
+	unsigned char& light= light_map_[ BlockAddr( x, y, z ) ];
+	light= hPackLight( l, hPackedFireLight( light ) );
 }
 
 inline void h_Chunk::SetFireLightLevel( int x, int y, int z, unsigned char l )
@@ -304,7 +451,34 @@ inline void h_Chunk::SetFireLightLevel( int x, int y, int z, unsigned char l )
 	H_ASSERT( y >= 0 && y < H_CHUNK_WIDTH );
 	H_ASSERT( z >= 0 && z < H_CHUNK_HEIGHT );
 
-	fire_light_map_[ BlockAddr( x, y, z ) ]= l;
+	unsigned char& light= light_map_[ BlockAddr( x, y, z ) ];
+	light= hPackLight( hPackedSunLight( light ), l );
+}
+
+inline unsigned char h_Chunk::LightLevel( unsigned int addr, bool sun ) const
+{
+	H_ASSERT( addr < H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT );
+
+	return ( light_map_[ addr ] >> ( sun ? 0 : H_LIGHT_BITS ) ) & H_LIGHT_MASK;
+}
+
+inline void h_Chunk::SetLightLevel( unsigned int addr, bool sun, unsigned char l )
+{
+	H_ASSERT( addr < H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT );
+	H_ASSERT( l <= H_LIGHT_MASK );
+
+	const unsigned int shift= sun ? 0 : H_LIGHT_BITS;
+	light_map_[ addr ]= (unsigned char)( ( light_map_[ addr ] & ~( H_LIGHT_MASK << shift ) ) | ( l << shift ) );
+}
+
+inline void h_Chunk::SetSunLightLevelColumn( unsigned int column_addr, unsigned int z_begin, unsigned int z_end, unsigned char l )
+{
+	H_ASSERT( ( column_addr & ( H_CHUNK_HEIGHT - 1 ) ) == 0 );
+	H_ASSERT( z_begin <= z_end && z_end <= H_CHUNK_HEIGHT );
+
+	unsigned char* const column_light= light_map_ + column_addr;
+	for( unsigned int z= z_begin; z < z_end; z++ )
+		column_light[z]= hPackLight( l, hPackedFireLight( column_light[z] ) );
 }
 
 inline void h_Chunk::SetBlock( int x, int y, int z, h_Block* b )
@@ -316,7 +490,9 @@ inline void h_Chunk::SetBlock( int x, int y, int z, h_Block* b )
 	const int addr= BlockAddr( x, y, z );
 
 	transparency_[addr]= b->CombinedTransparency();
-	blocks_[addr]= b;
+	WriteBlock( addr, b );
+	UpdateHeightMap( addr );
+	modification_generation_++;
 }
 
 inline void h_Chunk::SetBlock( unsigned int addr, h_Block* b )
@@ -324,5 +500,90 @@ inline void h_Chunk::SetBlock( unsigned int addr, h_Block* b )
 	H_ASSERT( addr < H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT );
 
 	transparency_[addr]= b->CombinedTransparency();
-	blocks_[addr]= b;
+	WriteBlock( addr, b );
+	UpdateHeightMap( addr );
+	modification_generation_++;
+}
+
+inline void h_Chunk::WriteBlock( unsigned int addr, h_Block* b )
+{
+	H_ASSERT( addr < H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT );
+
+	const unsigned short type= (unsigned short)b->Type();
+	if( b == shared_blocks_[ type ] )
+	{
+		if( block_ids_[addr] & H_BLOCK_STATE_BIT )
+			block_states_.erase( (unsigned short)addr );
+		block_ids_[addr]= type;
+	}
+	else
+	{
+		block_states_.insert( (unsigned short)addr, b );
+		block_ids_[addr]= (unsigned short)( type | H_BLOCK_STATE_BIT );
+	}
+}
+
+inline h_Block* h_Chunk::ResolveBlock( unsigned int addr ) const
+{
+	const unsigned short block_id= block_ids_[addr];
+	if( ( block_id & H_BLOCK_STATE_BIT ) == 0 )
+		return shared_blocks_[ block_id ];
+
+	h_Block* const* const block= block_states_.find( (unsigned short)addr );
+	H_ASSERT( block != nullptr );
+	return *block;
+}
+
+inline void h_Chunk::WakeWater( const unsigned int addr )
+{
+	H_ASSERT( addr < H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT );
+
+	if( hBlockIdType( block_ids_[addr] ) != h_BlockType::Water )
+		return;
+
+	uint32_t& bits= unsettled_water_bits_[ addr >> 5 ];
+	const uint32_t bit= 1u << ( addr & 31u );
+	if( ( bits & bit ) == 0 )
+	{
+		bits|= bit;
+		unsettled_water_.push_back( (unsigned short)addr );
+	}
+}
+
+inline void h_Chunk::UpdateHeightMap( unsigned int addr )
+{
+	const unsigned int z= addr & ( H_CHUNK_HEIGHT - 1 );
+	if( z == H_CHUNK_HEIGHT - 1 )
+		return;
+
+	unsigned char& height= height_map_[ addr >> H_CHUNK_HEIGHT_LOG2 ];
+	if( !( transparency_[ addr ] & H_DIRECT_SUN_LIGHT_TRANSPARENCY_BIT ) )
+	{
+		if( z > height )
+			height= z;
+	}
+	else if( z == height && z > 0 )
+	{
+		// Highest opaque block removed - search next one below.
+		const h_CombinedTransparency* const column_transparency= transparency_ + ( addr - z );
+		unsigned int new_height= z - 1;
+		while( new_height > 0 && ( column_transparency[ new_height ] & H_DIRECT_SUN_LIGHT_TRANSPARENCY_BIT ) )
+			new_height--;
+		height= new_height;
+	}
+}
+
+inline void h_Chunk::MarkModified()
+{
+	modification_generation_++;
+}
+
+inline unsigned int h_Chunk::ModificationGeneration() const
+{
+	return modification_generation_;
+}
+
+inline bool h_Chunk::IsModified() const
+{
+	return modification_generation_ != saved_generation_;
 }
@@ -0,0 +1,184 @@
+#include <cstring>
+
+#include <zlib.h>
+
+#include "chunk_compression.hpp"
+#include "console.hpp"
+#include "lz_compression.hpp"
+#include "math_lib/assert.hpp"
+
+static const unsigned int g_codec_shift= 24;
+static const uint32_t g_max_uncompressed_size= ( 1u << g_codec_shift ) - 1u;
+
+static const char* const g_codec_names[ size_t(h_ChunkCodec::NumCodecs) ]=
+{
+	"zlib",
+	"zlib_fast",
+	"zlib_best",
+	"lz",
+	"stored",
+};
+
+h_ChunkCodec hChunkCodecFromName( const char* const name, const h_ChunkCodec default_codec )
+{
+	for( unsigned int i= 0; i < (unsigned int)h_ChunkCodec::NumCodecs; i++ )
+		if( std::strcmp( name, g_codec_names[i] ) == 0 )
+			return h_ChunkCodec(i);
+
+	return default_codec;
+}
+
+const char* hChunkCodecName( const h_ChunkCodec codec )
+{
+	return g_codec_names[ size_t(codec) ];
+}
+
+static int GetZlibLevel( const h_ChunkCodec codec )
+{
+	switch( codec )
+	{
+	case h_ChunkCodec::ZlibFast: return Z_BEST_SPEED;
+	case h_ChunkCodec::ZlibBest: return Z_BEST_COMPRESSION;
+	default: return Z_DEFAULT_COMPRESSION;
+	};
+}
+
+bool hCompressChunkData(
+	const h_BinaryStorage& data,
+	const h_ChunkCodec codec,
+	h_BinaryStorage& out_data_compressed )
+{
+	out_data_compressed.clear();
+
+	if( data.size() > g_max_uncompressed_size )
+	{
+		h_Console::Error( "Can not compress - chunk data is too large" );
+		return false;
+	}
+
+	unsigned int result_size;
+	switch( codec )
+	{
+	case h_ChunkCodec::Zlib:
+	case h_ChunkCodec::ZlibFast:
+	case h_ChunkCodec::ZlibBest:
+		{
+			const int compress_bound= ::compressBound( data.size() );
+			out_data_compressed.resize( sizeof(uint32_t) + compress_bound );
+			uLongf zlib_result_size= compress_bound;
+			const int compress_code=
+				::compress2(
+					out_data_compressed.data() + sizeof(uint32_t), &zlib_result_size,
+					data.data(), data.size(),
+					GetZlibLevel( codec ) );
+			if( compress_code != Z_OK )
+			{
+				out_data_compressed.clear();
+				h_Console::Error( "Can not compress, code: ", compress_code );
+				return false;
+			}
+			result_size= zlib_result_size;
+		}
+		break;
+
+	case h_ChunkCodec::Lz:
+		out_data_compressed.resize( sizeof(uint32_t) + hLzCompressBound( data.size() ) );
+		result_size= hLzCompress( data.data(), data.size(), out_data_compressed.data() + sizeof(uint32_t) );
+		break;
+
+	case h_ChunkCodec::Stored:
+		out_data_compressed.resize( sizeof(uint32_t) + data.size() );
+		std::memcpy( out_data_compressed.data() + sizeof(uint32_t), data.data(), data.size() );
+		result_size= data.size();
+		break;
+
+	default:
+		H_ASSERT(false);
+		return false;
+	};
+
+	out_data_compressed.resize( sizeof(uint32_t) + result_size );
+
+	const uint32_t header= static_cast<uint32_t>(data.size()) | ( uint32_t(codec) << g_codec_shift );
+	std::memcpy( out_data_compressed.data(), &header, sizeof(uint32_t) );
+
+	return true;
+}
+
+bool hDecompressChunkData(
+	const unsigned char* const data_compressed,
+	const unsigned int data_compressed_size,
+	h_BinaryStorage& out_data_decompressed )
+{
+	out_data_decompressed.clear();
+
+	if( data_compressed_size < sizeof(uint32_t) )
+	{
+		h_Console::Error( "Can not uncompress - bad size" );
+		return false;
+	}
+
+	uint32_t header;
+	std::memcpy( &header, data_compressed, sizeof(uint32_t) );
+
+	const uint32_t uncompressed_size= header & g_max_uncompressed_size;
+	const h_ChunkCodec codec= h_ChunkCodec( header >> g_codec_shift );
+
+	const unsigned char* const src= data_compressed + sizeof(uint32_t);
+	const unsigned int src_size= data_compressed_size - sizeof(uint32_t);
+
+	out_data_decompressed.resize( uncompressed_size );
+
+	switch( codec )
+	{
+	case h_ChunkCodec::Zlib:
+	case h_ChunkCodec::ZlibFast:
+	case h_ChunkCodec::ZlibBest:
+		{
+			uLongf uncompressed_size_returned= uncompressed_size;
+			const int uncompress_code=
+				::uncompress(
+					out_data_decompressed.data(), &uncompressed_size_returned,
+					src, src_size );
+			if( uncompress_code != Z_OK )
+			{
+				out_data_decompressed.clear();
+				h_Console::Error( "Can not uncompress, code: ", uncompress_code );
+				return false;
+			}
+			if( uncompressed_size_returned != uncompressed_size )
+			{
+				out_data_decompressed.clear();
+				h_Console::Error( "Can not uncompress - bad size" );
+				return false;
+			}
+		}
+		break;
+
+	case h_ChunkCodec::Lz:
+		if( !hLzDecompress( src, src_size, out_data_decompressed.data(), uncompressed_size ) )
+		{
+			out_data_decompressed.clear();
+			h_Console::Error( "Can not uncompress - bad lz data" );
+			return false;
+		}
+		break;
+
+	case h_ChunkCodec::Stored:
+		if( src_size != uncompressed_size )
+		{
+			out_data_decompressed.clear();
+			h_Console::Error( "Can not uncompress - bad size" );
+			return false;
+		}
+		std::memcpy( out_data_decompressed.data(), src, src_size );
+		break;
+
+	default:
+		out_data_decompressed.clear();
+		h_Console::Error( "Can not uncompress - unknown codec ", int(codec) );
+		return false;
+	};
+
+	return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "math_lib/binary_stream.hpp"
+
+// Codec of compressed chunk data.
+// Value stored in compressed data header, so, do not change existing values.
+enum class h_ChunkCodec : unsigned char
+{
+	Zlib= 0, // zlib with default level. Legacy chunks have this codec.
+	ZlibFast,
+	ZlibBest,
+	Lz, // Fast in-tree LZ codec.
+	Stored, // Without compression.
+	NumCodecs,
+};
+
+// Returns codec for name from settings, or "default_codec" for unknown name.
+h_ChunkCodec hChunkCodecFromName( const char* name, h_ChunkCodec default_codec );
+const char* hChunkCodecName( h_ChunkCodec codec );
+
+/*
+Compressed chunk data layout:
+uint32_t header - low 24 bits - uncompressed size, high 8 bits - codec.
+Codec data.
+*/
+
+// Returns true, if all is ok.
+// Replaces "out_data_compressed" content on success.
+// Clears "out_data_compressed" on failure.
+bool hCompressChunkData(
+	const h_BinaryStorage& data,
+	h_ChunkCodec codec,
+	h_BinaryStorage& out_data_compressed );
+
+// Returns true, if all is ok.
+// Codec detected automatically.
+// Replaces "out_data_decompressed" content on success.
+// Clears "out_data_decompressed" on failure.
+bool hDecompressChunkData(
+	const unsigned char* data_compressed,
+	unsigned int data_compressed_size,
+	h_BinaryStorage& out_data_decompressed );
@@ -1,10 +1,27 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <zlib.h>
+
 #include "chunk_loader.hpp"
+#include "mapped_file.hpp"
 #include "world_loading.hpp"
 #include "console.hpp"
 
 #include "math_lib/assert.hpp"
 #include "math_lib/math.hpp"
 
+static const unsigned int g_chunks_in_region= H_WORLD_REGION_SIZE_X * H_WORLD_REGION_SIZE_Y;
+static const unsigned int g_region_header_size= HEXREGION_header::c_serialized_size;
+// Each lump starts with checksum of chunk data.
+static const unsigned int g_lump_checksum_size= sizeof(uint32_t);
+
+static uint32_t CalculateChecksum( const unsigned char* const data, const unsigned int size )
+{
+	return static_cast<uint32_t>( ::crc32( 0, data, size ) );
+}
+
 static int GetChunkIndexInRegion( int longitude, int latitude )
 {
 	int rel_lon= m_Math::ModNonNegativeRemainder( longitude, H_WORLD_REGION_SIZE_X );
@@ -12,6 +29,17 @@ static int GetChunkIndexInRegion( int longitude, int latitude )
 	return rel_lon + rel_lat * H_WORLD_REGION_SIZE_X;
 }
 
+static uint64_t GetRegionKey( const int region_longitude, const int region_latitude )
+{
+	return ( uint64_t( uint32_t(region_longitude) ) << 32u ) | uint64_t( uint32_t(region_latitude) );
+}
+
+// Offset of lump in region file.
+static unsigned int GetLumpOffsetInFile( unsigned int index )
+{
+	return g_region_header_size - ( g_chunks_in_region - index ) * 2 * sizeof(int);
+}
+
 //struct for loaded region data. chunks are compressed
 struct h_ChunkLoader::RegionData final
 {
@@ -19,18 +47,46 @@ struct h_ChunkLoader::RegionData final
 	const int latitude ;
 
 	unsigned int chunks_used;
-	bool chunks_used_flags[ H_WORLD_REGION_SIZE_X * H_WORLD_REGION_SIZE_Y ];
+	bool chunks_used_flags[ g_chunks_in_region ];
+	// Number of pinned chunks data. Old file mappings are released only when nothing is pinned.
+	unsigned int pins;
+	// Value of regions use counter, when last chunk of region was freed.
+	uint64_t last_use;
+
+	// Null, if region file does not exist yet.
+	std::unique_ptr<h_MappedFile> file;
+
+	// Copy of header in file. Lumps here and in file must be same.
+	HEXREGION_header header;
 
-	//data of each chunk in region ( each chunk stored separatly ). Data is compressed
-	h_BinaryStorage chunk_data[ H_WORLD_REGION_SIZE_X * H_WORLD_REGION_SIZE_Y ];
+	// Holes between chunks data. Sorted by offset, not adjacent.
+	std::vector<FileLump> free_lumps;
+	// Space of replaced chunks data. Header on disk can still reference it, so, it becomes free only after flush.
+	std::vector<FileLump> pending_free_lumps;
+	// End of chunks data, relative to header end.
+	unsigned int data_end;
+
+	bool need_flush;
 
 	RegionData( int in_longitude, int in_latitude )
 		: longitude(in_longitude)
 		, latitude (in_latitude )
 		, chunks_used(0)
+		, pins(0)
+		, last_use(0)
+		, data_end(0)
+		, need_flush(false)
 	{
 		for( bool& flag : chunks_used_flags )
 			flag= false;
+
+		std::memcpy( header.format_key, H_REGION_FORMAT_HEADER, sizeof(header.format_key) );
+		header.version= H_REGION_FORMAT_VERSION;
+		header.datalen= 0;
+		header.longitude= longitude;
+		header.latitude = latitude ;
+		for( FileLump& lump : header.chunk_lumps )
+			lump.offset= lump.size= 0;
 	}
 };
 
@@ -40,10 +96,21 @@ h_ChunkLoader::h_ChunkLoader( std::string world_directory )
 
 h_ChunkLoader::~h_ChunkLoader()
 {
-	H_ASSERT( regions_.empty() && "All chunks must be released before ChunkLoader destruction" );
+	// Only cached regions remain here.
+	for( const auto& region : regions_ )
+	{
+		H_ASSERT( region.second->chunks_used == 0 && "All chunks must be released before ChunkLoader destruction" );
+		FlushRegion( *region.second );
+	}
 }
 
-h_BinaryStorage& h_ChunkLoader::GetChunkData( int longitude, int latitude )
+void h_ChunkLoader::SetRegionsCacheSize( const size_t size )
+{
+	regions_cache_size_= size;
+	TrimRegionsCache();
+}
+
+h_ChunkLoader::ChunkData h_ChunkLoader::GetChunkData( int longitude, int latitude )
 {
 	RegionData& reg= GetRegionForCoordinates( longitude, latitude );
 	int ind= GetChunkIndexInRegion( longitude, latitude );
@@ -53,7 +120,94 @@ h_BinaryStorage& h_ChunkLoader::GetChunkData( int longitude, int latitude )
 		reg.chunks_used_flags[ind]= true;
 		reg.chunks_used++;
 	}
-	return reg.chunk_data[ind];
+
+	ChunkData result;
+	result.data= nullptr;
+	result.size= 0;
+
+	const FileLump& lump= reg.header.chunk_lumps[ind];
+	if( lump.size == 0 )
+		return result;
+
+	const unsigned char* const lump_data= reg.file->Data() + g_region_header_size + lump.offset;
+	uint32_t checksum;
+	std::memcpy( &checksum, lump_data, sizeof(uint32_t) );
+
+	const unsigned char* const chunk_data= lump_data + g_lump_checksum_size;
+	const unsigned int chunk_data_size= lump.size - g_lump_checksum_size;
+	if( CalculateChecksum( chunk_data, chunk_data_size ) != checksum )
+	{
+		h_Console::Warning( "Chunk ", longitude, " ", latitude, " data is corrupted. Chunk will be regenerated." );
+		return result;
+	}
+
+	result.data= chunk_data;
+	result.size= chunk_data_size;
+	return result;
+}
+
+h_ChunkLoader::ChunkData h_ChunkLoader::GetPinnedChunkData( const int longitude, const int latitude )
+{
+	const ChunkData result= GetChunkData( longitude, latitude );
+	GetRegionForCoordinates( longitude, latitude ).pins++;
+	return result;
+}
+
+void h_ChunkLoader::UnpinChunkData( const int longitude, const int latitude )
+{
+	RegionData& reg= GetRegionForCoordinates( longitude, latitude );
+	H_ASSERT( reg.pins > 0 );
+	reg.pins--;
+
+	if( reg.pins == 0 && reg.file )
+		reg.file->ReleaseOldMappings();
+}
+
+bool h_ChunkLoader::SetChunkData( int longitude, int latitude, const unsigned char* data, unsigned int size )
+{
+	RegionData& reg= GetRegionForCoordinates( longitude, latitude );
+	int ind= GetChunkIndexInRegion( longitude, latitude );
+
+	if( !CreateRegionFile( reg ) )
+		return false;
+
+	// Never overwrite data of saved chunk. Header on disk must reference valid data at any moment,
+	// so, write new data into free space and only after it update lump.
+	FileLump new_lump;
+	new_lump.offset= new_lump.size= 0;
+	if( size > 0 )
+	{
+		const unsigned int lump_size= g_lump_checksum_size + size;
+		const unsigned int offset= AllocateLump( reg, lump_size );
+		const uint32_t checksum= CalculateChecksum( data, size );
+
+		if( !reg.file->Write( g_region_header_size + offset, &checksum, sizeof(uint32_t) ) ||
+			!reg.file->Write( g_region_header_size + offset + g_lump_checksum_size, data, size ) )
+		{
+			h_Console::Error( "Can not write chunk ", longitude, " ", latitude, " data" );
+			FreeLump( reg, offset, lump_size );
+			return false;
+		}
+
+		new_lump.offset= offset;
+		new_lump.size= lump_size;
+	}
+
+	FileLump& lump= reg.header.chunk_lumps[ind];
+	if( lump.size > 0 )
+		reg.pending_free_lumps.push_back( lump );
+
+	// Lumps table is written on flush, after data.
+	lump= new_lump;
+	reg.need_flush= true;
+
+	if( reg.pins == 0 )
+		reg.file->ReleaseOldMappings();
+
+	return true;
+
+	if( flush_each_write_ )
+		FlushRegion( reg );
 }
 
 void h_ChunkLoader::FreeChunkData( int longitude, int latitude )
@@ -69,18 +223,36 @@ void h_ChunkLoader::FreeChunkData( int longitude, int latitude )
 
 	if( reg.chunks_used == 0 )
 	{
-		//free region here
-		for( RegionDataPtr& region : regions_ )
+		// Keep region in cache. Region data is flushed, when region is evicted.
+		reg.last_use= ++regions_use_counter_;
+		TrimRegionsCache();
+	}
+}
+
+void h_ChunkLoader::TrimRegionsCache()
+{
+	size_t cache_size= 0;
+	for( const auto& region : regions_ )
+		if( region.second->chunks_used == 0 )
+			cache_size+= GetRegionMemorySize( *region.second );
+
+	while( cache_size > regions_cache_size_ )
+	{
+		auto lru_region= regions_.end();
+		for( auto it= regions_.begin(); it != regions_.end(); ++it )
 		{
-			if( region.get() == &reg )
-			{
-				SaveRegion( reg );
-				if( region != regions_.back() )
-					region= std::move( regions_.back() );
-				regions_.resize( regions_.size() - 1 );
-				break;
-			}
+			if( it->second->chunks_used == 0 &&
+				( lru_region == regions_.end() || it->second->last_use < lru_region->second->last_use ) )
+				lru_region= it;
 		}
+		H_ASSERT( lru_region != regions_.end() );
+		H_ASSERT( lru_region->second->pins == 0 );
+
+		cache_size-= GetRegionMemorySize( *lru_region->second );
+		// All data already written into file, make it persistent.
+		FlushRegion( *lru_region->second );
+		regions_.erase( lru_region );
+		statistics_.regions_evicted++;
 	}
 }
 
@@ -89,20 +261,16 @@ h_ChunkLoader::RegionData& h_ChunkLoader::GetRegionForCoordinates( int longitude
 	int region_longitude= m_Math::DivNonNegativeRemainder( longitude, H_WORLD_REGION_SIZE_X ) * H_WORLD_REGION_SIZE_X;
 	int region_latitude = m_Math::DivNonNegativeRemainder( latitude , H_WORLD_REGION_SIZE_Y ) * H_WORLD_REGION_SIZE_Y;
 
-	for( RegionDataPtr& region : regions_ )
+	RegionDataPtr& region= regions_[ GetRegionKey( region_longitude, region_latitude ) ];
+	if( region == nullptr )
 	{
-		if(
-			region->longitude == region_longitude &&
-			region->latitude  == region_latitude )
-			return *region;
+		//here load new region from disk
+		region.reset( new RegionData( region_longitude, region_latitude ) );
+		LoadRegion( *region );
+		statistics_.regions_loaded++;
 	}
 
-	//here load new region from disk
-	RegionDataPtr new_region( new RegionData( region_longitude, region_latitude ) );
-	LoadRegion( *new_region );
-	regions_.push_back( std::move(new_region) );
-
-	return *regions_.back();
+	return *region;
 }
 
 void h_ChunkLoader::GetRegionFileName( std::string& out_name, int reg_longitude, int reg_latitude ) const
@@ -118,70 +286,296 @@ void h_ChunkLoader::LoadRegion( RegionData& region )
 	//todo: add reading of file with unicode name
 	std::string file_name;
 	GetRegionFileName( file_name, region.longitude, region.latitude );
-	FILE* f= fopen( file_name.data(), "rb" );
-	if( f == nullptr )
+
+	std::unique_ptr<h_MappedFile> file( new h_MappedFile( file_name, false ) );
+	if( !file->IsOpened() )
 	{
 		//make new region, with no chunks
 		h_Console::Info( "Region file for coordinates ", region.longitude, " ", region.latitude,  " not found." );
 		return;
 	}
+	if( file->Size() < g_region_header_size || file->Data() == nullptr )
+	{
+		h_Console::Warning( "Region file \"", file_name, "\" is broken. Region will be regenerated." );
+		return;
+	}
 
-	HEXREGION_header header;
-	fread( &header, 1, sizeof(HEXREGION_header), f );
+	h_BinaryStorage header_data( file->Data(), file->Data() + g_region_header_size );
+	h_BinaryInputStream stream( header_data );
+	region.header.Read( stream );
 
-	H_ASSERT( region.longitude == header.longitude );
-	H_ASSERT( region.latitude  == header.latitude  );
+	H_ASSERT( region.longitude == region.header.longitude );
+	H_ASSERT( region.latitude  == region.header.latitude  );
 
-	for( unsigned int i= 0; i< H_WORLD_REGION_SIZE_X * H_WORLD_REGION_SIZE_Y; i++ )
+	const bool is_old_format=
+		!( std::memcmp( region.header.format_key, H_REGION_FORMAT_HEADER, sizeof(region.header.format_key) ) == 0 &&
+		region.header.version == H_REGION_FORMAT_VERSION );
+	if( is_old_format && !ConvertRegionFile( region, file, file_name ) )
 	{
-		int chunk_data_size= header.chunk_lumps[i].size;
-		if( chunk_data_size == 0 )
+		h_Console::Warning( "Can not convert region file \"", file_name, "\". Region will be regenerated." );
+		for( FileLump& lump : region.header.chunk_lumps )
+			lump.offset= lump.size= 0;
+		return;
+	}
+
+	// Drop lumps outside file.
+	const unsigned int data_size= file->Size() - g_region_header_size;
+	for( FileLump& lump : region.header.chunk_lumps )
+	{
+		if( lump.offset < 0 || lump.size < 0 ||
+			( lump.size > 0 && (unsigned int)lump.size < g_lump_checksum_size ) ||
+			(unsigned int)lump.offset + (unsigned int)lump.size > data_size )
+		{
+			h_Console::Warning( "Region file \"", file_name, "\" has broken chunk. Chunk will be regenerated." );
+			lump.offset= lump.size= 0;
+		}
+	}
+
+	region.file= std::move(file);
+
+	// Collect free space between chunks.
+	std::vector<FileLump> used_lumps;
+	for( const FileLump& lump : region.header.chunk_lumps )
+		if( lump.size > 0 )
+			used_lumps.push_back( lump );
+
+	std::sort(
+		used_lumps.begin(), used_lumps.end(),
+		[]( const FileLump& l, const FileLump& r ) { return l.offset < r.offset; } );
+
+	for( const FileLump& lump : used_lumps )
+	{
+		if( (unsigned int)lump.offset > region.data_end )
+		{
+			FileLump hole;
+			hole.offset= region.data_end;
+			hole.size= lump.offset - region.data_end;
+			region.free_lumps.push_back( hole );
+		}
+		region.data_end= std::max( region.data_end, (unsigned int)( lump.offset + lump.size ) );
+	}
+}
+
+bool h_ChunkLoader::ConvertRegionFile( RegionData& region, std::unique_ptr<h_MappedFile>& file, const std::string& file_name )
+{
+	HEXREGION_header& header= region.header;
+
+	const bool is_v1= !( std::memcmp( header.format_key, H_REGION_FORMAT_HEADER, sizeof(header.format_key) ) == 0 && header.version >= 2 );
+	if( is_v1 )
+	{
+		// Version 1 files have no offsets, chunks data placed sequentially.
+		int offset= 0;
+		for( FileLump& lump : header.chunk_lumps )
+		{
+			lump.offset= offset;
+			offset+= lump.size;
+		}
+	}
+
+	// Old files have no checksums. Write file in new format into temporary file and replace old file with it.
+	// If process crashes during conversion, old file stays untouched.
+	const std::string temp_file_name= file_name + ".tmp";
+	std::remove( temp_file_name.c_str() );
+
+	std::unique_ptr<h_MappedFile> new_file( new h_MappedFile( temp_file_name, true ) );
+	if( !new_file->IsOpened() )
+		return false;
+
+	const unsigned int old_data_size= file->Size() - g_region_header_size;
+	const unsigned char* const old_data= file->Data() + g_region_header_size;
+
+	HEXREGION_header new_header;
+	std::memcpy( new_header.format_key, H_REGION_FORMAT_HEADER, sizeof(new_header.format_key) );
+	new_header.version= H_REGION_FORMAT_VERSION;
+	new_header.datalen= 0;
+	new_header.longitude= region.longitude;
+	new_header.latitude = region.latitude ;
+
+	unsigned int new_data_end= 0;
+	for( unsigned int i= 0; i < g_chunks_in_region; i++ )
+	{
+		const FileLump& lump= header.chunk_lumps[i];
+		FileLump& new_lump= new_header.chunk_lumps[i];
+		new_lump.offset= new_lump.size= 0;
+
+		if( lump.size == 0 )
+			continue;
+		if( lump.offset < 0 || lump.size < 0 || (unsigned int)lump.offset + (unsigned int)lump.size > old_data_size )
+		{
+			h_Console::Warning( "Region file \"", file_name, "\" has broken chunk. Chunk will be regenerated." );
 			continue;
+		}
 
-		region.chunk_data[i].resize( chunk_data_size );
-		fread( region.chunk_data[i].data(), 1, chunk_data_size, f );
+		const unsigned char* const chunk_data= old_data + lump.offset;
+		const uint32_t checksum= CalculateChecksum( chunk_data, lump.size );
+		if( !new_file->Write( g_region_header_size + new_data_end, &checksum, sizeof(uint32_t) ) ||
+			!new_file->Write( g_region_header_size + new_data_end + g_lump_checksum_size, chunk_data, lump.size ) )
+			return false;
+
+		new_lump.offset= new_data_end;
+		new_lump.size= g_lump_checksum_size + lump.size;
+		new_data_end+= new_lump.size;
 	}
 
-	fclose(f);
+	h_BinaryStorage header_data;
+	h_BinaryOuptutStream stream( header_data );
+	new_header.Write( stream );
+	if( !new_file->Write( 0, header_data.data(), header_data.size() ) || !new_file->Flush() )
+		return false;
+
+	// Close files before replacing.
+	new_file.reset();
+	file.reset();
+	if( !h_MappedFile::AtomicReplaceFile( temp_file_name, file_name ) )
+		return false;
+
+	file.reset( new h_MappedFile( file_name, false ) );
+	if( !file->IsOpened() || file->Size() < g_region_header_size )
+		return false;
+
+	header= new_header;
+	h_Console::Info( "Region file \"", file_name, "\" converted to new format" );
+	return true;
 }
 
-void h_ChunkLoader::SaveRegion( const RegionData& region ) const
+bool h_ChunkLoader::CreateRegionFile( RegionData& region )
 {
-	//todo: add reading of file with unicode name
+	if( region.file )
+		return true;
+
 	std::string file_name;
 	GetRegionFileName( file_name, region.longitude, region.latitude );
-	FILE* f= fopen( file_name.data(), "wb" );
-	if( f == nullptr )
+
+	std::unique_ptr<h_MappedFile> file( new h_MappedFile( file_name, true ) );
+	if( !file->IsOpened() )
 	{
 		h_Console::Error(
 			"Can not open file \"", file_name, "\" for region saving." );
-		return;
+		return false;
 	}
 
-	HEXREGION_header header;
-	header.longitude= region.longitude;
-	header.latitude = region.latitude ;
+	h_BinaryStorage header_data;
+	h_BinaryOuptutStream stream( header_data );
+	region.header.Write( stream );
+	if( !file->Write( 0, header_data.data(), header_data.size() ) )
+	{
+		h_Console::Error( "Can not write region header to \"", file_name, "\"" );
+		return false;
+	}
+
+	region.file= std::move(file);
+	return true;
+}
+
+unsigned int h_ChunkLoader::AllocateLump( RegionData& region, const unsigned int size )
+{
+	// Find smallest suitable hole.
+	auto best_hole= region.free_lumps.end();
+	for( auto it= region.free_lumps.begin(); it != region.free_lumps.end(); ++it )
+	{
+		if( (unsigned int)it->size >= size &&
+			( best_hole == region.free_lumps.end() || it->size < best_hole->size ) )
+			best_hole= it;
+	}
+
+	if( best_hole != region.free_lumps.end() )
+	{
+		const unsigned int offset= best_hole->offset;
+		best_hole->offset+= size;
+		best_hole->size-= size;
+		if( best_hole->size == 0 )
+			region.free_lumps.erase( best_hole );
+		return offset;
+	}
+
+	// Append to end of file.
+	const unsigned int offset= region.data_end;
+	region.data_end+= size;
+	return offset;
+}
 
-	//write to header size of compressed chunks
-	for( unsigned int i= 0; i< H_WORLD_REGION_SIZE_X * H_WORLD_REGION_SIZE_Y; i++ )
-		header.chunk_lumps[i].size= region.chunk_data[i].size();
+void h_ChunkLoader::FreeLump( RegionData& region, const unsigned int offset, const unsigned int size )
+{
+	if( size == 0 )
+		return;
 
-	fwrite( &header, 1, sizeof(HEXREGION_header), f );
+	auto it=
+		std::lower_bound(
+			region.free_lumps.begin(), region.free_lumps.end(), offset,
+			[]( const FileLump& lump, unsigned int off ) { return (unsigned int)lump.offset < off; } );
 
-	for( unsigned int i= 0; i< H_WORLD_REGION_SIZE_X * H_WORLD_REGION_SIZE_Y; i++ )
+	FileLump hole;
+	hole.offset= offset;
+	hole.size= size;
+	it= region.free_lumps.insert( it, hole );
+
+	// Merge with next.
+	auto next= it + 1;
+	if( next != region.free_lumps.end() && it->offset + it->size == next->offset )
 	{
-		int chunk_data_size= header.chunk_lumps[i].size;
-		if( chunk_data_size == 0 )
-			continue;
+		it->size+= next->size;
+		region.free_lumps.erase( next );
+	}
+	// Merge with previous.
+	if( it != region.free_lumps.begin() )
+	{
+		auto prev= it - 1;
+		if( prev->offset + prev->size == it->offset )
+		{
+			prev->size+= it->size;
+			it= region.free_lumps.erase( it ) - 1;
+		}
+	}
+
+	// Hole at end - just move data end.
+	if( (unsigned int)( it->offset + it->size ) == region.data_end )
+	{
+		region.data_end= it->offset;
+		region.free_lumps.erase( it );
+	}
+}
+
+bool h_ChunkLoader::WriteLumps( RegionData& region )
+{
+	h_BinaryStorage lumps_data;
+	h_BinaryOuptutStream stream( lumps_data );
+	for( const FileLump& lump : region.header.chunk_lumps )
+		lump.Write( stream );
+
+	return region.file->Write( GetLumpOffsetInFile( 0 ), lumps_data.data(), lumps_data.size() );
+}
 
-		fwrite( region.chunk_data[i].data(), 1, chunk_data_size, f );
+void h_ChunkLoader::FlushRegion( RegionData& region )
+{
+	if( !region.need_flush )
+		return;
+
+	// Disk can reorder unflushed writes, so, data must be flushed before lumps, which reference it.
+	if( !region.file->Flush() || !WriteLumps( region ) || !region.file->Flush() )
+	{
+		h_Console::Error( "Can not flush region ", region.longitude, " ", region.latitude );
+		return;
 	}
 
-	fclose(f);
+	// Now header on disk does not reference replaced data.
+	for( const FileLump& lump : region.pending_free_lumps )
+		FreeLump( region, lump.offset, lump.size );
+	region.pending_free_lumps.clear();
+
+	region.need_flush= false;
+	statistics_.regions_flushed++;
+}
+
+size_t h_ChunkLoader::GetRegionMemorySize( const RegionData& region )
+{
+	return
+		sizeof(RegionData) +
+		( region.file ? region.file->Size() : 0u ) +
+		( region.free_lumps.capacity() + region.pending_free_lumps.capacity() ) * sizeof(FileLump);
 }
 
-void h_ChunkLoader::ForceSaveAllChunks() const
+void h_ChunkLoader::ForceSaveAllChunks()
 {
-	for( const RegionDataPtr& region : regions_ )
-		SaveRegion( *region );
+	for( const auto& region : regions_ )
+		FlushRegion( *region.second );
 }
@@ -1,23 +1,66 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "math_lib/binary_stream.hpp"
 
+class h_MappedFile;
+
+// Region files storage. Region files are mapped into memory, chunks data is read directly from mapping.
+// Saving of chunk writes only this chunk data. Lumps table in region header is written on flush,
+// between flushes of chunks data and lumps table, so, header on disk never references not flushed data.
+// Saved data is never overwritten before flush, and each lump has checksum,
+// so, crash during saving can not break other chunks. Broken chunks are regenerated.
+// Regions without used chunks are kept in memory, until regions cache size is exceeded,
+// so, moving back and forth near region border does not reload and flush region files.
 class h_ChunkLoader final
 {
 public:
+	// Compressed chunk data. Empty, if chunk does not exist.
+	struct ChunkData
+	{
+		const unsigned char* data;
+		unsigned int size;
+	};
+
 	h_ChunkLoader( std::string world_directory );
 	~h_ChunkLoader();
 
-	//in\out - compressed data
-	//returns container for compressed chunk data ( id need, load it from disk )
-	h_BinaryStorage& GetChunkData( int longitude, int latitude );
+	// Returns compressed chunk data and marks chunk as used.
+	// Returns empty data, if chunk data is broken.
+	// Data is valid until next call of any nonconst method.
+	ChunkData GetChunkData( int longitude, int latitude );
+	// Same as GetChunkData, but data stays valid until UnpinChunkData call, even if other chunks are written.
+	// So, pinned data can be read without loader lock.
+	ChunkData GetPinnedChunkData( int longitude, int latitude );
+	void UnpinChunkData( int longitude, int latitude );
+	// Write compressed chunk data into region file.
+	// Returns false, if data is not written. Old chunk data stays in region file in this case.
+	bool SetChunkData( int longitude, int latitude, const unsigned char* data, unsigned int size );
 	void FreeChunkData( int longitude, int latitude );
 
-	//save all data of all regions, but not delete it
-	void ForceSaveAllChunks() const;
+	//flush data of all regions to disk, but not close regions
+	void ForceSaveAllChunks();
+
+	// If true, each chunk writing is flushed to disk immediately. Slow, but chunks are not lost on power failure.
+	// By default, data is flushed in ForceSaveAllChunks and on region closing.
+	void SetFlushEachWrite( bool flush_each_write );
+
+	// Memory budget for regions without used chunks. Least recently used regions are flushed and closed first.
+	// 0 - close region immediately, when last chunk of region is freed.
+	static constexpr const size_t c_default_regions_cache_size= 64u * 1024u * 1024u;
+	void SetRegionsCacheSize( size_t size );
+
+	struct Statistics
+	{
+		uint64_t regions_loaded= 0;
+		uint64_t regions_flushed= 0;
+		uint64_t regions_evicted= 0;
+	};
+	const Statistics& GetStatistics() const;
 
 private:
 	struct RegionData;
@@ -27,11 +70,42 @@ private:
 	//find loaded region or loads it
 	RegionData& GetRegionForCoordinates( int longitude, int latitude );
 	void LoadRegion( RegionData& region );
-	void SaveRegion( const RegionData& region ) const;
+	// Flush and close least recently used regions without used chunks, while cache size is exceeded.
+	void TrimRegionsCache();
+	// Convert file of old format into current format. Returns true, if all is ok.
+	bool ConvertRegionFile( RegionData& region, std::unique_ptr<h_MappedFile>& file, const std::string& file_name );
+	// Create region file, if it does not exist. Returns true, if all is ok.
+	bool CreateRegionFile( RegionData& region );
+
+	// Allocate space for chunk data in region file. Returns offset.
+	static unsigned int AllocateLump( RegionData& region, unsigned int size );
+	static void FreeLump( RegionData& region, unsigned int offset, unsigned int size );
+	// Write lumps table of header. Returns true, if all is ok.
+	static bool WriteLumps( RegionData& region );
+	void FlushRegion( RegionData& region );
+	static size_t GetRegionMemorySize( const RegionData& region );
 
 	void GetRegionFileName( std::string& out_name, int reg_longitude, int reg_latitude ) const;
 
 private:
-	std::vector< RegionDataPtr > regions_;
+	// Key - region coordinates, see GetRegionKey.
+	std::unordered_map< uint64_t, RegionDataPtr > regions_;
 	std::string regions_path_;
+	bool flush_each_write_= false;
+
+	size_t regions_cache_size_= c_default_regions_cache_size;
+	// Counter for regions usage order.
+	uint64_t regions_use_counter_= 0;
+
+	Statistics statistics_;
 };
+
+inline void h_ChunkLoader::SetFlushEachWrite( const bool flush_each_write )
+{
+	flush_each_write_= flush_each_write;
+}
+
+inline const h_ChunkLoader::Statistics& h_ChunkLoader::GetStatistics() const
+{
+	return statistics_;
+}
@@ -0,0 +1,259 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+
+#include "chunk_pool.hpp"
+#include "math_lib/assert.hpp"
+
+constexpr const size_t h_ChunkPool::c_slab_size;
+constexpr const size_t h_ChunkPool::c_page_size;
+constexpr const unsigned int h_ChunkPool::c_default_max_free_storages;
+constexpr const size_t h_ChunkPool::c_storage_size;
+constexpr const unsigned int h_ChunkPool::c_storages_per_slab;
+constexpr const size_t h_ChunkPool::c_slab_memory_size;
+
+static_assert( alignof(h_Chunk) <= h_ChunkPool::c_page_size, "Chunk storage is not aligned enough" );
+
+h_ChunkPool::h_ChunkPool()
+{}
+
+h_ChunkPool::~h_ChunkPool()
+{
+	for( const Slab& slab : slabs_ )
+	{
+		H_ASSERT( slab.used_storages == 0 );
+		FreeSlabMemory( slab.memory );
+	}
+}
+
+void h_ChunkPool::SetMaxFreeStorages( const unsigned int count )
+{
+	std::lock_guard<std::mutex> lock( mutex_ );
+	max_free_storages_= count;
+	ReleaseFreeSlabs();
+}
+
+void h_ChunkPool::SetUseHugePages( const bool use )
+{
+	std::lock_guard<std::mutex> lock( mutex_ );
+	use_huge_pages_= use;
+}
+
+h_ChunkPool::Stats h_ChunkPool::GetStats() const
+{
+	std::lock_guard<std::mutex> lock( mutex_ );
+
+	Stats stats;
+	stats.slabs= (unsigned int)slabs_.size();
+	stats.huge_pages_slabs= 0;
+	stats.storages_used= 0;
+	for( const Slab& slab : slabs_ )
+	{
+		if( slab.huge_pages )
+			stats.huge_pages_slabs++;
+		stats.storages_used+= slab.used_storages;
+	}
+	stats.storages_total= stats.slabs * c_storages_per_slab;
+	stats.storages_free= (unsigned int)free_storages_.size();
+	stats.chunks_created= chunks_created_;
+	stats.chunks_reused= chunks_reused_;
+	stats.page_faults_fresh= page_faults_fresh_;
+	stats.page_faults_reused= page_faults_reused_;
+	return stats;
+}
+
+float h_ChunkPool::GetReuseRate() const
+{
+	std::lock_guard<std::mutex> lock( mutex_ );
+	return chunks_created_ == 0 ? 0.0f : float( double(chunks_reused_) / double(chunks_created_) );
+}
+
+void* h_ChunkPool::AllocateStorage( bool* const out_reused )
+{
+	std::lock_guard<std::mutex> lock( mutex_ );
+
+	chunks_created_++;
+
+	*out_reused= !free_storages_.empty();
+	if( *out_reused )
+	{
+		void* const storage= free_storages_.back();
+		free_storages_.pop_back();
+		FindSlab( storage ).used_storages++;
+		chunks_reused_++;
+		return storage;
+	}
+
+	for( Slab& slab : slabs_ )
+		if( slab.fresh_storages > 0 )
+		{
+			void* const storage= slab.memory + ( c_storages_per_slab - slab.fresh_storages ) * c_storage_size;
+			slab.fresh_storages--;
+			slab.used_storages++;
+			return storage;
+		}
+
+	Slab slab;
+	slab.memory= AllocateSlabMemory( use_huge_pages_, &slab.huge_pages );
+	if( slab.memory == nullptr )
+		throw std::bad_alloc();
+
+	slab.fresh_storages= c_storages_per_slab - 1u;
+	slab.used_storages= 1u;
+	slabs_.push_back( slab );
+	return slab.memory;
+}
+
+void h_ChunkPool::FreeStorage( void* const storage )
+{
+	std::lock_guard<std::mutex> lock( mutex_ );
+
+	Slab& slab= FindSlab( storage );
+	H_ASSERT( slab.used_storages > 0 );
+	slab.used_storages--;
+	free_storages_.push_back( storage );
+
+	if( slab.used_storages == 0 )
+		ReleaseFreeSlabs();
+}
+
+void h_ChunkPool::AddPageFaults( const bool reused, const uint64_t page_faults )
+{
+	std::lock_guard<std::mutex> lock( mutex_ );
+	( reused ? page_faults_reused_ : page_faults_fresh_ )+= page_faults;
+}
+
+uint64_t h_ChunkPool::GetThreadPageFaults()
+{
+	// Process counters include faults of other threads, so, only per-thread counters are usable.
+#ifdef RUSAGE_THREAD
+	rusage usage;
+	if( ::getrusage( RUSAGE_THREAD, &usage ) == 0 )
+		return uint64_t( usage.ru_minflt );
+#endif
+	return 0;
+}
+
+h_ChunkPool::Slab& h_ChunkPool::FindSlab( const void* const storage )
+{
+	// Slabs count is small, linear search is fast enough.
+	const unsigned char* const storage_bytes= static_cast<const unsigned char*>(storage);
+	for( Slab& slab : slabs_ )
+		if( storage_bytes >= slab.memory && storage_bytes < slab.memory + c_slab_memory_size )
+			return slab;
+
+	H_ASSERT(false);
+	return slabs_.front();
+}
+
+void h_ChunkPool::ReleaseFreeSlabs()
+{
+	for( unsigned int i= 0; i < slabs_.size(); )
+	{
+		const Slab& slab= slabs_[i];
+		if( free_storages_.size() <= max_free_storages_ )
+			break;
+
+		if( slab.used_storages != 0 )
+		{
+			i++;
+			continue;
+		}
+
+		free_storages_.erase(
+			std::remove_if(
+				free_storages_.begin(), free_storages_.end(),
+				[&slab]( const void* const storage )
+				{
+					return storage >= slab.memory && storage < slab.memory + c_slab_memory_size;
+				} ),
+			free_storages_.end() );
+
+		FreeSlabMemory( slab.memory );
+		if( i != slabs_.size() - 1u )
+			slabs_[i]= slabs_.back();
+		slabs_.pop_back();
+	}
+}
+
+#ifdef _WIN32
+
+unsigned char* h_ChunkPool::AllocateSlabMemory( const bool use_huge_pages, bool* const out_huge_pages )
+{
+	// Large pages require "lock pages in memory" privilege. Without it allocation fails and normal pages are used.
+	if( use_huge_pages && ::GetLargePageMinimum() != 0 && c_slab_memory_size % ::GetLargePageMinimum() == 0 )
+	{
+		void* const memory=
+			::VirtualAlloc( nullptr, c_slab_memory_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE );
+		if( memory != nullptr )
+		{
+			*out_huge_pages= true;
+			return static_cast<unsigned char*>(memory);
+		}
+	}
+
+	*out_huge_pages= false;
+	return static_cast<unsigned char*>( ::VirtualAlloc( nullptr, c_slab_memory_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE ) );
+}
+
+void h_ChunkPool::FreeSlabMemory( unsigned char* const memory )
+{
+	::VirtualFree( memory, 0, MEM_RELEASE );
+}
+
+#else
+
+unsigned char* h_ChunkPool::AllocateSlabMemory( const bool use_huge_pages, bool* const out_huge_pages )
+{
+	*out_huge_pages= false;
+
+#ifdef MAP_HUGETLB
+	// Explicit huge pages. Usually there are no reserved huge pages and mapping fails.
+	if( use_huge_pages )
+	{
+		void* const memory=
+			::mmap( nullptr, c_slab_memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+		if( memory != MAP_FAILED )
+		{
+			*out_huge_pages= true;
+			return static_cast<unsigned char*>(memory);
+		}
+	}
+#endif
+
+	// Map more memory and cut unaligned parts - transparent huge pages work only for aligned ranges.
+	const size_t mapping_size= c_slab_memory_size + c_slab_size;
+	void* const mapping= ::mmap( nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	if( mapping == MAP_FAILED )
+		return nullptr;
+
+	unsigned char* const mapping_bytes= static_cast<unsigned char*>(mapping);
+	unsigned char* const memory=
+		reinterpret_cast<unsigned char*>( ( reinterpret_cast<uintptr_t>(mapping_bytes) + c_slab_size - 1u ) & ~uintptr_t( c_slab_size - 1u ) );
+
+	const size_t head_size= size_t( memory - mapping_bytes );
+	const size_t tail_size= mapping_size - head_size - c_slab_memory_size;
+	if( head_size > 0 )
+		::munmap( mapping_bytes, head_size );
+	if( tail_size > 0 )
+		::munmap( memory + c_slab_memory_size, tail_size );
+
+#ifdef MADV_HUGEPAGE
+	if( use_huge_pages )
+		*out_huge_pages= ::madvise( memory, c_slab_memory_size, MADV_HUGEPAGE ) == 0;
+#endif
+
+	return memory;
+}
+
+void h_ChunkPool::FreeSlabMemory( unsigned char* const memory )
+{
+	::munmap( memory, c_slab_memory_size );
+}
+
+#endif
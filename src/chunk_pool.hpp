@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "chunk.hpp"
+
+// Pool of memory for chunks.
+// Chunk is big object, so, allocation of each chunk via system allocator gives fresh pages and page faults on first touch.
+// Pool allocates memory by slabs of several chunks and constructs new chunks in storage of deleted chunks,
+// so, pages of this storage stay resident and warm.
+// Slab is returned to system, when all its chunks are deleted and pool has too many free storages.
+// All methods are thread safe.
+class h_ChunkPool final
+{
+public:
+	struct Stats
+	{
+		unsigned int slabs;
+		unsigned int huge_pages_slabs; // Slabs, for which huge pages are requested successfully.
+		unsigned int storages_total;
+		unsigned int storages_used;
+		unsigned int storages_free; // Recycled storages, ready for reusing.
+		uint64_t chunks_created;
+		uint64_t chunks_reused; // Chunks, created in recycled storage.
+		// Minor page faults of chunks creation, measured for creating thread. Zero, if measurement is not supported.
+		uint64_t page_faults_fresh; // For chunks, created in never used storage.
+		uint64_t page_faults_reused; // For chunks, created in recycled storage.
+	};
+
+	static constexpr const size_t c_slab_size= 2u << 20u; // Size of huge page on x86.
+	static constexpr const size_t c_page_size= 4096u;
+	static constexpr const unsigned int c_default_max_free_storages= 2u * H_MAX_CHUNKS;
+
+	h_ChunkPool();
+	// All chunks must be deleted before pool destruction.
+	~h_ChunkPool();
+
+	h_ChunkPool( const h_ChunkPool& )= delete;
+	h_ChunkPool& operator=( const h_ChunkPool& )= delete;
+
+	// Free storages above limit are returned to system, when it is possible.
+	void SetMaxFreeStorages( unsigned int count );
+	// Request huge pages for new slabs. System may not provide them, pool uses normal pages in such case.
+	void SetUseHugePages( bool use );
+
+	template<class ... Args>
+	h_Chunk* New( Args&& ... args );
+	void Delete( h_Chunk* chunk );
+
+	Stats GetStats() const;
+	// Part of chunks, created in recycled storage. In range [0; 1].
+	float GetReuseRate() const;
+
+private:
+	struct Slab
+	{
+		unsigned char* memory;
+		unsigned int fresh_storages; // Storages at the end of slab, which were never used.
+		unsigned int used_storages;
+		bool huge_pages;
+	};
+
+	static constexpr const size_t c_storage_size= ( sizeof(h_Chunk) + c_page_size - 1u ) / c_page_size * c_page_size;
+	static constexpr const unsigned int c_storages_per_slab= c_slab_size >= c_storage_size ? c_slab_size / c_storage_size : 1u;
+	static constexpr const size_t c_slab_memory_size= ( c_storages_per_slab * c_storage_size + c_slab_size - 1u ) / c_slab_size * c_slab_size;
+
+	void* AllocateStorage( bool* out_reused );
+	void FreeStorage( void* storage );
+	void AddPageFaults( bool reused, uint64_t page_faults );
+	// Minor page faults of current thread.
+	static uint64_t GetThreadPageFaults();
+	Slab& FindSlab( const void* storage );
+	void ReleaseFreeSlabs();
+
+	// Allocate memory, aligned to slab size. Returns nullptr on failure.
+	static unsigned char* AllocateSlabMemory( bool use_huge_pages, bool* out_huge_pages );
+	static void FreeSlabMemory( unsigned char* memory );
+
+private:
+	mutable std::mutex mutex_;
+
+	std::vector<Slab> slabs_;
+	// Stack of recycled storages. Last deleted chunk storage is most likely in cache.
+	std::vector<void*> free_storages_;
+
+	unsigned int max_free_storages_= c_default_max_free_storages;
+	bool use_huge_pages_= false;
+
+	uint64_t chunks_created_= 0;
+	uint64_t chunks_reused_= 0;
+	uint64_t page_faults_fresh_= 0;
+	uint64_t page_faults_reused_= 0;
+};
+
+template<class ... Args>
+h_Chunk* h_ChunkPool::New( Args&& ... args )
+{
+	// Storage allocation is measured too - mapping of new slab may fault its pages.
+	const uint64_t page_faults_before= GetThreadPageFaults();
+
+	bool reused;
+	void* const storage= AllocateStorage( &reused );
+
+	// Construct chunk outside lock - construction is long.
+	// Chunk allocators may throw std::bad_alloc, return storage to pool in such case.
+	h_Chunk* chunk;
+	try
+	{
+		chunk= new( storage ) h_Chunk( std::forward<Args>(args)... );
+	}
+	catch(...)
+	{
+		FreeStorage( storage );
+		throw;
+	}
+
+	AddPageFaults( reused, GetThreadPageFaults() - page_faults_before );
+	return chunk;
+}
+
+inline void h_ChunkPool::Delete( h_Chunk* const chunk )
+{
+	if( chunk == nullptr )
+		return;
+
+	chunk->~h_Chunk();
+	FreeStorage( chunk );
+}
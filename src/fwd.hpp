@@ -27,6 +27,8 @@ typedef std::shared_ptr<const p_WorldPhysMesh> p_WorldPhysMeshConstPtr;
 
 class g_WorldGenerator;
 
+struct h_VertexLightColumns;
+
 class r_IWorldRenderer;
 typedef std::shared_ptr<r_IWorldRenderer> r_IWorldRendererPtr;
 typedef std::weak_ptr<r_IWorldRenderer> r_IWorldRendererWeakPtr;
@@ -39,6 +39,27 @@
 #define H_MAX_SUN_LIGHT 8
 #define H_MAX_FIRE_LIGHT 13
 
+// Sun and fire light of cell are packed into one byte. Sun light in low bits, fire light in high bits.
+#define H_LIGHT_BITS 4
+#define H_LIGHT_MASK ( ( 1 << H_LIGHT_BITS ) - 1 )
+
+static_assert( H_MAX_SUN_LIGHT <= H_LIGHT_MASK && H_MAX_FIRE_LIGHT <= H_LIGHT_MASK, "Light does not fit into packed light bits" );
+
+inline unsigned char hPackLight( const unsigned char sun_light, const unsigned char fire_light )
+{
+	return (unsigned char)( sun_light | ( fire_light << H_LIGHT_BITS ) );
+}
+
+inline unsigned char hPackedSunLight( const unsigned char packed_light )
+{
+	return packed_light & H_LIGHT_MASK;
+}
+
+inline unsigned char hPackedFireLight( const unsigned char packed_light )
+{
+	return packed_light >> H_LIGHT_BITS;
+}
+
 #define H_MAX_FLAMMABILITY 128
 
 /* COORDINATE SYSTEM:
@@ -0,0 +1,186 @@
+#include <cstdint>
+#include <cstring>
+
+#include "lz_compression.hpp"
+
+/*
+Compressed data is sequence of blocks:
+token - high 4 bits - literals count, low 4 bits - match length minus g_min_match.
+If count in token is 15, additional bytes follow: each byte added to count, until byte is not 255.
+Literals.
+Match offset - 2 bytes, little endian. Offset is never zero.
+Additional match length bytes.
+Last block contains only literals, without match.
+*/
+
+static const unsigned int g_min_match= 4;
+static const unsigned int g_max_offset= 65535;
+// Last bytes always stored as literals, it simplifies decompression.
+static const unsigned int g_last_literals= 5;
+
+static const unsigned int g_hash_table_size_log2= 12;
+static const unsigned int g_hash_table_size= 1 << g_hash_table_size_log2;
+
+static uint32_t Read32( const unsigned char* p )
+{
+	uint32_t result;
+	std::memcpy( &result, p, sizeof(uint32_t) );
+	return result;
+}
+
+static unsigned int Hash( uint32_t sequence )
+{
+	return ( sequence * 2654435761u ) >> ( 32 - g_hash_table_size_log2 );
+}
+
+static unsigned char* WriteLength( unsigned char* out, unsigned int length )
+{
+	while( length >= 255 )
+	{
+		*out++= 255;
+		length-= 255;
+	}
+	*out++= (unsigned char)length;
+	return out;
+}
+
+static unsigned char* WriteLiterals( unsigned char* out, const unsigned char* literals, unsigned int count, unsigned int match_length_token )
+{
+	unsigned char* const token= out++;
+	if( count >= 15 )
+	{
+		*token= (unsigned char)( ( 15 << 4 ) | match_length_token );
+		out= WriteLength( out, count - 15 );
+	}
+	else
+		*token= (unsigned char)( ( count << 4 ) | match_length_token );
+
+	std::memcpy( out, literals, count );
+	return out + count;
+}
+
+unsigned int hLzCompressBound( const unsigned int size )
+{
+	return size + size / 255 + 16;
+}
+
+unsigned int hLzCompress( const unsigned char* const data, const unsigned int size, unsigned char* const out_data )
+{
+	unsigned char* out= out_data;
+
+	if( size > g_min_match + g_last_literals )
+	{
+		uint32_t hash_table[ g_hash_table_size ];
+		std::memset( hash_table, 0xFF, sizeof(hash_table) );
+
+		const unsigned int match_search_end= size - g_last_literals - g_min_match;
+		unsigned int anchor= 0;
+		unsigned int pos= 0;
+		while( pos <= match_search_end )
+		{
+			const uint32_t sequence= Read32( data + pos );
+			const unsigned int hash= Hash( sequence );
+			const uint32_t candidate= hash_table[hash];
+			hash_table[hash]= pos;
+
+			if( candidate == 0xFFFFFFFFu || pos - candidate > g_max_offset || Read32( data + candidate ) != sequence )
+			{
+				pos++;
+				continue;
+			}
+
+			// Extend match. Do not touch last literals.
+			unsigned int match_length= g_min_match;
+			const unsigned int match_end_limit= size - g_last_literals;
+			while( pos + match_length < match_end_limit && data[ candidate + match_length ] == data[ pos + match_length ] )
+				match_length++;
+
+			const unsigned int match_length_extra= match_length - g_min_match;
+			out= WriteLiterals( out, data + anchor, pos - anchor, match_length_extra >= 15 ? 15 : match_length_extra );
+
+			const unsigned int offset= pos - candidate;
+			*out++= (unsigned char)( offset & 255 );
+			*out++= (unsigned char)( offset >> 8 );
+			if( match_length_extra >= 15 )
+				out= WriteLength( out, match_length_extra - 15 );
+
+			pos+= match_length;
+			anchor= pos;
+		}
+
+		out= WriteLiterals( out, data + anchor, size - anchor, 0 );
+	}
+	else
+		out= WriteLiterals( out, data, size, 0 );
+
+	return (unsigned int)( out - out_data );
+}
+
+bool hLzDecompress( const unsigned char* const data, const unsigned int size, unsigned char* const out_data, const unsigned int out_size )
+{
+	const unsigned char* in= data;
+	const unsigned char* const in_end= data + size;
+	unsigned char* out= out_data;
+	unsigned char* const out_end= out_data + out_size;
+
+	const auto read_length=
+	[&]( unsigned int& length ) -> bool
+	{
+		unsigned char b;
+		do
+		{
+			if( in == in_end )
+				return false;
+			b= *in++;
+			length+= b;
+		} while( b == 255 );
+		return true;
+	};
+
+	while( in < in_end )
+	{
+		const unsigned char token= *in++;
+
+		unsigned int literals_count= token >> 4;
+		if( literals_count == 15 && !read_length( literals_count ) )
+			return false;
+
+		if( (unsigned int)( in_end - in ) < literals_count || (unsigned int)( out_end - out ) < literals_count )
+			return false;
+		std::memcpy( out, in, literals_count );
+		in+= literals_count;
+		out+= literals_count;
+
+		// Last block has no match.
+		if( in == in_end )
+			break;
+
+		if( in_end - in < 2 )
+			return false;
+		const unsigned int offset= in[0] | ( in[1] << 8 );
+		in+= 2;
+
+		unsigned int match_length= token & 15;
+		if( match_length == 15 && !read_length( match_length ) )
+			return false;
+		match_length+= g_min_match;
+
+		if( offset == 0 || offset > (unsigned int)( out - out_data ) || (unsigned int)( out_end - out ) < match_length )
+			return false;
+
+		// Match can overlap output, so, copy bytewise.
+		const unsigned char* match= out - offset;
+		if( offset >= match_length )
+		{
+			std::memcpy( out, match, match_length );
+			out+= match_length;
+		}
+		else
+		{
+			for( unsigned int i= 0; i < match_length; i++ )
+				*out++= *match++;
+		}
+	}
+
+	return out == out_end;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Simple fast compressor of LZ77 family.
+// Format is similar to LZ4 block format: sequences of literals and matches with 16-bit offsets.
+// Designed for fast decompression, compression ratio is worse, than zlib.
+
+// Maximum size of compressed data for input of given size.
+unsigned int hLzCompressBound( unsigned int size );
+
+// Returns size of compressed data. "out_data" must have size at least hLzCompressBound( size ).
+unsigned int hLzCompress( const unsigned char* data, unsigned int size, unsigned char* out_data );
+
+// Returns true, if all is ok and exactly "out_size" bytes decompressed.
+bool hLzDecompress( const unsigned char* data, unsigned int size, unsigned char* out_data, unsigned int out_size );
@@ -0,0 +1,357 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "mapped_file.hpp"
+#include "console.hpp"
+
+static std::atomic<uint64_t> g_writes_limit{ h_MappedFile::c_no_writes_limit };
+static std::atomic<uint64_t> g_bytes_written{ 0 };
+static std::atomic<uint64_t> g_flushes_before_crash{ h_MappedFile::c_no_writes_limit };
+static std::atomic<bool> g_killed{ false };
+
+void h_MappedFile::SetWritesLimit( const uint64_t bytes )
+{
+	g_bytes_written.store( 0 );
+	g_writes_limit.store( bytes );
+	g_killed.store( false );
+}
+
+void h_MappedFile::SetReorderedWritesCrash( const uint64_t flushes )
+{
+	g_flushes_before_crash.store( flushes );
+	g_killed.store( false );
+}
+
+// Returns size of data, which can be written.
+static unsigned int ApplyWritesLimit( const unsigned int size )
+{
+	if( g_killed.load() )
+		return 0;
+	if( g_writes_limit.load() == h_MappedFile::c_no_writes_limit )
+		return size;
+
+	const uint64_t written= g_bytes_written.fetch_add( size );
+	const uint64_t limit= g_writes_limit.load();
+	if( written >= limit )
+		return 0;
+	return (unsigned int)std::min( uint64_t(size), limit - written );
+}
+
+static bool WritesLimitReached()
+{
+	return
+		g_killed.load() ||
+		( g_writes_limit.load() != h_MappedFile::c_no_writes_limit && g_bytes_written.load() >= g_writes_limit.load() );
+}
+
+bool h_MappedFile::Write( const unsigned int offset, const void* const data, unsigned int size )
+{
+	size= ApplyWritesLimit( size );
+	if( size == 0 )
+		return true;
+
+	if( g_flushes_before_crash.load() != c_no_writes_limit )
+	{
+		// Remember old data. Data after file end is lost as zeros.
+		UnflushedWrite unflushed_write;
+		unflushed_write.offset= offset;
+		unflushed_write.old_data.resize( size, 0 );
+		if( offset < size_ && data_ != nullptr )
+			std::memcpy( unflushed_write.old_data.data(), data_ + offset, std::min( size, size_ - offset ) );
+		unflushed_writes_.push_back( std::move(unflushed_write) );
+	}
+
+	return WriteData( offset, data, size );
+}
+
+bool h_MappedFile::Flush()
+{
+	if( WritesLimitReached() )
+		return true;
+
+	if( g_flushes_before_crash.load() != c_no_writes_limit )
+	{
+		if( g_flushes_before_crash.load() == 0 )
+		{
+			LoseUnflushedWrites();
+			g_killed.store( true );
+			return true;
+		}
+		g_flushes_before_crash--;
+		unflushed_writes_.clear();
+	}
+
+	return FlushData();
+}
+
+void h_MappedFile::LoseUnflushedWrites()
+{
+	if( unflushed_writes_.empty() )
+		return;
+
+	for( size_t i= unflushed_writes_.size() - 1u; i > 0u; i-- )
+	{
+		const UnflushedWrite& unflushed_write= unflushed_writes_[ i - 1u ];
+		WriteData( unflushed_write.offset, unflushed_write.old_data.data(), unflushed_write.old_data.size() );
+	}
+	unflushed_writes_.clear();
+}
+
+#ifdef _WIN32
+
+h_MappedFile::h_MappedFile( const std::string& file_name, const bool create )
+	: file_handle_(nullptr)
+	, mapping_handle_(nullptr)
+{
+	HANDLE file=
+		::CreateFileA(
+			file_name.c_str(),
+			GENERIC_READ | GENERIC_WRITE,
+			FILE_SHARE_READ,
+			nullptr,
+			create ? OPEN_ALWAYS : OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL,
+			nullptr );
+	if( file == INVALID_HANDLE_VALUE )
+		return;
+
+	file_handle_= file;
+
+	LARGE_INTEGER file_size;
+	::GetFileSizeEx( file, &file_size );
+	size_= (unsigned int)file_size.QuadPart;
+
+	if( !Map() )
+		h_Console::Error( "Can not map file \"", file_name, "\"" );
+}
+
+h_MappedFile::~h_MappedFile()
+{
+	ReleaseOldMappings();
+	Unmap();
+	if( file_handle_ != nullptr )
+		::CloseHandle( file_handle_ );
+}
+
+bool h_MappedFile::WriteData( const unsigned int offset, const void* const data, const unsigned int size )
+{
+	OVERLAPPED overlapped= {};
+	overlapped.Offset= offset;
+
+	DWORD written= 0;
+	if( !::WriteFile( file_handle_, data, size, &written, &overlapped ) || written != size )
+		return false;
+
+	if( offset + size > size_ )
+	{
+		size_= offset + size;
+		// Mapping can not be larger, than file, so, remap it.
+		return Remap();
+	}
+	return true;
+}
+
+bool h_MappedFile::FlushData()
+{
+	return ::FlushFileBuffers( file_handle_ ) != 0;
+}
+
+bool h_MappedFile::AtomicReplaceFile( const std::string& src, const std::string& dst )
+{
+	if( WritesLimitReached() )
+		return true;
+
+	return ::MoveFileExA( src.c_str(), dst.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != 0;
+}
+
+bool h_MappedFile::Map()
+{
+	if( size_ == 0 )
+		return true;
+
+	mapping_handle_= ::CreateFileMappingA( file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if( mapping_handle_ == nullptr )
+		return false;
+
+	data_= static_cast<unsigned char*>( ::MapViewOfFile( mapping_handle_, FILE_MAP_READ, 0, 0, 0 ) );
+	if( data_ == nullptr )
+		return false;
+
+	mapped_size_= size_;
+	return true;
+}
+
+void h_MappedFile::Unmap()
+{
+	if( data_ != nullptr )
+		::UnmapViewOfFile( data_ );
+	if( mapping_handle_ != nullptr )
+		::CloseHandle( mapping_handle_ );
+
+	data_= nullptr;
+	mapping_handle_= nullptr;
+	mapped_size_= 0;
+}
+
+bool h_MappedFile::Remap()
+{
+	if( data_ != nullptr || mapping_handle_ != nullptr )
+	{
+		OldMapping old_mapping;
+		old_mapping.data= data_;
+		old_mapping.size= mapped_size_;
+		old_mapping.mapping_handle= mapping_handle_;
+		old_mappings_.push_back( old_mapping );
+	}
+
+	data_= nullptr;
+	mapping_handle_= nullptr;
+	mapped_size_= 0;
+	return Map();
+}
+
+void h_MappedFile::ReleaseOldMappings()
+{
+	for( const OldMapping& old_mapping : old_mappings_ )
+	{
+		if( old_mapping.data != nullptr )
+			::UnmapViewOfFile( old_mapping.data );
+		if( old_mapping.mapping_handle != nullptr )
+			::CloseHandle( old_mapping.mapping_handle );
+	}
+	old_mappings_.clear();
+}
+
+#else
+
+// Map more, than file size, to avoid remapping on each file growth.
+// Pages after file end are never accessed.
+static const unsigned int g_mapping_granularity= 16u * 1024u * 1024u;
+
+h_MappedFile::h_MappedFile( const std::string& file_name, const bool create )
+{
+	file_descriptor_= ::open( file_name.c_str(), O_RDWR | ( create ? O_CREAT : 0 ), 0644 );
+	if( file_descriptor_ == -1 )
+		return;
+
+	struct stat file_stat;
+	if( ::fstat( file_descriptor_, &file_stat ) == 0 )
+		size_= (unsigned int)file_stat.st_size;
+
+	if( !Map() )
+		h_Console::Error( "Can not map file \"", file_name, "\"" );
+}
+
+h_MappedFile::~h_MappedFile()
+{
+	ReleaseOldMappings();
+	Unmap();
+	if( file_descriptor_ != -1 )
+		::close( file_descriptor_ );
+}
+
+bool h_MappedFile::WriteData( const unsigned int offset, const void* const data, const unsigned int size )
+{
+	const unsigned char* src= static_cast<const unsigned char*>(data);
+	unsigned int written= 0;
+	while( written < size )
+	{
+		const ssize_t result= ::pwrite( file_descriptor_, src + written, size - written, offset + written );
+		if( result <= 0 )
+			return false;
+		written+= (unsigned int)result;
+	}
+
+	if( offset + size > size_ )
+	{
+		size_= offset + size;
+		if( size_ > mapped_size_ )
+			return Remap();
+	}
+	return true;
+}
+
+bool h_MappedFile::FlushData()
+{
+	return ::fdatasync( file_descriptor_ ) == 0;
+}
+
+bool h_MappedFile::AtomicReplaceFile( const std::string& src, const std::string& dst )
+{
+	if( WritesLimitReached() )
+		return true;
+
+	if( std::rename( src.c_str(), dst.c_str() ) != 0 )
+		return false;
+
+	// Flush directory, for rename persistence.
+	const size_t slash_pos= dst.find_last_of( '/' );
+	const std::string directory= slash_pos == std::string::npos ? "." : dst.substr( 0, slash_pos );
+	const int directory_descriptor= ::open( directory.c_str(), O_RDONLY );
+	if( directory_descriptor != -1 )
+	{
+		::fsync( directory_descriptor );
+		::close( directory_descriptor );
+	}
+	return true;
+}
+
+bool h_MappedFile::Map()
+{
+	if( size_ == 0 )
+		return true;
+
+	const unsigned int mapping_size= ( size_ + g_mapping_granularity - 1u ) / g_mapping_granularity * g_mapping_granularity;
+
+	void* const mapping= ::mmap( nullptr, mapping_size, PROT_READ, MAP_SHARED, file_descriptor_, 0 );
+	if( mapping == MAP_FAILED )
+		return false;
+
+	data_= static_cast<unsigned char*>(mapping);
+	mapped_size_= mapping_size;
+	return true;
+}
+
+void h_MappedFile::Unmap()
+{
+	if( data_ != nullptr )
+		::munmap( data_, mapped_size_ );
+
+	data_= nullptr;
+	mapped_size_= 0;
+}
+
+bool h_MappedFile::Remap()
+{
+	if( data_ != nullptr )
+	{
+		OldMapping old_mapping;
+		old_mapping.data= data_;
+		old_mapping.size= mapped_size_;
+		old_mappings_.push_back( old_mapping );
+	}
+
+	data_= nullptr;
+	mapped_size_= 0;
+	return Map();
+}
+
+void h_MappedFile::ReleaseOldMappings()
+{
+	for( const OldMapping& old_mapping : old_mappings_ )
+		::munmap( old_mapping.data, old_mapping.size );
+	old_mappings_.clear();
+}
+
+#endif
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// File, mapped into memory for reading.
+// Writes go through file API, mapping sees them immediately.
+// Pointer, returned by "Data", can be changed after "Write", which increases file size.
+// Old pointer stays valid until "ReleaseOldMappings" call.
+class h_MappedFile final
+{
+public:
+	// Opens existing file. If "create" is true and file does not exist, creates empty file.
+	h_MappedFile( const std::string& file_name, bool create );
+	~h_MappedFile();
+
+	h_MappedFile( const h_MappedFile& )= delete;
+	h_MappedFile& operator=( const h_MappedFile& )= delete;
+
+	bool IsOpened() const;
+
+	// Returns nullptr, if file is empty.
+	const unsigned char* Data() const;
+	unsigned int Size() const;
+
+	// Returns true, if all is ok.
+	// Writing after file end increases file size.
+	bool Write( unsigned int offset, const void* data, unsigned int size );
+
+	// Flush written data to disk. Returns true, if all is ok.
+	bool Flush();
+
+	// Unmap mappings, replaced after file growth. Pointers into them become invalid.
+	void ReleaseOldMappings();
+
+	// Atomically replace "dst" file with "src" file. Returns true, if all is ok.
+	// "src" file must be flushed before replacing.
+	static bool AtomicReplaceFile( const std::string& src, const std::string& dst );
+
+	// Crash simulation for tests.
+	// After "bytes" written by all files, rest of data is not written, flushes and replaces are not performed,
+	// like process was killed. Calls return success, like nothing happened.
+	// Pass c_no_writes_limit to disable simulation.
+	static constexpr const uint64_t c_no_writes_limit= ~uint64_t(0);
+	static void SetWritesLimit( uint64_t bytes );
+
+	// Crash simulation for tests of writes ordering. Disk can persist unflushed writes in any order.
+	// After "flushes" flushes by all files, next flush is not performed and process is killed, like in "SetWritesLimit".
+	// All unflushed writes of flushed file, except last write, are lost - their data is replaced with old data.
+	// Pass c_no_writes_limit to disable simulation.
+	static void SetReorderedWritesCrash( uint64_t flushes );
+
+private:
+	// Map file with size at least "size_".
+	bool Map();
+	void Unmap();
+	// Map file again after growth. Old mapping is kept until "ReleaseOldMappings".
+	bool Remap();
+	// Write without crash simulation.
+	bool WriteData( unsigned int offset, const void* data, unsigned int size );
+	bool FlushData();
+	// Replace data of unflushed writes, except last, with old data.
+	void LoseUnflushedWrites();
+
+private:
+#ifdef _WIN32
+	void* file_handle_;
+	void* mapping_handle_;
+#else
+	int file_descriptor_;
+#endif
+	unsigned char* data_= nullptr;
+	unsigned int size_= 0;
+	unsigned int mapped_size_= 0;
+
+	struct OldMapping
+	{
+		unsigned char* data;
+		unsigned int size;
+#ifdef _WIN32
+		void* mapping_handle;
+#endif
+	};
+	std::vector<OldMapping> old_mappings_;
+
+	// Old data of writes since last flush. Saved only for reordered writes crash simulation.
+	struct UnflushedWrite
+	{
+		unsigned int offset;
+		std::vector<unsigned char> old_data;
+	};
+	std::vector<UnflushedWrite> unflushed_writes_;
+};
+
+inline bool h_MappedFile::IsOpened() const
+{
+#ifdef _WIN32
+	return file_handle_ != nullptr;
+#else
+	return file_descriptor_ != -1;
+#endif
+}
+
+inline const unsigned char* h_MappedFile::Data() const
+{
+	return data_;
+}
+
+inline unsigned int h_MappedFile::Size() const
+{
+	return size_;
+}
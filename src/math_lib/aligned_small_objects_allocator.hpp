@@ -0,0 +1,353 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#include "assert.hpp"
+
+/*
+Allocator for large amount of small objects of same type, like SmallObjectsAllocator.
+Memory blocks have power of two size and aligned to this size, so, block of object is found by masking of object address.
+Allocation and deallocation time = O(1).
+
+Blocks with free space are linked into intrusive double-linked list.
+Empty blocks are not freed immediately - allocator keeps some of them for next allocations,
+so, allocation and deallocation near block boundary does not allocate and free memory each time.
+
+Allocator is not thread safe. After allocator deletion all allocation memory will invalidated.
+*/
+
+template<class StoredType, size_t block_size_bytes= 4096u>
+class AlignedSmallObjectsAllocator
+{
+	static_assert(
+		block_size_bytes > 0 && ( block_size_bytes & ( block_size_bytes - 1u ) ) == 0,
+		"block_size_bytes must be power of two" );
+
+private:
+	struct BlockHeader
+	{
+		// All blocks list.
+		BlockHeader* prev;
+		BlockHeader* next;
+		// List of blocks with free space.
+		BlockHeader* not_full_prev;
+		BlockHeader* not_full_next;
+
+		unsigned int occupancy;
+		// Slots with index greater or equal, than this, were never used.
+		unsigned int used_slots;
+		// Head of list of freed slots.
+		unsigned int first_free_slot;
+	};
+
+	typedef typename std::conditional<
+		block_size_bytes / sizeof(StoredType) <= std::numeric_limits<unsigned short>::max(),
+		unsigned short,
+		unsigned int >::type IndexType;
+
+	// Free slot stores index of next free slot.
+	union Slot
+	{
+		IndexType next_free_slot;
+		typename std::aligned_storage< sizeof(StoredType), alignof(StoredType) >::type storage;
+	};
+
+	static constexpr size_t c_slots_offset= ( sizeof(BlockHeader) + alignof(Slot) - 1u ) / alignof(Slot) * alignof(Slot);
+
+public:
+	static constexpr size_t c_objects_per_block= ( block_size_bytes - c_slots_offset ) / sizeof(Slot);
+	static constexpr size_t c_default_max_empty_blocks= 1u;
+
+	static_assert( block_size_bytes > c_slots_offset && c_objects_per_block > 0, "block_size_bytes is too small" );
+	static_assert( alignof(Slot) <= block_size_bytes, "StoredType alignment is too big" );
+
+public:
+	AlignedSmallObjectsAllocator();
+	~AlignedSmallObjectsAllocator();
+
+	AlignedSmallObjectsAllocator( const AlignedSmallObjectsAllocator& )= delete;
+	AlignedSmallObjectsAllocator& operator=( const AlignedSmallObjectsAllocator& )= delete;
+
+	// Raw allocation, without constructor call. Use it directly for basic types, (ints, pointers, etc.).
+	StoredType* Alloc();
+
+	// Allocation with constructor call. Use for objects.
+	template<class ... Args>
+	StoredType* New( Args&& ... args );
+
+	// Raw deletion, without destructor call.
+	void Free( StoredType* p );
+
+	// Call destructor and free.
+	void Delete( StoredType* p );
+
+	// Empty blocks above this count are freed. 0 - free blocks as soon, as they become empty.
+	void SetMaxEmptyBlocks( size_t count );
+
+	size_t BlockCount() const;
+	size_t EmptyBlockCount() const;
+
+private:
+	static BlockHeader* GetBlock( const StoredType* p );
+	static Slot* GetSlots( BlockHeader* block );
+
+	BlockHeader* AllocateBlock();
+	void FreeBlock( BlockHeader* block );
+	void FreeExtraEmptyBlocks();
+
+	void LinkNotFull( BlockHeader* block );
+	void UnlinkNotFull( BlockHeader* block );
+
+private:
+	static constexpr IndexType c_no_slot= std::numeric_limits<IndexType>::max();
+	static_assert( c_objects_per_block < c_no_slot, "Too many objects per block" );
+
+	BlockHeader* blocks_= nullptr;
+	BlockHeader* not_full_blocks_= nullptr;
+
+	size_t block_count_= 0;
+	size_t empty_block_count_= 0;
+	size_t max_empty_blocks_= c_default_max_empty_blocks;
+};
+
+template<class StoredType, size_t block_size_bytes>
+constexpr size_t AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::c_slots_offset;
+
+template<class StoredType, size_t block_size_bytes>
+constexpr size_t AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::c_objects_per_block;
+
+template<class StoredType, size_t block_size_bytes>
+constexpr size_t AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::c_default_max_empty_blocks;
+
+template<class StoredType, size_t block_size_bytes>
+constexpr typename AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::IndexType
+	AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::c_no_slot;
+
+template<class StoredType, size_t block_size_bytes>
+AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::AlignedSmallObjectsAllocator()
+{}
+
+template<class StoredType, size_t block_size_bytes>
+AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::~AlignedSmallObjectsAllocator()
+{
+	while( blocks_ != nullptr )
+	{
+		BlockHeader* const next= blocks_->next;
+		FreeBlock( blocks_ );
+		blocks_= next;
+	}
+}
+
+template<class StoredType, size_t block_size_bytes>
+StoredType* AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::Alloc()
+{
+	BlockHeader* block= not_full_blocks_;
+	if( block == nullptr )
+	{
+		block= AllocateBlock();
+		LinkNotFull( block );
+	}
+
+	Slot* const slots= GetSlots( block );
+
+	Slot* slot;
+	if( block->first_free_slot != c_no_slot )
+	{
+		slot= slots + block->first_free_slot;
+		block->first_free_slot= slot->next_free_slot;
+	}
+	else
+	{
+		H_ASSERT( block->used_slots < c_objects_per_block );
+		slot= slots + block->used_slots;
+		block->used_slots++;
+	}
+
+	if( block->occupancy == 0 )
+		empty_block_count_--;
+	block->occupancy++;
+	if( block->occupancy == c_objects_per_block )
+		UnlinkNotFull( block );
+
+	return reinterpret_cast<StoredType*>( slot );
+}
+
+template<class StoredType, size_t block_size_bytes>
+template<class ... Args>
+StoredType* AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::New( Args&& ... args )
+{
+	StoredType* const p= Alloc();
+	new(p) StoredType( std::forward<Args>(args)... );
+	return p;
+}
+
+template<class StoredType, size_t block_size_bytes>
+void AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::Free( StoredType* const p )
+{
+	BlockHeader* const block= GetBlock( p );
+	Slot* const slot= reinterpret_cast<Slot*>( p );
+	const size_t slot_index= size_t( slot - GetSlots( block ) );
+
+	H_ASSERT( block->occupancy > 0 );
+	H_ASSERT( slot_index < block->used_slots );
+	H_ASSERT( reinterpret_cast<unsigned char*>( GetSlots( block ) + slot_index ) == reinterpret_cast<unsigned char*>(p) );
+
+	// Add this slot to free slots list head.
+	slot->next_free_slot= IndexType( block->first_free_slot );
+	block->first_free_slot= (unsigned int)slot_index;
+
+	// Block was full - return it to list of blocks with free space.
+	if( block->occupancy == c_objects_per_block )
+		LinkNotFull( block );
+
+	block->occupancy--;
+	if( block->occupancy == 0 )
+	{
+		empty_block_count_++;
+		if( empty_block_count_ > max_empty_blocks_ )
+		{
+			UnlinkNotFull( block );
+			FreeBlock( block );
+		}
+	}
+}
+
+template<class StoredType, size_t block_size_bytes>
+void AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::Delete( StoredType* const p )
+{
+	p->~StoredType();
+	Free(p);
+}
+
+template<class StoredType, size_t block_size_bytes>
+void AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::SetMaxEmptyBlocks( const size_t count )
+{
+	max_empty_blocks_= count;
+	FreeExtraEmptyBlocks();
+}
+
+template<class StoredType, size_t block_size_bytes>
+size_t AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::BlockCount() const
+{
+	return block_count_;
+}
+
+template<class StoredType, size_t block_size_bytes>
+size_t AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::EmptyBlockCount() const
+{
+	return empty_block_count_;
+}
+
+template<class StoredType, size_t block_size_bytes>
+typename AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::BlockHeader*
+	AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::GetBlock( const StoredType* const p )
+{
+	return reinterpret_cast<BlockHeader*>( reinterpret_cast<uintptr_t>(p) & ~uintptr_t( block_size_bytes - 1u ) );
+}
+
+template<class StoredType, size_t block_size_bytes>
+typename AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::Slot*
+	AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::GetSlots( BlockHeader* const block )
+{
+	return reinterpret_cast<Slot*>( reinterpret_cast<unsigned char*>(block) + c_slots_offset );
+}
+
+template<class StoredType, size_t block_size_bytes>
+typename AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::BlockHeader*
+	AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::AllocateBlock()
+{
+	void* memory;
+#ifdef _WIN32
+	memory= _aligned_malloc( block_size_bytes, block_size_bytes );
+#else
+	if( posix_memalign( &memory, block_size_bytes, block_size_bytes ) != 0 )
+		memory= nullptr;
+#endif
+	if( memory == nullptr )
+		throw std::bad_alloc();
+
+	BlockHeader* const block= static_cast<BlockHeader*>(memory);
+	block->prev= nullptr;
+	block->next= blocks_;
+	if( blocks_ != nullptr )
+		blocks_->prev= block;
+	blocks_= block;
+
+	block->not_full_prev= block->not_full_next= nullptr;
+	block->occupancy= 0;
+	block->used_slots= 0;
+	block->first_free_slot= c_no_slot;
+
+	block_count_++;
+	empty_block_count_++;
+	return block;
+}
+
+template<class StoredType, size_t block_size_bytes>
+void AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::FreeBlock( BlockHeader* const block )
+{
+	if( block->occupancy == 0 )
+		empty_block_count_--;
+	block_count_--;
+
+	if( block->prev != nullptr )
+		block->prev->next= block->next;
+	else
+		blocks_= block->next;
+	if( block->next != nullptr )
+		block->next->prev= block->prev;
+
+#ifdef _WIN32
+	_aligned_free( block );
+#else
+	std::free( block );
+#endif
+}
+
+template<class StoredType, size_t block_size_bytes>
+void AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::FreeExtraEmptyBlocks()
+{
+	BlockHeader* block= not_full_blocks_;
+	while( block != nullptr && empty_block_count_ > max_empty_blocks_ )
+	{
+		BlockHeader* const next= block->not_full_next;
+		if( block->occupancy == 0 )
+		{
+			UnlinkNotFull( block );
+			FreeBlock( block );
+		}
+		block= next;
+	}
+}
+
+template<class StoredType, size_t block_size_bytes>
+void AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::LinkNotFull( BlockHeader* const block )
+{
+	block->not_full_prev= nullptr;
+	block->not_full_next= not_full_blocks_;
+	if( not_full_blocks_ != nullptr )
+		not_full_blocks_->not_full_prev= block;
+	not_full_blocks_= block;
+}
+
+template<class StoredType, size_t block_size_bytes>
+void AlignedSmallObjectsAllocator<StoredType, block_size_bytes>::UnlinkNotFull( BlockHeader* const block )
+{
+	if( block->not_full_prev != nullptr )
+		block->not_full_prev->not_full_next= block->not_full_next;
+	else
+		not_full_blocks_= block->not_full_next;
+	if( block->not_full_next != nullptr )
+		block->not_full_next->not_full_prev= block->not_full_prev;
+
+	block->not_full_prev= block->not_full_next= nullptr;
+}
@@ -8,11 +8,12 @@
 #include "assert.hpp"
 
 /*
-Simple binary three with external storage for internal structures.
+Red-black tree with external storage for internal structures.
 Does not perform any memory allocation.
 Because storage for internal structures and stored data provides user, cantainer does not deallocate any data on destruction.
 
-UNFINISHED - you can add some members, if you need.
+Insertion, erasing and search time = O(log(n)), even for ordered insertion.
+Nodes are never moved or copied, so, iterators stay valid until erasing of node.
 */
 
 template<class T>
@@ -30,6 +31,7 @@ typedef T StoredType;
 		Node* left;
 		Node* right;
 		StoredType value;
+		bool red;
 	};
 
 	class iterator
@@ -47,12 +49,12 @@ typedef T StoredType;
 			return *this;
 		}
 
-		bool operator==(const iterator& other)
+		bool operator==(const iterator& other) const
 		{
 			return p == other.p;
 		}
 
-		bool operator!=(const iterator& other)
+		bool operator!=(const iterator& other) const
 		{
 			return !( *this == other);
 		}
@@ -74,8 +76,14 @@ typedef T StoredType;
 			}
 			else
 			{
-				const StoredType& v= p->value;
-				while( p && p->value <= v ) p= p->parent;
+				// Go up, until we come from left subtree.
+				Node* child= p;
+				p= p->parent;
+				while( p && child == p->right )
+				{
+					child= p;
+					p= p->parent;
+				}
 			}
 		}
 
@@ -126,10 +134,9 @@ public:
 		return iterator(nullptr);
 	}
 
+	// Returns end(), if value already exists.
 	iterator insert(Node* node, const StoredType& v)
 	{
-		size_++;
-
 		Node* p= root_;
 		Node* p_parent= nullptr;
 		while(p)
@@ -150,9 +157,11 @@ public:
 		node->parent= p_parent;
 		node->left= node->right= nullptr;
 		node->value= v;
+		node->red= true;
 
-		CheckSize();
+		InsertFixup(node);
 
+		size_++;
 		return iterator(node);
 	}
 
@@ -163,79 +172,76 @@ public:
 
 		size_--;
 
-		Node* deleted_parent= it.p->parent;
+		Node* const z= it.p;
+
+		// Node, which takes place of erased node, and its new parent.
+		Node* x;
+		Node* x_parent;
+		bool removed_red;
 
-		if( !it.p->left && !it.p->right) // leaf
+		if( !z->left || !z->right )
 		{
-			if(deleted_parent)
-			{
-				if( deleted_parent->right == it.p ) deleted_parent->right= nullptr;
-				else deleted_parent->left= nullptr;
-			}
-			else
-			{
-				H_ASSERT(it.p == root_);
-				root_= nullptr;
-			}
+			x= z->left ? z->left : z->right;
+			x_parent= z->parent;
+			removed_red= z->red;
+			Replace( z, x );
 		}
-		else if( it.p->left ) // left, and, maybe, right exist
+		else
 		{
-			// move left pointer to parent
-			if( deleted_parent )
-			{
-				if( deleted_parent->right == it.p ) deleted_parent->right= it.p->left;
-				else deleted_parent->left= it.p->left;
-			}
+			// Two children - move in-order successor to place of erased node.
+			Node* y= z->right;
+			while( y->left ) y= y->left;
+
+			removed_red= y->red;
+			x= y->right;
+
+			if( y->parent == z )
+				x_parent= y;
 			else
 			{
-				H_ASSERT(it.p == root_);
-				root_= it.p->left;
+				x_parent= y->parent;
+				Replace( y, x );
+				y->right= z->right;
+				y->right->parent= y;
 			}
-			it.p->left->parent= deleted_parent;
 
-			if( it.p->right )
-			{
-				Node* most_right= it.p->left;
-				while(1)
-				{
-					if(most_right->right == nullptr)
-					{
-						most_right->right= it.p->right;
-						it.p->right->parent= most_right;
-						goto erase_end;
-					}
-					most_right= most_right->right;
-				}
-			}
-		} // if( it.p->left )
-		else // only right
-		{
-			H_ASSERT(it.p->right);
+			Replace( z, y );
+			y->left= z->left;
+			y->left->parent= y;
+			y->red= z->red;
+		}
 
-			if( deleted_parent )
-			{
-				if( deleted_parent->right == it.p ) deleted_parent->right= it.p->right;
-				else deleted_parent->left= it.p->right;
-				it.p->right->parent= deleted_parent;
-			}
+		if( !removed_red )
+			EraseFixup( x, x_parent );
+	}
+
+	iterator find_nearest_less_or_equal(const StoredType& v)
+	{
+		Node* p= root_;
+		Node* result= nullptr;
+		while(p)
+		{
+			if( v < p->value ) p= p->left;
 			else
 			{
-				H_ASSERT(it.p == root_);
-				root_= it.p->right;
-				root_->parent= nullptr;
+				result= p;
+				if( v == p->value ) break;
+				p= p->right;
 			}
 		}
-
-		erase_end:
-		CheckSize();
+		return iterator(result);
 	}
 
-	iterator find_nearest_less_or_equal(const StoredType& v)
+	// Check order, links and red-black tree properties. Complexity - O(n).
+	bool CheckTree() const
 	{
-		if( !root_ ) return iterator(nullptr);
+		if( !root_ ) return size_ == 0;
+		if( root_->parent || root_->red ) return false;
 
-		return find_nearest_less_or_equal_r(root_, v);
+		size_t count= 0;
+		return CheckTree_r(root_, &count) > 0 && count == size_;
 	}
+
 #ifdef DEBUG
 	void Print() const
 	{
@@ -250,49 +256,184 @@ private:
 		if (n->left) Print_r(n->left, depth + 1);
 		for( int i = 0; i < depth*2; i++ )
 			std::cout<<"-";
-		std::cout<<" "<<reinterpret_cast<unsigned int>(n->value)<<std::endl;
+		std::cout<<" "<<n->value<<( n->red ? " r" : " b" )<<std::endl;
 
 		if (n->right) Print_r(n->right, depth + 1);
 	}
 #endif
 
-	void CheckSize()
+	// Returns black height of subtree, or 0, if subtree is broken.
+	size_t CheckTree_r(const Node* n, size_t* count) const
 	{
-		if( root_ )
-		{
-			H_ASSERT(GetSize_r(root_) == size_);
-		}
+		if( !n ) return 1;
+
+		(*count)++;
+
+		if( n->left  && ( n->left ->parent != n || !( n->left->value < n->value ) ) ) return 0;
+		if( n->right && ( n->right->parent != n || !( n->value < n->right->value ) ) ) return 0;
+		if( n->red && ( ( n->left && n->left->red ) || ( n->right && n->right->red ) ) ) return 0;
+
+		const size_t left_height = CheckTree_r(n->left , count);
+		const size_t right_height= CheckTree_r(n->right, count);
+		if( left_height == 0 || left_height != right_height ) return 0;
+
+		return left_height + ( n->red ? 0 : 1 );
 	}
 
-	size_t GetSize_r(Node* n)
+	static bool IsRed(const Node* n)
 	{
-		size_t s= 1;
-		if( n->left  ) s+= GetSize_r(n->left );
-		if( n->right ) s+= GetSize_r(n->right);
-		return s;
+		return n && n->red;
 	}
 
-	iterator find_nearest_less_or_equal_r(Node* n, const StoredType& v)
+	// Put "replacement" to place of "n" in parent of "n". "replacement" may be null.
+	void Replace(Node* n, Node* replacement)
 	{
-		next_iteration:
-		if( n->value > v )
+		if( !n->parent ) root_= replacement;
+		else if( n == n->parent->left ) n->parent->left= replacement;
+		else n->parent->right= replacement;
+
+		if( replacement ) replacement->parent= n->parent;
+	}
+
+	void RotateLeft(Node* n)
+	{
+		Node* const r= n->right;
+		n->right= r->left;
+		if( r->left ) r->left->parent= n;
+		Replace( n, r );
+		r->left= n;
+		n->parent= r;
+	}
+
+	void RotateRight(Node* n)
+	{
+		Node* const l= n->left;
+		n->left= l->right;
+		if( l->right ) l->right->parent= n;
+		Replace( n, l );
+		l->right= n;
+		n->parent= l;
+	}
+
+	void InsertFixup(Node* n)
+	{
+		while( IsRed(n->parent) )
 		{
-			if( n->left )
+			Node* parent= n->parent;
+			// Parent is red, so, it is not root, and grandparent exists.
+			Node* const grandparent= parent->parent;
+
+			if( parent == grandparent->left )
 			{
-				n= n->left;
-				goto next_iteration;
+				Node* const uncle= grandparent->right;
+				if( IsRed(uncle) )
+				{
+					parent->red= uncle->red= false;
+					grandparent->red= true;
+					n= grandparent;
+					continue;
+				}
+				if( n == parent->right )
+				{
+					RotateLeft(parent);
+					n= parent;
+					parent= n->parent;
+				}
+				parent->red= false;
+				grandparent->red= true;
+				RotateRight(grandparent);
+			}
+			else
+			{
+				Node* const uncle= grandparent->left;
+				if( IsRed(uncle) )
+				{
+					parent->red= uncle->red= false;
+					grandparent->red= true;
+					n= grandparent;
+					continue;
+				}
+				if( n == parent->left )
+				{
+					RotateRight(parent);
+					n= parent;
+					parent= n->parent;
+				}
+				parent->red= false;
+				grandparent->red= true;
+				RotateLeft(grandparent);
 			}
-			else return iterator(nullptr);
 		}
+		root_->red= false;
+	}
 
-		if( n->value == v ) return iterator(n);
-
-		if( n->right )
+	// "n" has extra black. "n" may be null, so, parent passed separately.
+	void EraseFixup(Node* n, Node* parent)
+	{
+		while( n != root_ && !IsRed(n) )
 		{
-			iterator c= find_nearest_less_or_equal_r(n->right, v);
-			if(c.p) return c;
+			if( n == parent->left )
+			{
+				Node* sibling= parent->right;
+				if( IsRed(sibling) )
+				{
+					sibling->red= false;
+					parent->red= true;
+					RotateLeft(parent);
+					sibling= parent->right;
+				}
+				if( !IsRed(sibling->left) && !IsRed(sibling->right) )
+				{
+					sibling->red= true;
+					n= parent;
+					parent= n->parent;
+					continue;
+				}
+				if( !IsRed(sibling->right) )
+				{
+					sibling->left->red= false;
+					sibling->red= true;
+					RotateRight(sibling);
+					sibling= parent->right;
+				}
+				sibling->red= parent->red;
+				parent->red= false;
+				sibling->right->red= false;
+				RotateLeft(parent);
+				n= root_;
+			}
+			else
+			{
+				Node* sibling= parent->left;
+				if( IsRed(sibling) )
+				{
+					sibling->red= false;
+					parent->red= true;
+					RotateRight(parent);
+					sibling= parent->left;
+				}
+				if( !IsRed(sibling->left) && !IsRed(sibling->right) )
+				{
+					sibling->red= true;
+					n= parent;
+					parent= n->parent;
+					continue;
+				}
+				if( !IsRed(sibling->left) )
+				{
+					sibling->right->red= false;
+					sibling->red= true;
+					RotateLeft(sibling);
+					sibling= parent->left;
+				}
+				sibling->red= parent->red;
+				parent->red= false;
+				sibling->left->red= false;
+				RotateRight(parent);
+				n= root_;
+			}
 		}
-		return iterator(n);
+		if( n ) n->red= false;
 	}
 
 private:
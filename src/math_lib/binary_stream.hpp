@@ -15,7 +15,8 @@ typedef std::vector<unsigned char> h_BinaryStorage;
 class h_BinaryOuptutStream
 {
 public:
-	// Storage cleared after stream constuction.
+	// Storage cleared after stream constuction, but its capacity is kept.
+	// Reuse same storage for many streams to avoid allocations.
 	explicit h_BinaryOuptutStream( h_BinaryStorage& storage )
 		: storage_(storage)
 	{
@@ -27,12 +28,39 @@ public:
 	{
 		static_assert( std::is_fundamental<T>::value, "Stream supports only fundamental types" );
 
-		storage_.resize( storage_.size() + sizeof(T) );
-		std::memcpy( storage_.data() + storage_.size() - sizeof(T), &t, sizeof(T) );
-
+		Write( &t, sizeof(T) );
 		return *this;
 	}
 
+	template<class T>
+	void WriteArray( const T* const data, const size_t count )
+	{
+		static_assert( std::is_fundamental<T>::value, "Stream supports only fundamental types" );
+
+		Write( data, count * sizeof(T) );
+	}
+
+	void Write( const void* const data, const size_t size )
+	{
+		const size_t new_size= storage_.size() + size;
+		if( new_size > storage_.capacity() )
+			Grow( new_size );
+
+		const unsigned char* const bytes= static_cast<const unsigned char*>(data);
+		storage_.insert( storage_.end(), bytes, bytes + size );
+	}
+
+private:
+	void Grow( const size_t required_size )
+	{
+		const size_t c_min_capacity= 256u;
+
+		size_t new_capacity= storage_.capacity() < c_min_capacity ? c_min_capacity : storage_.capacity();
+		while( new_capacity < required_size )
+			new_capacity*= 2u;
+		storage_.reserve( new_capacity );
+	}
+
 private:
 	h_BinaryStorage& storage_;
 };
@@ -57,6 +85,22 @@ public:
 		return *this;
 	}
 
+	template<class T>
+	void ReadArray( T* const out_data, const size_t count )
+	{
+		static_assert( std::is_fundamental<T>::value, "Stream supports only fundamental types" );
+
+		H_ASSERT( count * sizeof(T) + pos_ <= storage_.size() );
+		std::memcpy( out_data, storage_.data() + pos_, count * sizeof(T) );
+		pos_+= count * sizeof(T);
+	}
+
+	void Skip( size_t size )
+	{
+		H_ASSERT( pos_ + size <= storage_.size() );
+		pos_+= size;
+	}
+
 private:
 	const h_BinaryStorage& storage_;
 	size_t pos_;
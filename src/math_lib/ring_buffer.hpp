@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "assert.hpp"
+
+/*
+FIFO queue on top of ring buffer.
+Storage grows, when buffer is full, and never shrinks, so, after warm-up queue does not perform memory allocations.
+T must be default-constructible and copyable.
+*/
+
+template<class T>
+class RingBuffer
+{
+public:
+	typedef T StoredType;
+
+public:
+	RingBuffer();
+
+	size_t size() const;
+	bool empty() const;
+
+	void push_back( const StoredType& v );
+	StoredType pop_front();
+	void clear();
+
+private:
+	void grow();
+
+private:
+	// Size is always power of two.
+	std::vector<StoredType> data_;
+	size_t head_;
+	size_t size_;
+};
+
+template<class T>
+RingBuffer<T>::RingBuffer()
+	: data_(64)
+	, head_(0)
+	, size_(0)
+{}
+
+template<class T>
+size_t RingBuffer<T>::size() const
+{
+	return size_;
+}
+
+template<class T>
+bool RingBuffer<T>::empty() const
+{
+	return size_ == 0;
+}
+
+template<class T>
+void RingBuffer<T>::push_back( const StoredType& v )
+{
+	if( size_ == data_.size() )
+		grow();
+
+	data_[ ( head_ + size_ ) & ( data_.size() - 1 ) ]= v;
+	size_++;
+}
+
+template<class T>
+typename RingBuffer<T>::StoredType RingBuffer<T>::pop_front()
+{
+	H_ASSERT( size_ > 0 );
+
+	const StoredType result= data_[ head_ ];
+	head_= ( head_ + 1 ) & ( data_.size() - 1 );
+	size_--;
+	return result;
+}
+
+template<class T>
+void RingBuffer<T>::clear()
+{
+	head_= 0;
+	size_= 0;
+}
+
+template<class T>
+void RingBuffer<T>::grow()
+{
+	std::vector<StoredType> new_data( data_.size() * 2 );
+	for( size_t i= 0; i < size_; i++ )
+		new_data[i]= data_[ ( head_ + i ) & ( data_.size() - 1 ) ];
+
+	data_.swap( new_data );
+	head_= 0;
+}
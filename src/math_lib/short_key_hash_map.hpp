@@ -0,0 +1,208 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "assert.hpp"
+
+/*
+Hash map with unsigned short keys.
+Open addressing with linear probing. Keys are stored in separate array, so, probe sequence usually touches one cache line.
+Map grows, when it is filled by 3/4, and never shrinks.
+Key 65535 is reserved for empty cells.
+T must be default-constructible and copyable.
+*/
+
+template<class T>
+class ShortKeyHashMap
+{
+public:
+	typedef unsigned short KeyType;
+	typedef T StoredType;
+
+	static constexpr KeyType c_empty_key= 65535;
+
+public:
+	ShortKeyHashMap();
+
+	size_t size() const;
+	bool empty() const;
+
+	// Returns nullptr, if there is no value for key.
+	StoredType* find( KeyType key );
+	const StoredType* find( KeyType key ) const;
+
+	// Insert value or replace old value for same key.
+	void insert( KeyType key, const StoredType& value );
+	// Returns false, if there was no value for key.
+	bool erase( KeyType key );
+	void clear();
+
+	// Call func( key, value ) for all values.
+	template<class Func>
+	void for_each( const Func& func ) const;
+
+private:
+	size_t home_index( KeyType key ) const;
+	size_t find_index( KeyType key ) const;
+	void rehash( size_t new_capacity );
+
+private:
+	// Size of arrays is always power of two.
+	std::vector<KeyType> keys_;
+	std::vector<StoredType> values_;
+	unsigned int capacity_log2_;
+	size_t size_;
+};
+
+template<class T>
+constexpr typename ShortKeyHashMap<T>::KeyType ShortKeyHashMap<T>::c_empty_key;
+
+template<class T>
+ShortKeyHashMap<T>::ShortKeyHashMap()
+	: keys_( 16, c_empty_key )
+	, values_( 16 )
+	, capacity_log2_(4)
+	, size_(0)
+{}
+
+template<class T>
+size_t ShortKeyHashMap<T>::size() const
+{
+	return size_;
+}
+
+template<class T>
+bool ShortKeyHashMap<T>::empty() const
+{
+	return size_ == 0;
+}
+
+template<class T>
+typename ShortKeyHashMap<T>::StoredType* ShortKeyHashMap<T>::find( const KeyType key )
+{
+	const size_t index= find_index( key );
+	return index == keys_.size() ? nullptr : &values_[index];
+}
+
+template<class T>
+const typename ShortKeyHashMap<T>::StoredType* ShortKeyHashMap<T>::find( const KeyType key ) const
+{
+	const size_t index= find_index( key );
+	return index == keys_.size() ? nullptr : &values_[index];
+}
+
+template<class T>
+void ShortKeyHashMap<T>::insert( const KeyType key, const StoredType& value )
+{
+	H_ASSERT( key != c_empty_key );
+
+	if( ( size_ + 1 ) * 4 > keys_.size() * 3 )
+		rehash( keys_.size() * 2 );
+
+	const size_t mask= keys_.size() - 1;
+	size_t index= home_index( key );
+	while( keys_[index] != c_empty_key )
+	{
+		if( keys_[index] == key )
+		{
+			values_[index]= value;
+			return;
+		}
+		index= ( index + 1 ) & mask;
+	}
+
+	keys_[index]= key;
+	values_[index]= value;
+	size_++;
+}
+
+template<class T>
+bool ShortKeyHashMap<T>::erase( const KeyType key )
+{
+	size_t index= find_index( key );
+	if( index == keys_.size() )
+		return false;
+
+	// Shift back following elements of probe sequence, instead of placing of "deleted" marks.
+	const size_t mask= keys_.size() - 1;
+	size_t next_index= index;
+	while(true)
+	{
+		next_index= ( next_index + 1 ) & mask;
+		if( keys_[next_index] == c_empty_key )
+			break;
+
+		// Element can be moved, if its home index is not in cyclic range ( index; next_index ].
+		const size_t home= home_index( keys_[next_index] );
+		if( ( ( next_index - home ) & mask ) >= ( ( next_index - index ) & mask ) )
+		{
+			keys_[index]= keys_[next_index];
+			values_[index]= values_[next_index];
+			index= next_index;
+		}
+	}
+
+	keys_[index]= c_empty_key;
+	values_[index]= StoredType();
+	size_--;
+	return true;
+}
+
+template<class T>
+void ShortKeyHashMap<T>::clear()
+{
+	for( size_t i= 0; i < keys_.size(); i++ )
+	{
+		keys_[i]= c_empty_key;
+		values_[i]= StoredType();
+	}
+	size_= 0;
+}
+
+template<class T>
+template<class Func>
+void ShortKeyHashMap<T>::for_each( const Func& func ) const
+{
+	for( size_t i= 0; i < keys_.size(); i++ )
+		if( keys_[i] != c_empty_key )
+			func( keys_[i], values_[i] );
+}
+
+template<class T>
+size_t ShortKeyHashMap<T>::home_index( const KeyType key ) const
+{
+	// Fibonacci hashing - take high bits of product.
+	return size_t( ( (unsigned int)key * 2654435769u ) >> ( 32u - capacity_log2_ ) );
+}
+
+template<class T>
+size_t ShortKeyHashMap<T>::find_index( const KeyType key ) const
+{
+	const size_t mask= keys_.size() - 1;
+	size_t index= home_index( key );
+	while( keys_[index] != c_empty_key )
+	{
+		if( keys_[index] == key )
+			return index;
+		index= ( index + 1 ) & mask;
+	}
+	return keys_.size();
+}
+
+template<class T>
+void ShortKeyHashMap<T>::rehash( const size_t new_capacity )
+{
+	std::vector<KeyType> old_keys( new_capacity, c_empty_key );
+	std::vector<StoredType> old_values( new_capacity );
+	old_keys.swap( keys_ );
+	old_values.swap( values_ );
+
+	while( ( size_t(1) << capacity_log2_ ) < new_capacity )
+		capacity_log2_++;
+	H_ASSERT( ( size_t(1) << capacity_log2_ ) == new_capacity );
+
+	size_= 0;
+	for( size_t i= 0; i < old_keys.size(); i++ )
+		if( old_keys[i] != c_empty_key )
+			insert( old_keys[i], old_values[i] );
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Number of threads, used by hParallelFor for given count of iterations.
+inline unsigned int hParallelForThreadCount( const unsigned int count )
+{
+	return std::max( std::min( std::thread::hardware_concurrency(), count ), 1u );
+}
+
+// Calls "func( i, thread_index )" for each i in range [0; count) in all hardware threads.
+// thread_index is in range [0; hParallelForThreadCount(count) ), use it for per-thread data.
+// Calling thread takes part in work too, it has thread_index 0.
+// Order of calls is not specified. Returns, when all calls are finished.
+template<class Func>
+void hParallelFor( const unsigned int count, const Func& func )
+{
+	std::atomic<unsigned int> next_index{ 0 };
+	const auto thread_func=
+	[&]( const unsigned int thread_index )
+	{
+		while(true)
+		{
+			const unsigned int i= next_index++;
+			if( i >= count )
+				break;
+			func( i, thread_index );
+		}
+	};
+
+	const unsigned int thread_count= hParallelForThreadCount( count );
+
+	std::vector<std::thread> threads;
+	for( unsigned int i= 1; i < thread_count; i++ )
+		threads.emplace_back( thread_func, i );
+
+	thread_func( 0 );
+
+	for( std::thread& thread : threads )
+		thread.join();
+}
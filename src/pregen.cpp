@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <cstdlib>
+#include <memory>
+
+#include "console.hpp"
+#include "settings.hpp"
+#include "world.hpp"
+#include "world_header.hpp"
+
+// Offline world pre-generation.
+// Usage: HexPregen world_directory longitude_min latitude_min longitude_max latitude_max
+// Coordinates - chunk coordinates, bounds are inclusive.
+int main( int argc, char* argv[] )
+{
+	std::setlocale( LC_NUMERIC, "C" );
+
+	if( argc < 6 )
+	{
+		h_Console::Error( "Usage: HexPregen world_directory longitude_min latitude_min longitude_max latitude_max" );
+		return 1;
+	}
+
+	const char* const world_directory= argv[1];
+	const int longitude_min= std::atoi( argv[2] );
+	const int latitude_min = std::atoi( argv[3] );
+	const int longitude_max= std::atoi( argv[4] );
+	const int latitude_max = std::atoi( argv[5] );
+
+	// Use same settings, as game, so, chunks are saved with same codec.
+	const h_SettingsPtr settings= std::make_shared<h_Settings>( "config.json" );
+
+	const h_WorldHeaderPtr world_header= std::make_shared<h_WorldHeader>();
+	world_header->Load( world_directory );
+
+	h_World world( []( float ) {}, settings, world_header, world_directory );
+
+	h_Console::Info(
+		"Generating chunks ",
+		longitude_min, " ", latitude_min, " - ", longitude_max, " ", latitude_max );
+
+	const auto start_time= std::chrono::steady_clock::now();
+	const unsigned int generated_chunks=
+		world.PregenerateChunks( longitude_min, latitude_min, longitude_max, latitude_max );
+	const double time_s= std::chrono::duration<double>( std::chrono::steady_clock::now() - start_time ).count();
+
+	h_Console::Info(
+		"Generated ", generated_chunks, " chunks in ", time_s, " s, ",
+		double(generated_chunks) / std::max( time_s, 0.001 ), " chunks/s" );
+
+	return 0;
+}
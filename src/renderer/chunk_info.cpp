@@ -1,16 +1,96 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
 #include "../world.hpp"
 
 #include "chunk_info.hpp"
 #include "texture_manager.hpp"
 #include "rendering_constants.hpp"
 
+static void SetVertexLight( r_WorldVertex& v, const unsigned char* const light )
+{
+	v.light[0]= light[0];
+	v.light[1]= light[1];
+}
+
+// Light of upper vertices of prisms of chunk and its border prisms.
+// Neighbor prisms share vertices, so, light of each vertex is calculated once.
+// Light is calculated by groups of vertices in column, at first access to group.
+class r_VertexLightCache
+{
+public:
+	// Coordinates of chunk - relative.
+	r_VertexLightCache( const h_World& world, const int chunk_x, const int chunk_y )
+		: world_(world)
+		, chunk_x_(chunk_x), chunk_y_(chunk_y)
+		, light_( new unsigned char[ 2 * c_columns * c_columns * c_column_size ] )
+	{
+		std::memset( calculated_groups_, 0, sizeof(calculated_groups_) );
+	}
+
+	// Light of forward-forwardright vertex. Coordinates - local, x and y in range [ -1; H_CHUNK_WIDTH - 1 ].
+	const unsigned char* Forward( const int x, const int y, const int z )
+	{
+		return Get( true, x + 1, y + 1, z );
+	}
+
+	// Light of back-backleft vertex. Coordinates - local, x and y in range [ 0; H_CHUNK_WIDTH ].
+	const unsigned char* Back( const int x, const int y, const int z )
+	{
+		return Get( false, x, y, z );
+	}
+
+private:
+	const unsigned char* Get( const bool forward, const int column_x, const int column_y, const int z )
+	{
+		H_ASSERT( column_x >= 0 && column_x < int(c_columns) );
+		H_ASSERT( column_y >= 0 && column_y < int(c_columns) );
+		H_ASSERT( z >= 0 && z < H_CHUNK_HEIGHT - 1 );
+
+		const unsigned int column= ( ( forward ? 1 : 0 ) * c_columns + column_x ) * c_columns + column_y;
+		unsigned char* const column_light= light_.get() + column * c_column_size;
+
+		const unsigned int group= z / c_group_size;
+		if( ( calculated_groups_[ column ] & ( 1 << group ) ) == 0 )
+		{
+			calculated_groups_[ column ]|= 1 << group;
+
+			// Column contains H_CHUNK_HEIGHT - 1 vertices, so, last group overlaps previous one.
+			const int z_begin= std::min( int( group * c_group_size ), H_CHUNK_HEIGHT - 1 - int(c_group_size) );
+			const int z_end= z_begin + int(c_group_size);
+			const int x= chunk_x_ + column_x - ( forward ? 1 : 0 );
+			const int y= chunk_y_ + column_y - ( forward ? 1 : 0 );
+			if( forward )
+				world_.GetForwardVertexLightColumn( x, y, z_begin, z_end, column_light + z_begin * 2 );
+			else
+				world_.GetBackVertexLightColumn( x, y, z_begin, z_end, column_light + z_begin * 2 );
+		}
+
+		return column_light + z * 2;
+	}
+
+private:
+	// Group size is same, as SIMD kernels group size.
+	static constexpr unsigned int c_group_size= 16;
+	static constexpr unsigned int c_columns= H_CHUNK_WIDTH + 1;
+	static constexpr unsigned int c_column_size= ( H_CHUNK_HEIGHT - 1 ) * 2;
+
+	const h_World& world_;
+	const int chunk_x_, chunk_y_;
+
+	// Sun and fire light of vertices. Back columns first, than forward columns.
+	const std::unique_ptr<unsigned char[]> light_;
+	unsigned char calculated_groups_[ 2 * c_columns * c_columns ];
+};
+
 static bool IsWaterBlockVisible(
 	const h_LiquidBlock* water_block,
-	const h_Block* upper_block )
+	const h_BlockType upper_block_type )
 {
 	return
-		upper_block->Type() == h_BlockType::Air ||
-		( upper_block->Type() != h_BlockType::Water && water_block->LiquidLevel() < H_MAX_WATER_LEVEL );
+		upper_block_type == h_BlockType::Air ||
+		( upper_block_type != h_BlockType::Water && water_block->LiquidLevel() < H_MAX_WATER_LEVEL );
 }
 
 r_ChunkInfo::r_ChunkInfo()
@@ -27,7 +107,7 @@ void r_ChunkInfo::GetWaterHexCount()
 
 	for( const h_LiquidBlock* b : water_block_list )
 	{
-		if( IsWaterBlockVisible( b, chunk_->GetBlock( b->x_, b->y_, b->z_ + 1 ) ) )
+		if( IsWaterBlockVisible( b, chunk_->GetBlockType( b->x_, b->y_, b->z_ + 1 ) ) )
 			hex_count++;
 	}
 
@@ -51,7 +131,7 @@ void r_ChunkInfo::BuildWaterSurfaceMesh()
 	{
 		for( const h_LiquidBlock* b : water_block_list )
 		{
-			if( IsWaterBlockVisible( b, chunk_->GetBlock( b->x_, b->y_, b->z_ + 1 ) ) )
+			if( IsWaterBlockVisible( b, chunk_->GetBlockType( b->x_, b->y_, b->z_ + 1 ) ) )
 			{
 				v[0].coord[0]= 3 * ( b->x_ + X );
 				v[1].coord[0]= v[5].coord[0]= v[0].coord[0] + 1;
@@ -98,20 +178,20 @@ void r_ChunkInfo::BuildWaterSurfaceMesh()
 							neighbors[d][1] >> H_CHUNK_WIDTH_LOG2 );
 
 					unsigned int addr= BlockAddr( local_x, local_y, b->z_ );
-					const h_Block* const b2= ch2->GetBlock( addr );
-					const h_Block* const b3= ch2->GetBlock( addr+ 1 );
+					const h_BlockType b2_type= ch2->GetBlockType( addr );
+					const h_BlockType b3_type= ch2->GetBlockType( addr+ 1 );
 
 					static const unsigned int c_next_vi[6]= { 1, 2, 3, 4, 5, 0 };
 					const unsigned int vi0= d;
 					const unsigned int vi1= c_next_vi[d];
 
-					if( b3->Type() == h_BlockType::Water )
+					if( b3_type == h_BlockType::Water )
 						upper_block_is_water[vi0]= upper_block_is_water[vi1]= true;
-					else if( b2->Type() == h_BlockType::Air )
+					else if( b2_type == h_BlockType::Air )
 						nearby_block_is_air[vi0]= nearby_block_is_air[vi1]= true;
-					else if( b2->Type() == h_BlockType::Water )
+					else if( b2_type == h_BlockType::Water )
 					{
-						const auto water_block= static_cast<const h_LiquidBlock*>(b2);
+						const auto water_block= static_cast<const h_LiquidBlock*>( ch2->GetBlock( addr ) );
 
 						vertex_water_level[vi0]+= water_block->LiquidLevel();
 						vertex_water_level[vi1]+= water_block->LiquidLevel();
@@ -163,7 +243,7 @@ void r_ChunkInfo::BuildWaterSurfaceMesh()
 	{
 		for( const h_LiquidBlock* b : water_block_list )
 		{
-			if( IsWaterBlockVisible( b, chunk_->GetBlock( b->x_, b->y_, b->z_ + 1 ) ) )
+			if( IsWaterBlockVisible( b, chunk_->GetBlockType( b->x_, b->y_, b->z_ + 1 ) ) )
 			{
 				v[0].coord[0]= 3 * ( b->x_ + X );
 				v[1].coord[0]= v[5].coord[0]= v[0].coord[0] + 1;
@@ -395,6 +475,8 @@ void r_ChunkInfo::BuildChunkMesh()
 
 	const bool flat_lighting= chunk_->IsEdgeChunk();
 
+	r_VertexLightCache vertex_light( world, relative_X, relative_Y );
+
 	for( int x= 0; x< H_CHUNK_WIDTH; x++ )
 	for( int y= 0; y< H_CHUNK_WIDTH; y++ )
 	{
@@ -402,27 +484,23 @@ void r_ChunkInfo::BuildChunkMesh()
 
 		offset= BlockAddr(x,y,0);
 		const unsigned char* t_p= chunk_->GetTransparencyData() + offset;
-		const h_Block* const* b_p= chunk_->GetBlocksData() + offset;
-		const unsigned char* ls_p= chunk_->GetSunLightData() + offset;
-		const unsigned char* lf_p= chunk_->GetFireLightData() + offset;
+		const unsigned short* b_p= chunk_->GetBlockIdsData() + offset;
+		const unsigned char* l_p= chunk_->GetLightData() + offset;
 
 		offset= BlockAddr(x + 1, y + (1&(x+1)),0);
 		const unsigned char* t_fr_p= chunk_->GetTransparencyData() + offset;
-		const h_Block* const* b_fr_p= chunk_->GetBlocksData() + offset;
-		const unsigned char* ls_fr_p= chunk_->GetSunLightData() + offset;
-		const unsigned char* lf_fr_p= chunk_->GetFireLightData() + offset;
+		const unsigned short* b_fr_p= chunk_->GetBlockIdsData() + offset;
+		const unsigned char* l_fr_p= chunk_->GetLightData() + offset;
 
 		offset= BlockAddr(x + 1, y - ( 1&x )  ,0);
 		const unsigned char* t_br_p= chunk_->GetTransparencyData() + offset;
-		const h_Block* const* b_br_p= chunk_->GetBlocksData() + offset;
-		const unsigned char* ls_br_p= chunk_->GetSunLightData() + offset;
-		const unsigned char* lf_br_p= chunk_->GetFireLightData() + offset;
+		const unsigned short* b_br_p= chunk_->GetBlockIdsData() + offset;
+		const unsigned char* l_br_p= chunk_->GetLightData() + offset;
 
 		offset= BlockAddr(x,y+1,0);
 		const unsigned char* t_f_p= chunk_->GetTransparencyData() + offset;
-		const h_Block* const* b_f_p= chunk_->GetBlocksData() + offset;
-		const unsigned char* ls_f_p= chunk_->GetSunLightData() + offset;
-		const unsigned char* lf_f_p= chunk_->GetFireLightData() + offset;
+		const unsigned short* b_f_p= chunk_->GetBlockIdsData() + offset;
+		const unsigned char* l_f_p= chunk_->GetLightData() + offset;
 
 		//front chunk border
 		if( y == H_CHUNK_WIDTH - 1 && x < H_CHUNK_WIDTH - 1 )
@@ -431,9 +509,8 @@ void r_ChunkInfo::BuildChunkMesh()
 			{
 				offset= BlockAddr( x, 0, 0 );
 				t_f_p= chunk_front_->GetTransparencyData() + offset;
-				b_f_p= chunk_front_->GetBlocksData() + offset;
-				ls_f_p= chunk_front_->GetSunLightData() + offset;
-				lf_f_p= chunk_front_->GetFireLightData() + offset;
+				b_f_p= chunk_front_->GetBlockIdsData() + offset;
+				l_f_p= chunk_front_->GetLightData() + offset;
 			}
 			else
 				t_f_p= t_p;//this block transparency
@@ -442,17 +519,15 @@ void r_ChunkInfo::BuildChunkMesh()
 			{
 				offset= BlockAddr( x + 1, H_CHUNK_WIDTH - 1, 0 );
 				t_fr_p= chunk_->GetTransparencyData() + offset;
-				b_fr_p= chunk_->GetBlocksData() + offset;
-				ls_fr_p= chunk_->GetSunLightData() + offset;
-				lf_fr_p= chunk_->GetFireLightData() + offset;
+				b_fr_p= chunk_->GetBlockIdsData() + offset;
+				l_fr_p= chunk_->GetLightData() + offset;
 			}
 			else if( chunk_front_ != nullptr )
 			{
 				offset= BlockAddr( x + 1, 0, 0 );
 				t_fr_p= chunk_front_->GetTransparencyData() + offset;
-				b_fr_p= chunk_front_->GetBlocksData() + offset;
-				ls_fr_p= chunk_front_->GetSunLightData() + offset;
-				lf_fr_p= chunk_front_->GetFireLightData() + offset;
+				b_fr_p= chunk_front_->GetBlockIdsData() + offset;
+				l_fr_p= chunk_front_->GetLightData() + offset;
 			}
 			else
 				t_fr_p= t_p;//this block transparency
@@ -464,17 +539,15 @@ void r_ChunkInfo::BuildChunkMesh()
 			{
 				offset= BlockAddr( x + 1, 0, 0 );
 				t_br_p= chunk_->GetTransparencyData() + offset;
-				b_br_p= chunk_->GetBlocksData() + offset;
-				ls_br_p= chunk_->GetSunLightData() + offset;
-				lf_br_p= chunk_->GetFireLightData() + offset;
+				b_br_p= chunk_->GetBlockIdsData() + offset;
+				l_br_p= chunk_->GetLightData() + offset;
 			}
 			else if( chunk_back_ != nullptr )
 			{
 				offset= BlockAddr( x+ 1, H_CHUNK_WIDTH - 1, 0 );
 				t_br_p= chunk_back_->GetTransparencyData() + offset;
-				b_br_p= chunk_back_->GetBlocksData() + offset;
-				ls_br_p= chunk_back_->GetSunLightData() + offset;
-				lf_br_p= chunk_back_->GetFireLightData() + offset;
+				b_br_p= chunk_back_->GetBlockIdsData() + offset;
+				l_br_p= chunk_back_->GetLightData() + offset;
 			}
 			else
 				t_br_p= t_p;//this block transparency
@@ -486,15 +559,13 @@ void r_ChunkInfo::BuildChunkMesh()
 			{
 				offset= BlockAddr( 0, y, 0 );
 				t_fr_p= chunk_right_->GetTransparencyData() + offset;
-				b_fr_p= chunk_right_->GetBlocksData() + offset;
-				ls_fr_p= chunk_right_->GetSunLightData() + offset;
-				lf_fr_p= chunk_right_->GetFireLightData() + offset;
+				b_fr_p= chunk_right_->GetBlockIdsData() + offset;
+				l_fr_p= chunk_right_->GetLightData() + offset;
 
 				offset= BlockAddr( 0, y - 1, 0 );
 				t_br_p= chunk_right_->GetTransparencyData() + offset;
-				b_br_p= chunk_right_->GetBlocksData() + offset;
-				ls_br_p= chunk_right_->GetSunLightData() + offset;
-				lf_br_p= chunk_right_->GetFireLightData() + offset;
+				b_br_p= chunk_right_->GetBlockIdsData() + offset;
+				l_br_p= chunk_right_->GetLightData() + offset;
 
 			}
 			else
@@ -506,9 +577,8 @@ void r_ChunkInfo::BuildChunkMesh()
 			{
 				offset= BlockAddr( H_CHUNK_WIDTH - 1, 0, 0 );
 				t_f_p= chunk_front_->GetTransparencyData() + offset;
-				b_f_p= chunk_front_->GetBlocksData() + offset;
-				ls_f_p= chunk_front_->GetSunLightData() + offset;
-				lf_f_p= chunk_front_->GetFireLightData() + offset;
+				b_f_p= chunk_front_->GetBlockIdsData() + offset;
+				l_f_p= chunk_front_->GetLightData() + offset;
 			}
 			else
 				t_f_p= t_p;//this block transparency;
@@ -516,15 +586,13 @@ void r_ChunkInfo::BuildChunkMesh()
 			{
 				offset= BlockAddr( 0, H_CHUNK_WIDTH  - 1, 0 );
 				t_fr_p= chunk_right_->GetTransparencyData() + offset;
-				b_fr_p= chunk_right_->GetBlocksData() + offset;
-				ls_fr_p= chunk_right_->GetSunLightData() + offset;
-				lf_fr_p= chunk_right_->GetFireLightData() + offset;
+				b_fr_p= chunk_right_->GetBlockIdsData() + offset;
+				l_fr_p= chunk_right_->GetLightData() + offset;
 
 				offset= BlockAddr( 0, H_CHUNK_WIDTH  - 2, 0 );
 				t_br_p= chunk_right_->GetTransparencyData() + offset;
-				b_br_p= chunk_right_->GetBlocksData() + offset;
-				ls_br_p= chunk_right_->GetSunLightData() + offset;
-				lf_br_p= chunk_right_->GetFireLightData() + offset;
+				b_br_p= chunk_right_->GetBlockIdsData() + offset;
+				l_br_p= chunk_right_->GetLightData() + offset;
 			}
 			else
 				t_fr_p= t_br_p= t_p;//this block transparency;
@@ -535,9 +603,8 @@ void r_ChunkInfo::BuildChunkMesh()
 			{
 				offset= BlockAddr( 0, 0, 0 );
 				t_fr_p= chunk_right_->GetTransparencyData() + offset;
-				b_fr_p= chunk_right_->GetBlocksData() + offset;
-				ls_fr_p= chunk_right_->GetSunLightData() + offset;
-				lf_fr_p= chunk_right_->GetFireLightData() + offset;
+				b_fr_p= chunk_right_->GetBlockIdsData() + offset;
+				l_fr_p= chunk_right_->GetLightData() + offset;
 			}
 			else
 				t_fr_p= t_p;//this block transparency;
@@ -545,9 +612,8 @@ void r_ChunkInfo::BuildChunkMesh()
 			{
 				offset= BlockAddr( 0, H_CHUNK_WIDTH - 1, 0 );
 				t_br_p= chunk_back_right_->GetTransparencyData() + offset;
-				b_br_p= chunk_back_right_->GetBlocksData() + offset;
-				ls_br_p= chunk_back_right_->GetSunLightData() + offset;
-				lf_br_p= chunk_back_right_->GetFireLightData() + offset;
+				b_br_p= chunk_back_right_->GetBlockIdsData() + offset;
+				l_br_p= chunk_back_right_->GetLightData() + offset;
 			}
 			else
 				t_br_p= t_p;//this block transparency;
@@ -557,7 +623,7 @@ void r_ChunkInfo::BuildChunkMesh()
 		{
 			unsigned char normal_id;
 			unsigned char tex_id, tex_scale, light[2];
-			const h_Block* b;
+			h_BlockType block_type;
 
 			unsigned char t= t_p[z] & H_VISIBLY_TRANSPARENCY_BITS;
 			unsigned char t_fr= t_fr_p[z] & H_VISIBLY_TRANSPARENCY_BITS;
@@ -570,19 +636,19 @@ void r_ChunkInfo::BuildChunkMesh()
 				if( t > t_up )
 				{
 					normal_id= static_cast<unsigned char>(h_Direction::Down);
-					b= b_p[z+1];
-					light[0]= ls_p[z];
-					light[1]= lf_p[z];
+					block_type= hBlockIdType( b_p[z+1] );
+					light[0]= hPackedSunLight ( l_p[z] );
+					light[1]= hPackedFireLight( l_p[z] );
 				}
 				else
 				{
 					normal_id= static_cast<unsigned char>(h_Direction::Up);
-					b= b_p[z];
-					light[0]= ls_p[z+1];
-					light[1]= lf_p[z+1];
+					block_type= hBlockIdType( b_p[z] );
+					light[0]= hPackedSunLight ( l_p[z+1] );
+					light[1]= hPackedFireLight( l_p[z+1] );
 				}
 
-				tex_id= r_TextureManager::GetTextureId( b->Type(), normal_id );
+				tex_id= r_TextureManager::GetTextureId( block_type, normal_id );
 				tex_scale= r_TextureManager::GetTextureScale( tex_id );
 
 				v[0].coord[0]= 3 * ( x + X );
@@ -629,12 +695,12 @@ void r_ChunkInfo::BuildChunkMesh()
 				}
 				else
 				{
-					world.GetForwardVertexLight( x + relative_X - 1, y + relative_Y - (x&1), z, v[0].light );
-					world.GetBackVertexLight( x + relative_X, y + relative_Y + 1, z, v[1].light );
-					world.GetForwardVertexLight( x + relative_X, y + relative_Y, z, v[2].light );
-					world.GetBackVertexLight( x + relative_X + 1, y + relative_Y + ((1+x)&1), z, v[3].light );
-					world.GetForwardVertexLight( x + relative_X, y + relative_Y - 1, z, v[7].light );
-					world.GetBackVertexLight(  x + relative_X, y + relative_Y, z, v[4].light );
+					SetVertexLight( v[0], vertex_light.Forward( x - 1, y - (x&1), z ) );
+					SetVertexLight( v[1], vertex_light.Back( x, y + 1, z ) );
+					SetVertexLight( v[2], vertex_light.Forward( x, y, z ) );
+					SetVertexLight( v[3], vertex_light.Back( x + 1, y + ((1+x)&1), z ) );
+					SetVertexLight( v[7], vertex_light.Forward( x, y - 1, z ) );
+					SetVertexLight( v[4], vertex_light.Back( x, y, z ) );
 				}
 				v[5]= v[0];
 				v[6]= v[3];
@@ -652,19 +718,19 @@ void r_ChunkInfo::BuildChunkMesh()
 				if( t > t_fr )
 				{
 					normal_id= static_cast<unsigned char>(h_Direction::BackLeft);
-					b= b_fr_p[z];
-					light[0]= ls_p[z];
-					light[1]= lf_p[z];
+					block_type= hBlockIdType( b_fr_p[z] );
+					light[0]= hPackedSunLight ( l_p[z] );
+					light[1]= hPackedFireLight( l_p[z] );
 				}
 				else
 				{
 					normal_id= static_cast<unsigned char>(h_Direction::ForwardRight);
-					b= b_p[z];
-					light[0]= ls_fr_p[z];
-					light[1]= lf_fr_p[z];
+					block_type= hBlockIdType( b_p[z] );
+					light[0]= hPackedSunLight ( l_fr_p[z] );
+					light[1]= hPackedFireLight( l_fr_p[z] );
 				}
 
-				tex_id= r_TextureManager::GetTextureId( b->Type(), normal_id );
+				tex_id= r_TextureManager::GetTextureId( block_type, normal_id );
 				tex_scale= r_TextureManager::GetTextureScale( tex_id );
 
 				v[ 1 ].coord[0]= v[2].coord[0]= 3 * ( x + X ) + 3;
@@ -692,10 +758,10 @@ void r_ChunkInfo::BuildChunkMesh()
 				}
 				else
 				{
-					world.GetBackVertexLight( x + relative_X + 1, y + relative_Y + ((x+1)&1), z, v[0].light );
-					world.GetForwardVertexLight( x + relative_X, y + relative_Y, z, v[1].light );
-					world.GetForwardVertexLight( x + relative_X, y + relative_Y, z-1, v[2].light  );
-					world.GetBackVertexLight( x + relative_X + 1, y + relative_Y + ((x+1)&1), z-1, v[3].light  );
+					SetVertexLight( v[0], vertex_light.Back( x + 1, y + ((1+x)&1), z ) );
+					SetVertexLight( v[1], vertex_light.Forward( x, y, z ) );
+					SetVertexLight( v[2], vertex_light.Forward( x, y, z - 1 ) );
+					SetVertexLight( v[3], vertex_light.Back( x + 1, y + ((1+x)&1), z - 1 ) );
 				}
 				//v[0].normal_id= v[1].normal_id= v[2].normal_id= v[3].normal_id= normal_id;
 				if( normal_id == static_cast<unsigned char>(h_Direction::BackLeft) )
@@ -709,19 +775,19 @@ void r_ChunkInfo::BuildChunkMesh()
 				if( t > t_br )
 				{
 					normal_id= static_cast<unsigned char>(h_Direction::ForwardLeft);
-					b= b_br_p[z];
-					light[0]= ls_p[z];
-					light[1]= lf_p[z];
+					block_type= hBlockIdType( b_br_p[z] );
+					light[0]= hPackedSunLight ( l_p[z] );
+					light[1]= hPackedFireLight( l_p[z] );
 				}
 				else
 				{
 					normal_id= static_cast<unsigned char>(h_Direction::BackRight);
-					b= b_p[z];
-					light[0]= ls_br_p[z];
-					light[1]= lf_br_p[z];
+					block_type= hBlockIdType( b_p[z] );
+					light[0]= hPackedSunLight ( l_br_p[z] );
+					light[1]= hPackedFireLight( l_br_p[z] );
 				}
 
-				tex_id= r_TextureManager::GetTextureId( b->Type(), normal_id );
+				tex_id= r_TextureManager::GetTextureId( block_type, normal_id );
 				tex_scale= r_TextureManager::GetTextureScale( tex_id );
 
 				v[ 1 ].coord[0]= v[2].coord[0]= 3 * ( x + X ) + 3;
@@ -749,10 +815,10 @@ void r_ChunkInfo::BuildChunkMesh()
 				}
 				else
 				{
-					world.GetBackVertexLight( x + relative_X + 1, y + relative_Y + ((x+1)&1), z, v[0].light );
-					world.GetBackVertexLight( x + relative_X + 1, y + relative_Y + ((x+1)&1), z - 1, v[3].light );
-					world.GetForwardVertexLight( x + relative_X, y + relative_Y - 1, z - 1, v[2].light );
-					world.GetForwardVertexLight( x + relative_X, y + relative_Y - 1, z, v[1].light );
+					SetVertexLight( v[0], vertex_light.Back( x + 1, y + ((1+x)&1), z ) );
+					SetVertexLight( v[3], vertex_light.Back( x + 1, y + ((1+x)&1), z - 1 ) );
+					SetVertexLight( v[2], vertex_light.Forward( x, y - 1, z - 1 ) );
+					SetVertexLight( v[1], vertex_light.Forward( x, y - 1, z ) );
 				}
 				//v[0].normal_id= v[1].normal_id= v[2].normal_id= v[3].normal_id= normal_id;
 				if( normal_id == static_cast<unsigned char>(h_Direction::BackRight) )
@@ -766,19 +832,19 @@ void r_ChunkInfo::BuildChunkMesh()
 				if( t > t_f )
 				{
 					normal_id= static_cast<unsigned char>(h_Direction::Back);
-					b= b_f_p[z];
-					light[0]= ls_p[z];
-					light[1]= lf_p[z];
+					block_type= hBlockIdType( b_f_p[z] );
+					light[0]= hPackedSunLight ( l_p[z] );
+					light[1]= hPackedFireLight( l_p[z] );
 				}
 				else
 				{
 					normal_id= static_cast<unsigned char>(h_Direction::Forward);
-					b= b_p[z];
-					light[0]= ls_f_p[z];
-					light[1]= lf_f_p[z];
+					block_type= hBlockIdType( b_p[z] );
+					light[0]= hPackedSunLight ( l_f_p[z] );
+					light[1]= hPackedFireLight( l_f_p[z] );
 				}
 
-				tex_id= r_TextureManager::GetTextureId( b->Type(), normal_id );
+				tex_id= r_TextureManager::GetTextureId( block_type, normal_id );
 				tex_scale= r_TextureManager::GetTextureScale( tex_id );
 
 				v[0].coord[0]= v[ 1 ].coord[0]= 3 * ( x + X ) + 1;
@@ -806,10 +872,10 @@ void r_ChunkInfo::BuildChunkMesh()
 				}
 				else
 				{
-					world.GetBackVertexLight( x + relative_X, y + relative_Y + 1, z, v[0].light );
-					world.GetBackVertexLight( x + relative_X, y + relative_Y + 1, z - 1, v[1].light  );
-					world.GetForwardVertexLight( x + relative_X, y + relative_Y, z - 1, v[2].light  );
-					world.GetForwardVertexLight( x + relative_X, y + relative_Y, z, v[3].light  );
+					SetVertexLight( v[0], vertex_light.Back( x, y + 1, z ) );
+					SetVertexLight( v[1], vertex_light.Back( x, y + 1, z - 1 ) );
+					SetVertexLight( v[2], vertex_light.Forward( x, y, z - 1 ) );
+					SetVertexLight( v[3], vertex_light.Forward( x, y, z ) );
 				}
 				//v[0].normal_id= v[1].normal_id= v[2].normal_id= v[3].normal_id= normal_id;
 				if( normal_id == static_cast<unsigned char>(h_Direction::Back) )
@@ -929,8 +995,8 @@ r_WorldVertex* r_ChunkInfo::BuildNonstandardFormBlocks( r_WorldVertex* v )
 				else
 				{
 					const unsigned int addr= BlockAddr( block->GetX(), block->GetY(), block->GetZ() );
-					light[0][0]= chunk_->GetSunLightData ()[ addr ] << 4;
-					light[0][1]= chunk_->GetFireLightData()[ addr ] << 4;
+					light[0][0]= chunk_->SunLightLevel ( addr ) << 4;
+					light[0][1]= chunk_->FireLightLevel( addr ) << 4;
 					for( unsigned int i= 1; i < 12; i++ )
 					{
 						light[i][0]= light[0][0];
@@ -1180,8 +1246,8 @@ r_WorldVertex* r_ChunkInfo::BuildNonstandardFormBlocks( r_WorldVertex* v )
 				else
 				{
 					const unsigned int addr= BlockAddr( block->GetX(), block->GetY(), block->GetZ() );
-					light[0][0]= chunk_->GetSunLightData ()[ addr ] << 4;
-					light[0][1]= chunk_->GetFireLightData()[ addr ] << 4;
+					light[0][0]= chunk_->SunLightLevel ( addr ) << 4;
+					light[0][1]= chunk_->FireLightLevel( addr ) << 4;
 					for( unsigned int i= 1; i < 12; i++ )
 					{
 						light[i][0]= light[0][0];
@@ -1346,8 +1412,8 @@ void rBuildChunkFailingBlocks( const r_ChunkInfo& chunk_info, std::vector<r_Worl
 		{
 			unsigned int addr= BlockAddr( block->GetX(), block->GetY(), block->GetZ() >> 16 );
 			unsigned char l[2];
-			l[0]= chunk_info.chunk_->GetSunLightData ()[ addr ] << 4;
-			l[1]= chunk_info.chunk_->GetFireLightData()[ addr ] << 4;
+			l[0]= chunk_info.chunk_->SunLightLevel ( addr ) << 4;
+			l[1]= chunk_info.chunk_->FireLightLevel( addr ) << 4;
 			for( unsigned int i= 0; i < 12; i++ )
 			{
 				light[i][0]= l[0];
@@ -1756,51 +1822,43 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 		int offset;
 
 		const unsigned char* t_p [7];
-		const h_Block* const* b_p[7];
-		const unsigned char* ls_p[7];
-		const unsigned char* lf_p[7];
+		const unsigned short* b_p[7];
+		const unsigned char* l_p[7];
 
 		offset= BlockAddr(x,y,0); // BLock itself
 		t_p [6]= chunk_->GetTransparencyData() + offset;
-		b_p [6]= chunk_->GetBlocksData() + offset;
-		ls_p[6]= chunk_->GetSunLightData() + offset;
-		lf_p[6]= chunk_->GetFireLightData() + offset;
+		b_p [6]= chunk_->GetBlockIdsData() + offset;
+		l_p[6]= chunk_->GetLightData() + offset;
 
 		offset= BlockAddr(x,y+1,0); // forward
 		t_p [0]= chunk_->GetTransparencyData() + offset;
-		b_p [0]= chunk_->GetBlocksData() + offset;
-		ls_p[0]= chunk_->GetSunLightData() + offset;
-		lf_p[0]= chunk_->GetFireLightData() + offset;
+		b_p [0]= chunk_->GetBlockIdsData() + offset;
+		l_p[0]= chunk_->GetLightData() + offset;
 
 		offset= BlockAddr(x + 1, y + (1&(x+1)),0); // forward right
 		t_p [1]= chunk_->GetTransparencyData() + offset;
-		b_p [1]= chunk_->GetBlocksData() + offset;
-		ls_p[1]= chunk_->GetSunLightData() + offset;
-		lf_p[1]= chunk_->GetFireLightData() + offset;
+		b_p [1]= chunk_->GetBlockIdsData() + offset;
+		l_p[1]= chunk_->GetLightData() + offset;
 
 		offset= BlockAddr(x + 1, y - ( 1&x )  ,0); // back right
 		t_p [2]= chunk_->GetTransparencyData() + offset;
-		b_p [2]= chunk_->GetBlocksData() + offset;
-		ls_p[2]= chunk_->GetSunLightData() + offset;
-		lf_p[2]= chunk_->GetFireLightData() + offset;
+		b_p [2]= chunk_->GetBlockIdsData() + offset;
+		l_p[2]= chunk_->GetLightData() + offset;
 
 		offset= BlockAddr(x,y-1,0); // back
 		t_p [3]= chunk_->GetTransparencyData() + offset;
-		b_p [3]= chunk_->GetBlocksData() + offset;
-		ls_p[3]= chunk_->GetSunLightData() + offset;
-		lf_p[3]= chunk_->GetFireLightData() + offset;
+		b_p [3]= chunk_->GetBlockIdsData() + offset;
+		l_p[3]= chunk_->GetLightData() + offset;
 
 		offset= BlockAddr(x - 1, y - ( 1&x )  ,0); // back left
 		t_p [4]= chunk_->GetTransparencyData() + offset;
-		b_p [4]= chunk_->GetBlocksData() + offset;
-		ls_p[4]= chunk_->GetSunLightData() + offset;
-		lf_p[4]= chunk_->GetFireLightData() + offset;
+		b_p [4]= chunk_->GetBlockIdsData() + offset;
+		l_p[4]= chunk_->GetLightData() + offset;
 
 		offset= BlockAddr(x - 1, y + (1&(x+1)),0); // forward left
 		t_p [5]= chunk_->GetTransparencyData() + offset;
-		b_p [5]= chunk_->GetBlocksData() + offset;
-		ls_p[5]= chunk_->GetSunLightData() + offset;
-		lf_p[5]= chunk_->GetFireLightData() + offset;
+		b_p [5]= chunk_->GetBlockIdsData() + offset;
+		l_p[5]= chunk_->GetLightData() + offset;
 
 		//front chunk border
 		if( y == H_CHUNK_WIDTH - 1 && x > 0 && x < H_CHUNK_WIDTH - 1 )
@@ -1809,9 +1867,8 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( x, 0, 0 );
 				t_p [0]= chunk_front_->GetTransparencyData() + offset;
-				b_p [0]= chunk_front_->GetBlocksData() + offset;
-				ls_p[0]= chunk_front_->GetSunLightData() + offset;
-				lf_p[0]= chunk_front_->GetFireLightData() + offset;
+				b_p [0]= chunk_front_->GetBlockIdsData() + offset;
+				l_p[0]= chunk_front_->GetLightData() + offset;
 			}
 			else
 			{
@@ -1825,15 +1882,13 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 				{
 					offset= BlockAddr( x + 1, 0, 0 );
 					t_p [1]= chunk_front_->GetTransparencyData() + offset;
-					b_p [1]= chunk_front_->GetBlocksData() + offset;
-					ls_p[1]= chunk_front_->GetSunLightData() + offset;
-					lf_p[1]= chunk_front_->GetFireLightData() + offset;
+					b_p [1]= chunk_front_->GetBlockIdsData() + offset;
+					l_p[1]= chunk_front_->GetLightData() + offset;
 
 					offset= BlockAddr( x - 1, 0, 0 );
 					t_p [5]= chunk_front_->GetTransparencyData() + offset;
-					b_p [5]= chunk_front_->GetBlocksData() + offset;
-					ls_p[5]= chunk_front_->GetSunLightData() + offset;
-					lf_p[5]= chunk_front_->GetFireLightData() + offset;
+					b_p [5]= chunk_front_->GetBlockIdsData() + offset;
+					l_p[5]= chunk_front_->GetLightData() + offset;
 				}
 				else
 					t_p[1]= t_p[5]= t_p[6];//this block transparency
@@ -1846,9 +1901,8 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( x, H_CHUNK_WIDTH - 1, 0 );
 				t_p [3]= chunk_back_->GetTransparencyData() + offset;
-				b_p [3]= chunk_back_->GetBlocksData() + offset;
-				ls_p[3]= chunk_back_->GetSunLightData() + offset;
-				lf_p[3]= chunk_back_->GetFireLightData() + offset;
+				b_p [3]= chunk_back_->GetBlockIdsData() + offset;
+				l_p[3]= chunk_back_->GetLightData() + offset;
 			}
 			else
 			{
@@ -1862,15 +1916,13 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 				{
 					offset= BlockAddr( x+ 1, H_CHUNK_WIDTH - 1, 0 );
 					t_p [2]= chunk_back_->GetTransparencyData() + offset;
-					b_p [2]= chunk_back_->GetBlocksData() + offset;
-					ls_p[2]= chunk_back_->GetSunLightData() + offset;
-					lf_p[2]= chunk_back_->GetFireLightData() + offset;
+					b_p [2]= chunk_back_->GetBlockIdsData() + offset;
+					l_p[2]= chunk_back_->GetLightData() + offset;
 
 					offset= BlockAddr( x- 1, H_CHUNK_WIDTH - 1, 0 );
 					t_p [4]= chunk_back_->GetTransparencyData() + offset;
-					b_p [4]= chunk_back_->GetBlocksData() + offset;
-					ls_p[4]= chunk_back_->GetSunLightData() + offset;
-					lf_p[4]= chunk_back_->GetFireLightData() + offset;
+					b_p [4]= chunk_back_->GetBlockIdsData() + offset;
+					l_p[4]= chunk_back_->GetLightData() + offset;
 				}
 				else
 					t_p[2]= t_p[4]= t_p[6];//this block transparency
@@ -1883,15 +1935,13 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( 0, y, 0 );
 				t_p [1]= chunk_right_->GetTransparencyData() + offset;
-				b_p [1]= chunk_right_->GetBlocksData() + offset;
-				ls_p[1]= chunk_right_->GetSunLightData() + offset;
-				lf_p[1]= chunk_right_->GetFireLightData() + offset;
+				b_p [1]= chunk_right_->GetBlockIdsData() + offset;
+				l_p[1]= chunk_right_->GetLightData() + offset;
 
 				offset= BlockAddr( 0, y - 1, 0 );
 				t_p [2]= chunk_right_->GetTransparencyData() + offset;
-				b_p [2]= chunk_right_->GetBlocksData() + offset;
-				ls_p[2]= chunk_right_->GetSunLightData() + offset;
-				lf_p[2]= chunk_right_->GetFireLightData() + offset;
+				b_p [2]= chunk_right_->GetBlockIdsData() + offset;
+				l_p[2]= chunk_right_->GetLightData() + offset;
 			}
 			else
 				t_p[1]= t_p[2]= t_p[6];//this block transparency
@@ -1903,15 +1953,13 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( H_CHUNK_WIDTH - 1, y, 0 );
 				t_p [4]= chunk_left_->GetTransparencyData() + offset;
-				b_p [4]= chunk_left_->GetBlocksData() + offset;
-				ls_p[4]= chunk_left_->GetSunLightData() + offset;
-				lf_p[4]= chunk_left_->GetFireLightData() + offset;
+				b_p [4]= chunk_left_->GetBlockIdsData() + offset;
+				l_p[4]= chunk_left_->GetLightData() + offset;
 
 				offset= BlockAddr( H_CHUNK_WIDTH - 1, y + 1, 0 );
 				t_p [5]= chunk_left_->GetTransparencyData() + offset;
-				b_p [5]= chunk_left_->GetBlocksData() + offset;
-				ls_p[5]= chunk_left_->GetSunLightData() + offset;
-				lf_p[5]= chunk_left_->GetFireLightData() + offset;
+				b_p [5]= chunk_left_->GetBlockIdsData() + offset;
+				l_p[5]= chunk_left_->GetLightData() + offset;
 			}
 			else
 				t_p[4]= t_p[5]= t_p[6];//this block transparency
@@ -1923,9 +1971,8 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( H_CHUNK_WIDTH - 1, 0, 0 );
 				t_p [0]= chunk_front_->GetTransparencyData() + offset;
-				b_p [0]= chunk_front_->GetBlocksData() + offset;
-				ls_p[0]= chunk_front_->GetSunLightData() + offset;
-				lf_p[0]= chunk_front_->GetFireLightData() + offset;
+				b_p [0]= chunk_front_->GetBlockIdsData() + offset;
+				l_p[0]= chunk_front_->GetLightData() + offset;
 			}
 			else
 			{
@@ -1937,15 +1984,13 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( 0, H_CHUNK_WIDTH - 1, 0 );
 				t_p [1]= chunk_right_->GetTransparencyData() + offset;
-				b_p [1]= chunk_right_->GetBlocksData() + offset;
-				ls_p[1]= chunk_right_->GetSunLightData() + offset;
-				lf_p[1]= chunk_right_->GetFireLightData() + offset;
+				b_p [1]= chunk_right_->GetBlockIdsData() + offset;
+				l_p[1]= chunk_right_->GetLightData() + offset;
 
 				offset= BlockAddr( 0, H_CHUNK_WIDTH - 2, 0 );
 				t_p [2]= chunk_right_->GetTransparencyData() + offset;
-				b_p [2]= chunk_right_->GetBlocksData() + offset;
-				ls_p[2]= chunk_right_->GetSunLightData() + offset;
-				lf_p[2]= chunk_right_->GetFireLightData() + offset;
+				b_p [2]= chunk_right_->GetBlockIdsData() + offset;
+				l_p[2]= chunk_right_->GetLightData() + offset;
 			}
 			else
 				t_p[1]= t_p[2]= t_p[6];//this block transparency
@@ -1957,9 +2002,8 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( 0, 0, 0 );
 				t_p [1]= chunk_right_->GetTransparencyData() + offset;
-				b_p [1]= chunk_right_->GetBlocksData() + offset;
-				ls_p[1]= chunk_right_->GetSunLightData() + offset;
-				lf_p[1]= chunk_right_->GetFireLightData() + offset;
+				b_p [1]= chunk_right_->GetBlockIdsData() + offset;
+				l_p[1]= chunk_right_->GetLightData() + offset;
 			}
 			else
 				t_p[1]= t_p[6];//this block transparency;
@@ -1967,9 +2011,8 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( 0, H_CHUNK_WIDTH - 1, 0 );
 				t_p [2]= chunk_back_right_->GetTransparencyData() + offset;
-				b_p [2]= chunk_back_right_->GetBlocksData() + offset;
-				ls_p[2]= chunk_back_right_->GetSunLightData() + offset;
-				lf_p[2]= chunk_back_right_->GetFireLightData() + offset;
+				b_p [2]= chunk_back_right_->GetBlockIdsData() + offset;
+				l_p[2]= chunk_back_right_->GetLightData() + offset;
 			}
 			else
 				t_p[2]= t_p[6];//this block transparency;
@@ -1977,15 +2020,13 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( H_CHUNK_WIDTH - 1, H_CHUNK_WIDTH - 1, 0 );
 				t_p [3]= chunk_back_->GetTransparencyData() + offset;
-				b_p [3]= chunk_back_->GetBlocksData() + offset;
-				ls_p[3]= chunk_back_->GetSunLightData() + offset;
-				lf_p[3]= chunk_back_->GetFireLightData() + offset;
+				b_p [3]= chunk_back_->GetBlockIdsData() + offset;
+				l_p[3]= chunk_back_->GetLightData() + offset;
 
 				offset= BlockAddr( H_CHUNK_WIDTH - 2, H_CHUNK_WIDTH - 1, 0 );
 				t_p [4]= chunk_back_->GetTransparencyData() + offset;
-				b_p [4]= chunk_back_->GetBlocksData() + offset;
-				ls_p[4]= chunk_back_->GetSunLightData() + offset;
-				lf_p[4]= chunk_back_->GetFireLightData() + offset;
+				b_p [4]= chunk_back_->GetBlockIdsData() + offset;
+				l_p[4]= chunk_back_->GetLightData() + offset;
 			}
 			else
 			{
@@ -2000,9 +2041,8 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( H_CHUNK_WIDTH - 1, H_CHUNK_WIDTH - 1, 0 );
 				t_p [4]= chunk_left_->GetTransparencyData() + offset;
-				b_p [4]= chunk_left_->GetBlocksData() + offset;
-				ls_p[4]= chunk_left_->GetSunLightData() + offset;
-				lf_p[4]= chunk_left_->GetFireLightData() + offset;
+				b_p [4]= chunk_left_->GetBlockIdsData() + offset;
+				l_p[4]= chunk_left_->GetLightData() + offset;
 			}
 			else
 				t_p[4]= t_p[6];//this block transparency
@@ -2011,9 +2051,8 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( H_CHUNK_WIDTH - 1, 0, 0 );
 				t_p [5]= chunk_front_left_->GetTransparencyData() + offset;
-				b_p [5]= chunk_front_left_->GetBlocksData() + offset;
-				ls_p[5]= chunk_front_left_->GetSunLightData() + offset;
-				lf_p[5]= chunk_front_left_->GetFireLightData() + offset;
+				b_p [5]= chunk_front_left_->GetBlockIdsData() + offset;
+				l_p[5]= chunk_front_left_->GetLightData() + offset;
 			}
 			else
 				t_p[5]= t_p[6];//this block transparency
@@ -2022,15 +2061,13 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( x, 0, 0 );
 				t_p [0]= chunk_front_->GetTransparencyData() + offset;
-				b_p [0]= chunk_front_->GetBlocksData() + offset;
-				ls_p[0]= chunk_front_->GetSunLightData() + offset;
-				lf_p[0]= chunk_front_->GetFireLightData() + offset;
+				b_p [0]= chunk_front_->GetBlockIdsData() + offset;
+				l_p[0]= chunk_front_->GetLightData() + offset;
 
 				offset= BlockAddr( x + 1, 0, 0 );
 				t_p [1]= chunk_front_->GetTransparencyData() + offset;
-				b_p [1]= chunk_front_->GetBlocksData() + offset;
-				ls_p[1]= chunk_front_->GetSunLightData() + offset;
-				lf_p[1]= chunk_front_->GetFireLightData() + offset;
+				b_p [1]= chunk_front_->GetBlockIdsData() + offset;
+				l_p[1]= chunk_front_->GetLightData() + offset;
 			}
 			else
 			{
@@ -2045,15 +2082,13 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( H_CHUNK_WIDTH - 1, 0, 0 );
 				t_p [4]= chunk_left_->GetTransparencyData() + offset;
-				b_p [4]= chunk_left_->GetBlocksData() + offset;
-				ls_p[4]= chunk_left_->GetSunLightData() + offset;
-				lf_p[4]= chunk_left_->GetFireLightData() + offset;
+				b_p [4]= chunk_left_->GetBlockIdsData() + offset;
+				l_p[4]= chunk_left_->GetLightData() + offset;
 
 				offset= BlockAddr( H_CHUNK_WIDTH - 1, 1, 0 );
 				t_p [5]= chunk_left_->GetTransparencyData() + offset;
-				b_p [5]= chunk_left_->GetBlocksData() + offset;
-				ls_p[5]= chunk_left_->GetSunLightData() + offset;
-				lf_p[5]= chunk_left_->GetFireLightData() + offset;
+				b_p [5]= chunk_left_->GetBlockIdsData() + offset;
+				l_p[5]= chunk_left_->GetLightData() + offset;
 			}
 			else
 				t_p[4]= t_p[5]= t_p[6];//this block transparency
@@ -2062,9 +2097,8 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			{
 				offset= BlockAddr( 0, H_CHUNK_WIDTH - 1, 0 );
 				t_p [3]= chunk_back_->GetTransparencyData() + offset;
-				b_p [3]= chunk_back_->GetBlocksData() + offset;
-				ls_p[3]= chunk_back_->GetSunLightData() + offset;
-				lf_p[3]= chunk_back_->GetFireLightData() + offset;
+				b_p [3]= chunk_back_->GetBlockIdsData() + offset;
+				l_p[3]= chunk_back_->GetLightData() + offset;
 			}
 			else
 			{
@@ -2080,7 +2114,7 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 			unsigned char t= t_p[6][z] & H_VISIBLY_TRANSPARENCY_BITS;
 			unsigned char t_up= t_p[6][z+1]  & H_VISIBLY_TRANSPARENCY_BITS;
 			unsigned char t_down= t_p[6][z-1]  & H_VISIBLY_TRANSPARENCY_BITS;
-			const h_Block* const b= b_p[6][z];
+			const h_BlockType block_type= hBlockIdType( b_p[6][z] );
 
 			bool have_up_face= false;
 			bool have_down_face= false;
@@ -2110,7 +2144,7 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 				// Combine this block with upper block, if block type, sides set, lighting is same
 				while( z + dz < H_CHUNK_HEIGHT - 2 )
 				{
-					if( b_p[6][z+dz]->Type() != b->Type() )
+					if( hBlockIdType( b_p[6][z+dz] ) != block_type )
 						break;
 					unsigned char dz_t= t_p[6][z+dz] & H_VISIBLY_TRANSPARENCY_BITS;
 					bool sides_ok= true;
@@ -2131,8 +2165,8 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 					{
 						if( have_sides[side] )
 						{
-							if( std::abs( int(ls_p[side][z]) - int(ls_p[side][z+dz]) ) > 1 ||
-								std::abs( int(lf_p[side][z]) - int(lf_p[side][z+dz]) ) > 1 )
+							if( std::abs( int(hPackedSunLight ( l_p[side][z] )) - int(hPackedSunLight ( l_p[side][z+dz] )) ) > 1 ||
+								std::abs( int(hPackedFireLight( l_p[side][z] )) - int(hPackedFireLight( l_p[side][z+dz] )) ) > 1 )
 							{
 								light_ok= false;
 								break;
@@ -2183,7 +2217,7 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 					unsigned int side_b_next_next= ( side + 2u ) % 6u;
 
 					normal_id= static_cast<unsigned char>(h_Direction::Forward);
-					tex_id= r_TextureManager::GetTextureId( b->Type(), normal_id );
+					tex_id= r_TextureManager::GetTextureId( block_type, normal_id );
 					tex_scale= r_TextureManager::GetTextureScale( tex_id );
 
 					const r_WorldVertex* quad_v0;
@@ -2193,8 +2227,8 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 					if( ( combine_block_sides || t > 0 )&& have_sides[side_b_next] )
 					{
 						final_next_side= side_b_next_next;
-						light[0]= ( ls_p[side_b][z] + ls_p[side_b_next][z] ) << 3;
-						light[1]= ( lf_p[side_b][z] + lf_p[side_b_next][z] ) << 3;
+						light[0]= ( hPackedSunLight ( l_p[side_b][z] ) + hPackedSunLight ( l_p[side_b_next][z] ) ) << 3;
+						light[1]= ( hPackedFireLight( l_p[side_b][z] ) + hPackedFireLight( l_p[side_b_next][z] ) ) << 3;
 						quad_v0= &cv[side_b];
 						quad_v1= & cv[side_b_next_next];
 						side+= 2u;
@@ -2202,8 +2236,8 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 					else
 					{
 						final_next_side= side_b_next;
-						light[0]= ls_p[side_b][z] << 4;
-						light[1]= lf_p[side_b][z] << 4;
+						light[0]= hPackedSunLight ( l_p[side_b][z] ) << 4;
+						light[1]= hPackedFireLight( l_p[side_b][z] ) << 4;
 						quad_v0= &cv[side_b];
 						quad_v1= & cv[side_b_next];
 						++side;
@@ -2252,10 +2286,10 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 				}
 
 				normal_id= static_cast<unsigned char>(h_Direction::Up);
-				tex_id= r_TextureManager::GetTextureId( b->Type(), normal_id );
+				tex_id= r_TextureManager::GetTextureId( block_type, normal_id );
 				int light_z= up_down == 0 ? (z-1) : (z+dz);
-				light[0]= ls_p[6][light_z] << 4;
-				light[1]= lf_p[6][light_z] << 4;
+				light[0]= hPackedSunLight ( l_p[6][light_z] ) << 4;
+				light[1]= hPackedFireLight( l_p[6][light_z] ) << 4;
 				tex_scale= r_TextureManager::GetTextureScale( tex_id );
 
 				v[0].coord[0]= v[3].coord[0]= cv[5].coord[0];
@@ -2298,10 +2332,10 @@ void r_ChunkInfo::BuildChunkMeshLowDetail()
 
 				bool skip_quad= false;
 				int forward_light_fetch_y= y + relative_Y;
-				if( b_p[6][z]->Type() == b_p[unite_y_index][z]->Type() &&
+				if( hBlockIdType( b_p[6][z] ) == hBlockIdType( b_p[unite_y_index][z] ) &&
 					t_p[6][light_z]   == t_p[unite_y_index][light_z] &&
-					std::abs( ls_p[6][light_z] - ls_p[unite_y_index][light_z] ) <= 1 &&
-					std::abs( lf_p[6][light_z] - lf_p[unite_y_index][light_z] ) <= 1 )
+					std::abs( hPackedSunLight ( l_p[6][light_z] ) - hPackedSunLight ( l_p[unite_y_index][light_z] ) ) <= 1 &&
+					std::abs( hPackedFireLight( l_p[6][light_z] ) - hPackedFireLight( l_p[unite_y_index][light_z] ) ) <= 1 )
 				{
 					if( (y&1) != 0 )
 						skip_quad= true;
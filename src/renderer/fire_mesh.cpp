@@ -132,10 +132,10 @@ void rGenChunkFireMesh( const h_Chunk& chunk, std::vector<r_FireMeshVertex>& out
 	int loaded_zone_X= ( chunk.Longitude() - world.Longitude() ) << H_CHUNK_WIDTH_LOG2;
 	int loaded_zone_Y= ( chunk.Latitude () - world.Latitude () ) << H_CHUNK_WIDTH_LOG2;
 
-	const std::vector< h_Fire* >& fire_list= chunk.GetFireList();
-
-	for( const h_Fire* fire : fire_list )
+	for( const unsigned short fire_addr : chunk.GetFireList() )
 	{
+		const h_Fire* fire= chunk.GetFire( fire_addr );
+
 		float x= float( X + fire->x_ ) * H_SPACE_SCALE_VECTOR_X;
 		float y= float( Y + fire->y_ ) + 0.5f * float( (fire->x_^1) & 1 );
 		float z= float( fire->z_ );
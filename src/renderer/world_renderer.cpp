@@ -745,6 +745,24 @@ void r_WorldRenderer::Draw()
 		text_manager_->AddMultiText( 0, i++, text_scale, r_Text::default_color,
 			"rain intensity: %1.3f", rain_intensity_ );
 
+		text_manager_->AddMultiText( 0, i++, text_scale, r_Text::default_color,
+			"chunks loading blocked time: %d ms", world_->GetChunksLoadingBlockedTimeMS() );
+
+		{
+			const h_ChunkPool::Stats chunk_pool_stats= world_->GetChunkPoolStats();
+			text_manager_->AddMultiText( 0, i++, text_scale, r_Text::default_color,
+				"chunk pool: %d/%d storages, reused %d of %d chunks, page faults: %d fresh, %d reused",
+				chunk_pool_stats.storages_used, chunk_pool_stats.storages_total,
+				(unsigned int)chunk_pool_stats.chunks_reused, (unsigned int)chunk_pool_stats.chunks_created,
+				(unsigned int)chunk_pool_stats.page_faults_fresh, (unsigned int)chunk_pool_stats.page_faults_reused );
+		}
+
+		text_manager_->AddMultiText( 0, i++, text_scale, r_Text::default_color,
+			"autosave snapshot time: %d us", world_->GetAutosaveSnapshotTimeUS() );
+
+		text_manager_->AddMultiText( 0, i++, text_scale, r_Text::default_color,
+			"autosave latency: %d ms", world_->GetAutosaveLatencyMS() );
+
 		//text_manager->AddMultiText( 0, 11, text_scale, r_Text::default_color, "quick brown fox jumps over the lazy dog\nQUICK BROWN FOX JUMPS OVER THE LAZY DOG\n9876543210-+/\\" );
 		//text_manager->AddMultiText( 0, 0, 8.0f, r_Text::default_color, "#A@Kli\nO01-eN" );
 
@@ -19,5 +19,9 @@ const char* const chunk_number_x= "chunk_number_x";
 const char* const chunk_number_y= "chunk_number_y";
 const char* const active_area_margins_x= "active_area_margins_x";
 const char* const active_area_margins_y= "active_area_margins_y";
+const char* const chunk_compression= "chunk_compression";
+const char* const autosave_interval= "autosave_interval";
+const char* const regions_cache_size= "regions_cache_size";
+const char* const chunk_pool_huge_pages= "chunk_pool_huge_pages";
 
 } // namespace h_SettingsKeys
@@ -22,5 +22,9 @@ extern const char* const chunk_number_x;
 extern const char* const chunk_number_y;
 extern const char* const active_area_margins_x;
 extern const char* const active_area_margins_y;
+extern const char* const chunk_compression;
+extern const char* const autosave_interval;
+extern const char* const regions_cache_size;
+extern const char* const chunk_pool_huge_pages;
 
 } // namespace h_SettingsKeys
@@ -1,6 +1,13 @@
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <utility>
+#include <vector>
+
 #include "test.h"
 
 #include "../math_lib/allocation_free_set.hpp"
+#include "../math_lib/rand.hpp"
 
 struct SetData;
 typedef AllocationFreeSet<SetData*> Set;
@@ -96,3 +103,145 @@ H_TEST(AllocationFreeSetUnorderedAccessTest)
 
 	H_TEST_EXPECT( set.size() == 0 );
 }
+
+H_TEST(AllocationFreeSetRandomTest)
+{
+	const unsigned int c_element_count= 1024;
+
+	std::vector<SetData> elements( c_element_count );
+	std::vector<bool> inserted( c_element_count, false );
+	std::set<SetData*> reference;
+
+	Set set;
+	m_Rand randomizer;
+
+	for( unsigned int i= 0; i < c_element_count * 64u; i++ )
+	{
+		// Mostly insert at start, mostly erase at end.
+		const unsigned int n= randomizer.Rand() % c_element_count;
+		const bool insert= randomizer.Rand() % c_element_count >= i / 64u;
+
+		SetData* const element= &elements[n];
+		if( insert )
+		{
+			const auto it= set.insert( &element->set_node, element );
+			H_TEST_EXPECT( ( it == set.end() ) == inserted[n] );
+			inserted[n]= true;
+			reference.insert( element );
+		}
+		else if( inserted[n] )
+		{
+			set.erase( set.find( element ) );
+			inserted[n]= false;
+			reference.erase( element );
+		}
+		else
+		{
+			H_TEST_EXPECT( set.find( element ) == set.end() );
+		}
+
+		if( i % 64u == 0u )
+			H_TEST_EXPECT( set.CheckTree() );
+
+		// Search for pointer inside element.
+		auto nearest= set.find_nearest_less_or_equal( reinterpret_cast<SetData*>( &element->something ) );
+		auto reference_nearest= reference.upper_bound( reinterpret_cast<SetData*>( &element->something ) );
+		if( reference_nearest == reference.begin() )
+		{
+			H_TEST_EXPECT( nearest == set.end() );
+		}
+		else
+		{
+			--reference_nearest;
+			H_TEST_EXPECT( nearest != set.end() && *nearest == *reference_nearest );
+		}
+	}
+
+	H_TEST_EXPECT( set.CheckTree() );
+	H_TEST_EXPECT( set.size() == reference.size() );
+
+	// Iteration must be ordered.
+	auto reference_it= reference.begin();
+	for( SetData* const value : set )
+	{
+		H_TEST_EXPECT( reference_it != reference.end() && value == *reference_it );
+		++reference_it;
+	}
+	H_TEST_EXPECT( reference_it == reference.end() );
+}
+
+H_TEST(AllocationFreeSetOrderedInsertionTest)
+{
+	const unsigned int c_element_count= 4096;
+
+	std::vector<SetData> elements( c_element_count );
+	Set set;
+
+	// Tree must stay balanced for ordered insertion and erasing.
+	for( SetData& element : elements )
+		set.insert( &element.set_node, &element );
+	H_TEST_EXPECT( set.CheckTree() );
+	H_TEST_EXPECT( set.size() == c_element_count );
+
+	for( unsigned int i= 0; i < c_element_count / 2u; i++ )
+		set.erase( set.begin() );
+	H_TEST_EXPECT( set.CheckTree() );
+
+	for( unsigned int i= c_element_count / 2u; i < c_element_count; i++ )
+		set.erase( set.find( &elements[ c_element_count - 1u - i + c_element_count / 2u ] ) );
+	H_TEST_EXPECT( set.CheckTree() );
+	H_TEST_EXPECT( set.size() == 0 );
+	H_TEST_EXPECT( set.begin() == set.end() );
+}
+
+H_TEST(AllocationFreeSetBenchmark)
+{
+	const unsigned int c_element_count= 4096;
+	const unsigned int c_lookups_per_element= 16;
+
+	// Elements are inserted in increasing address order, like blocks, allocated by "new".
+	std::vector<SetData> elements( c_element_count );
+	std::vector<unsigned int> order( c_element_count );
+	for( unsigned int i= 0; i < c_element_count; i++ )
+		order[i]= i;
+
+	m_Rand randomizer;
+	for( unsigned int i= c_element_count - 1u; i > 0; i-- )
+		std::swap( order[i], order[ randomizer.Rand() % ( i + 1u ) ] );
+
+	Set set;
+
+	const auto t0= std::chrono::steady_clock::now();
+	for( SetData& element : elements )
+		set.insert( &element.set_node, &element );
+
+	const auto t1= std::chrono::steady_clock::now();
+	size_t found= 0;
+	for( unsigned int i= 0; i < c_element_count * c_lookups_per_element; i++ )
+	{
+		// Search for pointer inside element, like allocator searches for block of object.
+		SetData* const element= &elements[ order[ i % c_element_count ] ];
+		auto it= set.find_nearest_less_or_equal( reinterpret_cast<SetData*>( &element->something ) );
+		if( it != set.end() && *it == element )
+			found++;
+	}
+
+	const auto t2= std::chrono::steady_clock::now();
+	for( unsigned int n : order )
+		set.erase( set.find( &elements[n] ) );
+
+	const auto t3= std::chrono::steady_clock::now();
+
+	H_TEST_EXPECT( found == c_element_count * c_lookups_per_element );
+	H_TEST_EXPECT( set.size() == 0 );
+
+	const auto to_us=
+	[]( const std::chrono::steady_clock::duration d ) -> double
+	{
+		return std::chrono::duration<double>(d).count() * 1.0e6;
+	};
+	std::cout << std::endl
+		<< c_element_count << " elements, ordered insertion: " << to_us( t1 - t0 ) << " us, "
+		<< "nearest lookup: " << to_us( t2 - t1 ) * 1000.0 / double( c_element_count * c_lookups_per_element ) << " ns, "
+		<< "random erase: " << to_us( t3 - t2 ) << " us" << std::endl;
+}
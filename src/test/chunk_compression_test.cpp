@@ -0,0 +1,137 @@
+#include <chrono>
+#include <iostream>
+
+#include "test.h"
+#include "test_world.hpp"
+
+#include "../chunk_compression.hpp"
+#include "../lz_compression.hpp"
+#include "../world.hpp"
+
+// Serialized chunks of test world - same data, as in region files.
+static std::vector<h_BinaryStorage> GetTestWorldChunksData()
+{
+	h_World& world= t_GetTestWorld();
+
+	std::vector<h_BinaryStorage> result;
+	for( unsigned int y= 0; y < world.ChunkNumberY(); y++ )
+	for( unsigned int x= 0; x < world.ChunkNumberX(); x++ )
+	{
+		result.emplace_back();
+		t_WriteChunk( *world.GetChunk( x, y ), result.back() );
+	}
+
+	return result;
+}
+
+H_TEST(ChunkCompressionRoundTripTest)
+{
+	const std::vector<h_BinaryStorage> chunks_data= GetTestWorldChunksData();
+
+	h_BinaryStorage compressed;
+	h_BinaryStorage decompressed;
+	for( unsigned int c= 0; c < (unsigned int)h_ChunkCodec::NumCodecs; c++ )
+	for( const h_BinaryStorage& data : chunks_data )
+	{
+		H_TEST_EXPECT( hCompressChunkData( data, h_ChunkCodec(c), compressed ) );
+		H_TEST_EXPECT( hDecompressChunkData( compressed.data(), compressed.size(), decompressed ) );
+		H_TEST_EXPECT( decompressed == data );
+	}
+}
+
+H_TEST(ChunkCompressionCodecNamesTest)
+{
+	for( unsigned int c= 0; c < (unsigned int)h_ChunkCodec::NumCodecs; c++ )
+		H_TEST_EXPECT( hChunkCodecFromName( hChunkCodecName( h_ChunkCodec(c) ), h_ChunkCodec::NumCodecs ) == h_ChunkCodec(c) );
+
+	H_TEST_EXPECT( hChunkCodecFromName( "unknown", h_ChunkCodec::Zlib ) == h_ChunkCodec::Zlib );
+	H_TEST_EXPECT( hChunkCodecFromName( "", h_ChunkCodec::Lz ) == h_ChunkCodec::Lz );
+}
+
+H_TEST(LzCompressionEdgeCasesTest)
+{
+	h_BinaryStorage data;
+	h_BinaryStorage compressed;
+	h_BinaryStorage decompressed;
+
+	const auto round_trip=
+	[&]() -> bool
+	{
+		compressed.resize( hLzCompressBound( data.size() ) );
+		compressed.resize( hLzCompress( data.data(), data.size(), compressed.data() ) );
+		decompressed.resize( data.size() );
+		return
+			compressed.size() <= hLzCompressBound( data.size() ) &&
+			hLzDecompress( compressed.data(), compressed.size(), decompressed.data(), decompressed.size() ) &&
+			decompressed == data;
+	};
+
+	// Empty and small inputs.
+	for( unsigned int size= 0; size < 32; size++ )
+	{
+		data.assign( size, 7 );
+		H_TEST_EXPECT( round_trip() );
+	}
+
+	// Long runs - long match lengths.
+	data.assign( 100000, 42 );
+	H_TEST_EXPECT( round_trip() );
+
+	// Incompressible data - long literals.
+	data.resize( 100000 );
+	unsigned int x= 1;
+	for( unsigned char& b : data )
+	{
+		x= x * 1664525u + 1013904223u;
+		b= (unsigned char)( x >> 24 );
+	}
+	H_TEST_EXPECT( round_trip() );
+
+	// Broken data must not be decoded.
+	data.assign( 1000, 1 );
+	H_TEST_EXPECT( round_trip() );
+	H_TEST_EXPECT( !hLzDecompress( compressed.data(), compressed.size() - 1, decompressed.data(), decompressed.size() ) );
+	H_TEST_EXPECT( !hLzDecompress( compressed.data(), compressed.size(), decompressed.data(), decompressed.size() - 1 ) );
+}
+
+H_TEST(ChunkCompressionBenchmark)
+{
+	const std::vector<h_BinaryStorage> chunks_data= GetTestWorldChunksData();
+	const unsigned int c_iterations= 8;
+
+	uint64_t total_size= 0;
+	for( const h_BinaryStorage& data : chunks_data )
+		total_size+= data.size();
+
+	h_BinaryStorage decompressed;
+	std::vector<h_BinaryStorage> compressed( chunks_data.size() );
+
+	std::cout << std::endl;
+	for( unsigned int c= 0; c < (unsigned int)h_ChunkCodec::NumCodecs; c++ )
+	{
+		const h_ChunkCodec codec= h_ChunkCodec(c);
+
+		const auto t0= std::chrono::steady_clock::now();
+		for( unsigned int i= 0; i < c_iterations; i++ )
+		for( unsigned int j= 0; j < chunks_data.size(); j++ )
+			hCompressChunkData( chunks_data[j], codec, compressed[j] );
+
+		const auto t1= std::chrono::steady_clock::now();
+		for( unsigned int i= 0; i < c_iterations; i++ )
+		for( unsigned int j= 0; j < chunks_data.size(); j++ )
+			hDecompressChunkData( compressed[j].data(), compressed[j].size(), decompressed );
+
+		const auto t2= std::chrono::steady_clock::now();
+
+		uint64_t compressed_size= 0;
+		for( const h_BinaryStorage& data : compressed )
+			compressed_size+= data.size();
+
+		const double megabytes= double( total_size * c_iterations ) / ( 1024.0 * 1024.0 );
+		std::cout << "codec " << hChunkCodecName( codec )
+			<< ": ratio " << double(total_size) / double(compressed_size)
+			<< ", compression " << megabytes / std::chrono::duration<double>( t1 - t0 ).count() << " MB/s"
+			<< ", decompression " << megabytes / std::chrono::duration<double>( t2 - t1 ).count() << " MB/s"
+			<< std::endl;
+	}
+}
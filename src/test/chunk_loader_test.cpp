@@ -0,0 +1,386 @@
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include "test.h"
+
+#include "../chunk_loader.hpp"
+#include "../mapped_file.hpp"
+#include "../world_loading.hpp"
+
+static const char g_test_directory[]= "test_chunk_loader";
+static const char g_test_region_file[]= "test_chunk_loader/lon_0_lat_0_.region";
+
+static const int g_chunks_in_region= H_WORLD_REGION_SIZE_X * H_WORLD_REGION_SIZE_Y;
+
+static void PrepareTestDirectory()
+{
+#ifdef _WIN32
+	_mkdir( g_test_directory );
+#else
+	mkdir( g_test_directory, 0755 );
+#endif
+	std::remove( g_test_region_file );
+}
+
+// Data of chunk with given generation. Data is unique for each chunk and generation.
+static h_BinaryStorage MakeChunkData( const int index, const int generation )
+{
+	std::mt19937 gen( index * 1000 + generation );
+	h_BinaryStorage data( 64 + gen() % 4000 );
+	for( unsigned char& b : data )
+		b= (unsigned char)gen();
+
+	std::memcpy( data.data(), &index, sizeof(int) );
+	std::memcpy( data.data() + sizeof(int), &generation, sizeof(int) );
+	return data;
+}
+
+static void WriteRegion( h_ChunkLoader& loader, const int generation )
+{
+	for( int i= 0; i < g_chunks_in_region; i++ )
+	{
+		const h_BinaryStorage data= MakeChunkData( i, generation );
+		loader.SetChunkData( i % H_WORLD_REGION_SIZE_X, i / H_WORLD_REGION_SIZE_X, data.data(), data.size() );
+	}
+}
+
+static void ReleaseRegion( h_ChunkLoader& loader )
+{
+	for( int i= 0; i < g_chunks_in_region; i++ )
+		loader.FreeChunkData( i % H_WORLD_REGION_SIZE_X, i / H_WORLD_REGION_SIZE_X );
+}
+
+static bool ChunkDataIsEqual( const h_ChunkLoader::ChunkData& chunk_data, const h_BinaryStorage& data )
+{
+	return chunk_data.size == data.size() && std::memcmp( chunk_data.data, data.data(), data.size() ) == 0;
+}
+
+H_TEST(ChunkLoaderRoundTripTest)
+{
+	PrepareTestDirectory();
+	{
+		h_ChunkLoader loader( g_test_directory );
+		WriteRegion( loader, 0 );
+		WriteRegion( loader, 1 );
+		loader.ForceSaveAllChunks();
+		WriteRegion( loader, 2 );
+		ReleaseRegion( loader );
+	}
+	{
+		h_ChunkLoader loader( g_test_directory );
+		for( int i= 0; i < g_chunks_in_region; i++ )
+		{
+			const h_ChunkLoader::ChunkData chunk_data= loader.GetChunkData( i % H_WORLD_REGION_SIZE_X, i / H_WORLD_REGION_SIZE_X );
+			H_TEST_EXPECT( ChunkDataIsEqual( chunk_data, MakeChunkData( i, 2 ) ) );
+		}
+		ReleaseRegion( loader );
+	}
+}
+
+H_TEST(ChunkLoaderCorruptedChunkTest)
+{
+	PrepareTestDirectory();
+	{
+		h_ChunkLoader loader( g_test_directory );
+		WriteRegion( loader, 0 );
+		ReleaseRegion( loader );
+	}
+
+	// Last chunk data is placed at end of file. Break it.
+	std::FILE* const f= std::fopen( g_test_region_file, "r+b" );
+	H_TEST_EXPECT( f != nullptr );
+	std::fseek( f, -1, SEEK_END );
+	const int last_byte= std::fgetc( f );
+	std::fseek( f, -1, SEEK_END );
+	std::fputc( last_byte ^ 0xFF, f );
+	std::fclose( f );
+
+	h_ChunkLoader loader( g_test_directory );
+	for( int i= 0; i < g_chunks_in_region; i++ )
+	{
+		const h_ChunkLoader::ChunkData chunk_data= loader.GetChunkData( i % H_WORLD_REGION_SIZE_X, i / H_WORLD_REGION_SIZE_X );
+		if( i == g_chunks_in_region - 1 )
+		{
+			H_TEST_EXPECT( chunk_data.size == 0 );
+		}
+		else
+		{
+			H_TEST_EXPECT( ChunkDataIsEqual( chunk_data, MakeChunkData( i, 0 ) ) );
+		}
+	}
+	ReleaseRegion( loader );
+}
+
+H_TEST(ChunkLoaderFaultInjectionTest)
+{
+	std::mt19937 rand_generator( 42 );
+
+	// Approximate size of all writes of one region pass.
+	uint64_t pass_size= HEXREGION_header::c_serialized_size;
+	for( int i= 0; i < g_chunks_in_region; i++ )
+		pass_size+= MakeChunkData( i, 1 ).size() + sizeof(uint32_t) + sizeof(FileLump);
+
+	const unsigned int c_trials= 48;
+	unsigned int total_lost_chunks= 0;
+	for( unsigned int trial= 0; trial < c_trials; trial++ )
+	{
+		PrepareTestDirectory();
+		{
+			h_ChunkLoader loader( g_test_directory );
+			WriteRegion( loader, 0 );
+			loader.ForceSaveAllChunks();
+
+			// Kill writer at random point of second pass.
+			h_MappedFile::SetWritesLimit( std::uniform_int_distribution<uint64_t>( 0, pass_size )( rand_generator ) );
+
+			// Write half of chunks, flush, so, space of replaced chunks can be reused, write rest chunks.
+			for( int i= 0; i < g_chunks_in_region; i++ )
+			{
+				const h_BinaryStorage data= MakeChunkData( i, 1 );
+				loader.SetChunkData( i % H_WORLD_REGION_SIZE_X, i / H_WORLD_REGION_SIZE_X, data.data(), data.size() );
+				if( i == g_chunks_in_region / 2 )
+					loader.ForceSaveAllChunks();
+			}
+			ReleaseRegion( loader );
+		}
+		h_MappedFile::SetWritesLimit( h_MappedFile::c_no_writes_limit );
+
+		// Each chunk must have old or new data. Only chunk, which was written during crash, can be lost.
+		h_ChunkLoader loader( g_test_directory );
+		unsigned int lost_chunks= 0;
+		for( int i= 0; i < g_chunks_in_region; i++ )
+		{
+			const h_ChunkLoader::ChunkData chunk_data= loader.GetChunkData( i % H_WORLD_REGION_SIZE_X, i / H_WORLD_REGION_SIZE_X );
+			if( chunk_data.size == 0 )
+				lost_chunks++;
+			else
+			{
+				H_TEST_EXPECT(
+					ChunkDataIsEqual( chunk_data, MakeChunkData( i, 0 ) ) ||
+					ChunkDataIsEqual( chunk_data, MakeChunkData( i, 1 ) ) );
+			}
+		}
+		ReleaseRegion( loader );
+
+		H_TEST_EXPECT( lost_chunks <= 1 );
+		total_lost_chunks+= lost_chunks;
+	}
+
+	std::cout << "\nlost chunks in " << c_trials << " crashes: " << total_lost_chunks << std::endl;
+}
+
+H_TEST(ChunkLoaderReorderedWritesTest)
+{
+	std::mt19937 rand_generator( 43 );
+
+	for( unsigned int flush_each_write= 0; flush_each_write < 2; flush_each_write++ )
+	{
+		// Flushes count of second pass.
+		const unsigned int pass_flushes= flush_each_write ? 2u * g_chunks_in_region : 4u;
+		const unsigned int c_trials= 16;
+		for( unsigned int trial= 0; trial < c_trials; trial++ )
+		{
+			PrepareTestDirectory();
+			{
+				h_ChunkLoader loader( g_test_directory );
+				loader.SetFlushEachWrite( flush_each_write != 0 );
+				WriteRegion( loader, 0 );
+				loader.ForceSaveAllChunks();
+
+				// Kill writer at flush of second pass. Only last not flushed write reaches disk.
+				h_MappedFile::SetReorderedWritesCrash(
+					flush_each_write
+						? std::uniform_int_distribution<uint64_t>( 0, pass_flushes )( rand_generator )
+						: uint64_t( trial % ( pass_flushes + 1u ) ) );
+
+				for( int i= 0; i < g_chunks_in_region; i++ )
+				{
+					const h_BinaryStorage data= MakeChunkData( i, 1 );
+					loader.SetChunkData( i % H_WORLD_REGION_SIZE_X, i / H_WORLD_REGION_SIZE_X, data.data(), data.size() );
+					if( i == g_chunks_in_region / 2 )
+						loader.ForceSaveAllChunks();
+				}
+				ReleaseRegion( loader );
+			}
+			h_MappedFile::SetReorderedWritesCrash( h_MappedFile::c_no_writes_limit );
+
+			// Header on disk must not reference lost data, so, each chunk must have old or new data.
+			h_ChunkLoader loader( g_test_directory );
+			for( int i= 0; i < g_chunks_in_region; i++ )
+			{
+				const h_ChunkLoader::ChunkData chunk_data= loader.GetChunkData( i % H_WORLD_REGION_SIZE_X, i / H_WORLD_REGION_SIZE_X );
+				H_TEST_EXPECT(
+					ChunkDataIsEqual( chunk_data, MakeChunkData( i, 0 ) ) ||
+					ChunkDataIsEqual( chunk_data, MakeChunkData( i, 1 ) ) );
+			}
+			ReleaseRegion( loader );
+		}
+	}
+}
+
+H_TEST(ChunkLoaderOldFormatConversionTest)
+{
+	// Write region in old format - without checksums.
+	std::vector<h_BinaryStorage> chunks_data;
+	h_BinaryStorage file_data;
+	{
+		HEXREGION_header header;
+		std::memcpy( header.format_key, H_REGION_FORMAT_HEADER, sizeof(header.format_key) );
+		header.version= 2;
+		header.datalen= 0;
+		header.longitude= header.latitude= 0;
+
+		h_BinaryStorage data;
+		for( int i= 0; i < g_chunks_in_region; i++ )
+		{
+			chunks_data.push_back( MakeChunkData( i, 0 ) );
+			header.chunk_lumps[i].offset= data.size();
+			header.chunk_lumps[i].size= chunks_data.back().size();
+			data.insert( data.end(), chunks_data.back().begin(), chunks_data.back().end() );
+		}
+
+		h_BinaryOuptutStream stream( file_data );
+		header.Write( stream );
+		stream.Write( data.data(), data.size() );
+	}
+
+	std::mt19937 rand_generator( 24 );
+	const unsigned int c_trials= 16;
+	for( unsigned int trial= 0; trial <= c_trials; trial++ )
+	{
+		PrepareTestDirectory();
+		std::FILE* const f= std::fopen( g_test_region_file, "wb" );
+		std::fwrite( file_data.data(), 1, file_data.size(), f );
+		std::fclose( f );
+
+		// Kill writer during conversion. Last trial - without crash.
+		if( trial < c_trials )
+		{
+			h_MappedFile::SetWritesLimit( std::uniform_int_distribution<uint64_t>( 0, file_data.size() )( rand_generator ) );
+			h_ChunkLoader loader( g_test_directory );
+			loader.GetChunkData( 0, 0 );
+			loader.FreeChunkData( 0, 0 );
+			h_MappedFile::SetWritesLimit( h_MappedFile::c_no_writes_limit );
+		}
+
+		h_ChunkLoader loader( g_test_directory );
+		for( int i= 0; i < g_chunks_in_region; i++ )
+		{
+			const h_ChunkLoader::ChunkData chunk_data= loader.GetChunkData( i % H_WORLD_REGION_SIZE_X, i / H_WORLD_REGION_SIZE_X );
+			H_TEST_EXPECT( ChunkDataIsEqual( chunk_data, chunks_data[i] ) );
+		}
+		ReleaseRegion( loader );
+	}
+}
+
+H_TEST(ChunkLoaderSaveBenchmark)
+{
+	const unsigned int c_passes= 4;
+
+	uint64_t pass_size= 0;
+	for( int i= 0; i < g_chunks_in_region; i++ )
+		pass_size+= MakeChunkData( i, 0 ).size();
+
+	std::cout << std::endl;
+	for( unsigned int flush_each_write= 0; flush_each_write < 2; flush_each_write++ )
+	{
+		PrepareTestDirectory();
+		h_ChunkLoader loader( g_test_directory );
+		loader.SetFlushEachWrite( flush_each_write != 0 );
+
+		const auto t0= std::chrono::steady_clock::now();
+		for( unsigned int pass= 0; pass < c_passes; pass++ )
+		{
+			WriteRegion( loader, pass );
+			loader.ForceSaveAllChunks();
+		}
+		const auto t1= std::chrono::steady_clock::now();
+		ReleaseRegion( loader );
+
+		const double time_s= std::chrono::duration<double>( t1 - t0 ).count();
+		std::cout << ( flush_each_write ? "flush each chunk write" : "batched flush" ) << ": "
+			<< double( pass_size * c_passes ) / ( 1024.0 * 1024.0 ) / time_s << " MB/s, "
+			<< double( g_chunks_in_region * c_passes ) / time_s << " chunks/s" << std::endl;
+	}
+}
+
+H_TEST(ChunkLoaderRegionsCacheTest)
+{
+	PrepareTestDirectory();
+
+	for( unsigned int use_cache= 0; use_cache < 2; use_cache++ )
+	{
+		h_ChunkLoader loader( g_test_directory );
+		loader.SetRegionsCacheSize( use_cache ? h_ChunkLoader::c_default_regions_cache_size : 0u );
+
+		WriteRegion( loader, 0 );
+		ReleaseRegion( loader );
+
+		// Move back and forth across region border.
+		const unsigned int c_iterations= 16;
+		const h_ChunkLoader::Statistics statistics_before= loader.GetStatistics();
+		for( unsigned int i= 0; i < c_iterations; i++ )
+		{
+			const h_BinaryStorage data= MakeChunkData( 0, i );
+			loader.GetChunkData( 0, 0 );
+			loader.SetChunkData( 0, 0, data.data(), data.size() );
+			loader.FreeChunkData( 0, 0 );
+		}
+		const h_ChunkLoader::Statistics& statistics= loader.GetStatistics();
+
+		if( use_cache )
+		{
+			H_TEST_EXPECT( statistics.regions_loaded == statistics_before.regions_loaded );
+			H_TEST_EXPECT( statistics.regions_flushed == statistics_before.regions_flushed );
+		}
+		else
+		{
+			H_TEST_EXPECT( statistics.regions_loaded == statistics_before.regions_loaded + c_iterations );
+			H_TEST_EXPECT( statistics.regions_evicted == statistics_before.regions_evicted + c_iterations );
+		}
+
+		// Cached data must be same, as data on disk.
+		const h_ChunkLoader::ChunkData chunk_data= loader.GetChunkData( 0, 0 );
+		H_TEST_EXPECT( ChunkDataIsEqual( chunk_data, MakeChunkData( 0, c_iterations - 1 ) ) );
+		loader.FreeChunkData( 0, 0 );
+	}
+
+	// Cached regions are flushed on loader destruction.
+	h_ChunkLoader loader( g_test_directory );
+	for( int i= 1; i < g_chunks_in_region; i++ )
+	{
+		const h_ChunkLoader::ChunkData chunk_data= loader.GetChunkData( i % H_WORLD_REGION_SIZE_X, i / H_WORLD_REGION_SIZE_X );
+		H_TEST_EXPECT( ChunkDataIsEqual( chunk_data, MakeChunkData( i, 0 ) ) );
+	}
+	ReleaseRegion( loader );
+}
+
+H_TEST(ChunkLoaderPinnedDataTest)
+{
+	PrepareTestDirectory();
+
+	h_ChunkLoader loader( g_test_directory );
+	WriteRegion( loader, 0 );
+
+	const h_ChunkLoader::ChunkData pinned_data= loader.GetPinnedChunkData( 0, 0 );
+	H_TEST_EXPECT( ChunkDataIsEqual( pinned_data, MakeChunkData( 0, 0 ) ) );
+
+	// Grow region file, so it is remapped. Pinned data must stay valid.
+	const h_BinaryStorage large_data( 32u * 1024u * 1024u, 0x5A );
+	loader.SetChunkData( 1, 0, large_data.data(), large_data.size() );
+	H_TEST_EXPECT( ChunkDataIsEqual( pinned_data, MakeChunkData( 0, 0 ) ) );
+
+	loader.UnpinChunkData( 0, 0 );
+	H_TEST_EXPECT( ChunkDataIsEqual( loader.GetChunkData( 0, 0 ), MakeChunkData( 0, 0 ) ) );
+	H_TEST_EXPECT( ChunkDataIsEqual( loader.GetChunkData( 1, 0 ), large_data ) );
+	ReleaseRegion( loader );
+}
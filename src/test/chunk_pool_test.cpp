@@ -0,0 +1,210 @@
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "test.h"
+#include "test_world.hpp"
+
+#include "../chunk_pool.hpp"
+#include "../world.hpp"
+
+static h_Chunk* NewChunk( h_ChunkPool& pool, h_World& world, const h_BinaryStorage& data )
+{
+	h_BinaryInputStream stream( data );
+	HEXCHUNK_header header;
+	header.Read( stream );
+	return pool.New( &world, header, stream );
+}
+
+// Minor page faults of process. Returns 0, if it is not supported.
+static uint64_t GetPageFaults()
+{
+#ifdef _WIN32
+	return 0;
+#else
+	rusage usage;
+	getrusage( RUSAGE_SELF, &usage );
+	return uint64_t( usage.ru_minflt );
+#endif
+}
+
+H_TEST(ChunkPoolReuseTest)
+{
+	h_World& world= t_GetTestWorld();
+	h_BinaryStorage data;
+	t_WriteChunk( *world.GetChunk( 1, 1 ), data );
+
+	h_ChunkPool pool;
+
+	const uint64_t page_faults_before= GetPageFaults();
+	h_Chunk* const chunk0= NewChunk( pool, world, data );
+	H_TEST_EXPECT( chunk0->Longitude() == world.GetChunk( 1, 1 )->Longitude() );
+	pool.Delete( chunk0 );
+
+	// Storage of deleted chunk must be reused.
+	h_Chunk* const chunk1= NewChunk( pool, world, data );
+	H_TEST_EXPECT( chunk1 == chunk0 );
+	H_TEST_EXPECT( chunk1->GetBlockType( 3, 4, 5 ) == world.GetChunk( 1, 1 )->GetBlockType( 3, 4, 5 ) );
+
+	h_Chunk* const chunk2= NewChunk( pool, world, data );
+	H_TEST_EXPECT( chunk2 != chunk1 );
+	const uint64_t page_faults= GetPageFaults() - page_faults_before;
+
+	const h_ChunkPool::Stats stats= pool.GetStats();
+	H_TEST_EXPECT( stats.chunks_created == 3 );
+	H_TEST_EXPECT( stats.chunks_reused == 1 );
+	// Page faults are measured for this thread, so, they can not exceed page faults of process.
+	H_TEST_EXPECT( stats.page_faults_fresh + stats.page_faults_reused <= page_faults );
+	H_TEST_EXPECT( stats.slabs == 1 );
+	H_TEST_EXPECT( stats.storages_used == 2 );
+	H_TEST_EXPECT( stats.storages_free == 0 );
+	H_TEST_EXPECT( pool.GetReuseRate() > 0.3f && pool.GetReuseRate() < 0.4f );
+
+	pool.Delete( chunk1 );
+	pool.Delete( chunk2 );
+	H_TEST_EXPECT( pool.GetStats().storages_free == 2 );
+}
+
+H_TEST(ChunkPoolRetentionTest)
+{
+	h_World& world= t_GetTestWorld();
+	h_BinaryStorage data;
+	t_WriteChunk( *world.GetChunk( 2, 1 ), data );
+
+	const unsigned int c_thread_count= 4;
+	const unsigned int c_chunks_per_thread= 16;
+
+	h_ChunkPool pool;
+
+	// Create and delete chunks in parallel, like streaming threads do.
+	const auto create_and_delete=
+	[&]
+	{
+		std::vector<std::thread> threads;
+		for( unsigned int t= 0; t < c_thread_count; t++ )
+			threads.emplace_back(
+				[&]
+				{
+					h_Chunk* chunks[ c_chunks_per_thread ];
+					for( h_Chunk*& chunk : chunks )
+						chunk= NewChunk( pool, world, data );
+					for( h_Chunk* const chunk : chunks )
+						pool.Delete( chunk );
+				} );
+		for( std::thread& thread : threads )
+			thread.join();
+	};
+
+	create_and_delete();
+	h_ChunkPool::Stats stats= pool.GetStats();
+	H_TEST_EXPECT( stats.chunks_created == c_thread_count * c_chunks_per_thread );
+	H_TEST_EXPECT( stats.slabs > 1 );
+	H_TEST_EXPECT( stats.storages_used == 0 );
+	H_TEST_EXPECT( stats.storages_free <= stats.storages_total );
+
+	// Free storages are below default limit, so, all of them must be reused.
+	const unsigned int free_storages= stats.storages_free;
+	create_and_delete();
+	stats= pool.GetStats();
+	H_TEST_EXPECT( stats.chunks_reused >= free_storages );
+
+	// Slabs without used storages must be returned to system.
+	pool.SetMaxFreeStorages( 0 );
+	stats= pool.GetStats();
+	H_TEST_EXPECT( stats.slabs == 0 );
+	H_TEST_EXPECT( stats.storages_free == 0 );
+
+	// Used slabs must be kept.
+	h_Chunk* const chunk= NewChunk( pool, world, data );
+	h_Chunk* const chunk2= NewChunk( pool, world, data );
+	pool.Delete( chunk );
+	H_TEST_EXPECT( pool.GetStats().slabs == 1 );
+	H_TEST_EXPECT( pool.GetStats().storages_free == 1 );
+	pool.Delete( chunk2 );
+	H_TEST_EXPECT( pool.GetStats().slabs == 0 );
+}
+
+H_TEST(ChunkPoolBenchmark)
+{
+	h_World& world= t_GetTestWorld();
+	const unsigned int c_rows= 16;
+	const unsigned int c_moves= 32;
+
+	std::vector<h_BinaryStorage> chunks_data( world.ChunkNumberX() );
+	for( unsigned int x= 0; x < world.ChunkNumberX(); x++ )
+		t_WriteChunk( *world.GetChunk( x, 0 ), chunks_data[x] );
+
+	std::cout << std::endl;
+	for( unsigned int mode= 0; mode < 3; mode++ )
+	{
+		h_ChunkPool pool;
+		pool.SetUseHugePages( mode == 2 );
+
+		// Returns time in microseconds and page faults per chunk.
+		std::vector<h_Chunk*> chunks;
+		const auto new_chunks=
+		[&]( const unsigned int rows, double& out_time_us, double& out_page_faults )
+		{
+			const uint64_t page_faults_before= GetPageFaults();
+			const auto t0= std::chrono::steady_clock::now();
+			for( unsigned int i= 0; i < rows; i++ )
+			for( const h_BinaryStorage& data : chunks_data )
+			{
+				h_BinaryInputStream stream( data );
+				HEXCHUNK_header header;
+				header.Read( stream );
+				chunks.push_back( mode != 0 ? pool.New( &world, header, stream ) : new h_Chunk( &world, header, stream ) );
+			}
+			const auto t1= std::chrono::steady_clock::now();
+
+			const double chunk_count= double( rows * chunks_data.size() );
+			out_time_us= std::chrono::duration<double>( t1 - t0 ).count() * 1.0e6 / chunk_count;
+			out_page_faults= double( GetPageFaults() - page_faults_before ) / chunk_count;
+		};
+		const auto delete_chunks=
+		[&]( const unsigned int count )
+		{
+			for( unsigned int i= 0; i < count; i++ )
+			{
+				if( mode != 0 )
+					pool.Delete( chunks.back() );
+				else
+					delete chunks.back();
+				chunks.pop_back();
+			}
+		};
+
+		// World loading - all chunks are created in fresh memory.
+		double load_time_us, load_page_faults;
+		new_chunks( c_rows, load_time_us, load_page_faults );
+
+		// World moving - one row is deleted, one row is created.
+		double move_time_us= 0.0, move_page_faults= 0.0;
+		for( unsigned int i= 0; i < c_moves; i++ )
+		{
+			double time_us, page_faults;
+			delete_chunks( (unsigned int)chunks_data.size() );
+			new_chunks( 1, time_us, page_faults );
+			move_time_us+= time_us / double(c_moves);
+			move_page_faults+= page_faults / double(c_moves);
+		}
+		delete_chunks( (unsigned int)chunks.size() );
+
+		static const char* const c_mode_names[]= { "new/delete", "chunk pool", "chunk pool with huge pages" };
+		std::cout << c_mode_names[mode] << ": "
+			<< "loading " << load_time_us << " us, " << load_page_faults << " page faults per chunk; "
+			<< "moving " << move_time_us << " us, " << move_page_faults << " page faults per chunk";
+		if( mode != 0 )
+		{
+			const h_ChunkPool::Stats stats= pool.GetStats();
+			std::cout << "; measured by pool: "
+				<< stats.page_faults_fresh << " in fresh storages, " << stats.page_faults_reused << " in reused storages";
+			H_TEST_EXPECT( stats.chunks_reused == c_moves * chunks_data.size() );
+		}
+		std::cout << std::endl;
+	}
+}
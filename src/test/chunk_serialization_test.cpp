@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <zlib.h>
+
+#include "test.h"
+#include "test_world.hpp"
+
+#include "../chunk.hpp"
+#include "../world.hpp"
+
+static const unsigned int g_chunk_blocks= H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT;
+
+// Writer of old chunk format - 2 bytes of type and block data for each block.
+static void WriteBlockV1( h_BinaryOuptutStream& stream, const h_Block* block )
+{
+	stream << (unsigned short)block->Type();
+	switch( block->Type() )
+	{
+	case h_BlockType::Water:
+		stream << static_cast<const h_LiquidBlock*>(block)->LiquidLevel();
+		break;
+	case h_BlockType::Grass:
+		stream << static_cast<const h_GrassBlock*>(block)->IsActive();
+		break;
+	case h_BlockType::Fire:
+		stream << static_cast<const h_Fire*>(block)->power_;
+		break;
+	case h_BlockType::BrickPlate:
+	case h_BlockType::BrickHalfblock:
+		stream << (unsigned char)static_cast<const h_NonstandardFormBlock*>(block)->Direction();
+		break;
+	case h_BlockType::FailingBlock:
+		WriteBlockV1( stream, static_cast<const h_FailingBlock*>(block)->GetBlock() );
+		break;
+	default:
+		break;
+	};
+}
+
+static void WriteChunkV1( const h_Chunk& chunk, h_BinaryStorage& out_data )
+{
+	h_BinaryOuptutStream stream( out_data );
+
+	HEXCHUNK_header header;
+	std::memset( &header, 0, sizeof(header) );
+	header.longitude= chunk.Longitude();
+	header.latitude = chunk.Latitude ();
+	header.Write( stream );
+
+	for( unsigned int i= 0; i < g_chunk_blocks; i++ )
+		WriteBlockV1( stream, chunk.GetBlock(i) );
+}
+
+static bool BlocksAreEqual( const h_Block* b0, const h_Block* b1 )
+{
+	if( b0->Type() != b1->Type() )
+		return false;
+
+	switch( b0->Type() )
+	{
+	case h_BlockType::Water:
+		return
+			static_cast<const h_LiquidBlock*>(b0)->LiquidLevel() ==
+			static_cast<const h_LiquidBlock*>(b1)->LiquidLevel();
+	case h_BlockType::Grass:
+		return
+			static_cast<const h_GrassBlock*>(b0)->IsActive() ==
+			static_cast<const h_GrassBlock*>(b1)->IsActive();
+	case h_BlockType::Fire:
+		return
+			static_cast<const h_Fire*>(b0)->power_ ==
+			static_cast<const h_Fire*>(b1)->power_;
+	case h_BlockType::BrickPlate:
+	case h_BlockType::BrickHalfblock:
+		return
+			static_cast<const h_NonstandardFormBlock*>(b0)->Direction() ==
+			static_cast<const h_NonstandardFormBlock*>(b1)->Direction();
+	case h_BlockType::FailingBlock:
+		return
+			BlocksAreEqual(
+				static_cast<const h_FailingBlock*>(b0)->GetBlock(),
+				static_cast<const h_FailingBlock*>(b1)->GetBlock() );
+	default:
+		return true;
+	};
+}
+
+static bool ChunksAreEqual( const h_Chunk& c0, const h_Chunk& c1 )
+{
+	for( unsigned int i= 0; i < g_chunk_blocks; i++ )
+		if( !BlocksAreEqual( c0.GetBlock(i), c1.GetBlock(i) ) )
+			return false;
+	return true;
+}
+
+H_TEST(ChunkSerializationRoundTripTest)
+{
+	h_World& world= t_GetTestWorld();
+
+	for( unsigned int y= 0; y < world.ChunkNumberY(); y++ )
+	for( unsigned int x= 0; x < world.ChunkNumberX(); x++ )
+	{
+		const h_Chunk& chunk= *world.GetChunk( x, y );
+
+		h_BinaryStorage data;
+		t_WriteChunk( chunk, data );
+
+		h_Chunk* const loaded_chunk= t_ReadChunk( world, data );
+		H_TEST_EXPECT( ChunksAreEqual( chunk, *loaded_chunk ) );
+		H_TEST_EXPECT( chunk.GetWaterList().size() == loaded_chunk->GetWaterList().size() );
+		delete loaded_chunk;
+	}
+}
+
+H_TEST(ChunkSerializationStatefulBlocksTest)
+{
+	h_World& world= t_GetTestWorld();
+
+	// Make chunk with all stateful blocks in old format, load it, save and load in new format.
+	h_BinaryStorage data_v1;
+	{
+		h_BinaryOuptutStream stream( data_v1 );
+
+		HEXCHUNK_header header;
+		std::memset( &header, 0, sizeof(header) );
+		header.Write( stream );
+
+		for( unsigned int i= 0; i < g_chunk_blocks; i++ )
+		{
+			const unsigned int z= i & ( H_CHUNK_HEIGHT - 1 );
+			const unsigned int column= i >> H_CHUNK_HEIGHT_LOG2;
+
+			if( z == 0 || z == H_CHUNK_HEIGHT - 1 )
+				stream << (unsigned short)h_BlockType::SphericalBlock;
+			else if( z < 10 )
+				stream << (unsigned short)h_BlockType::Stone;
+			else if( z == 10 )
+				stream << (unsigned short)h_BlockType::Water << (unsigned short)( column * 37 + 1 );
+			else if( z == 11 )
+				stream << (unsigned short)h_BlockType::Grass << bool( column & 1 );
+			else if( z == 12 )
+				stream << (unsigned short)h_BlockType::Fire << (unsigned char)( column & 127 );
+			else if( z == 13 )
+				stream << (unsigned short)h_BlockType::BrickPlate << (unsigned char)( column & 1 ? h_Direction::Up : h_Direction::Down );
+			else if( z == 14 )
+				stream << (unsigned short)h_BlockType::FailingBlock << (unsigned short)h_BlockType::Sand;
+			else if( z == 15 )
+				stream << (unsigned short)h_BlockType::FireStone;
+			else if( z == 16 && ( column & 3 ) == 0 )
+				stream << (unsigned short)h_BlockType::Foliage;
+			else
+				stream << (unsigned short)h_BlockType::Air;
+		}
+	}
+
+	h_Chunk* const chunk_v1= t_ReadChunk( world, data_v1 );
+
+	H_TEST_EXPECT( chunk_v1->GetBlock( 3, 5, 10 )->Type() == h_BlockType::Water );
+	H_TEST_EXPECT( chunk_v1->GetFireList().size() == H_CHUNK_WIDTH * H_CHUNK_WIDTH );
+	H_TEST_EXPECT( chunk_v1->GetFailingBlocks().size() == H_CHUNK_WIDTH * H_CHUNK_WIDTH );
+
+	h_BinaryStorage data_v2;
+	t_WriteChunk( *chunk_v1, data_v2 );
+	h_Chunk* const chunk_v2= t_ReadChunk( world, data_v2 );
+
+	H_TEST_EXPECT( ChunksAreEqual( *chunk_v1, *chunk_v2 ) );
+	H_TEST_EXPECT( chunk_v1->GetWaterList().size() == chunk_v2->GetWaterList().size() );
+	H_TEST_EXPECT( chunk_v1->GetFireList().size() == chunk_v2->GetFireList().size() );
+	H_TEST_EXPECT( chunk_v1->GetLightSourceList().size() == chunk_v2->GetLightSourceList().size() );
+	H_TEST_EXPECT( chunk_v1->GetNonstandartFormBlocksList().size() == chunk_v2->GetNonstandartFormBlocksList().size() );
+	H_TEST_EXPECT( chunk_v1->GetFailingBlocks().size() == chunk_v2->GetFailingBlocks().size() );
+
+	delete chunk_v1;
+	delete chunk_v2;
+}
+
+H_TEST(ChunkSerializationSizeTest)
+{
+	h_World& world= t_GetTestWorld();
+
+	uint64_t size[2]= { 0, 0 };
+	uint64_t compressed_size[2]= { 0, 0 };
+	double compress_time_s[2]= { 0.0, 0.0 };
+
+	h_BinaryStorage data;
+	h_BinaryStorage compressed_data;
+	for( unsigned int y= 0; y < world.ChunkNumberY(); y++ )
+	for( unsigned int x= 0; x < world.ChunkNumberX(); x++ )
+	{
+		for( unsigned int format= 0; format < 2; format++ )
+		{
+			if( format == 0 )
+				WriteChunkV1( *world.GetChunk( x, y ), data );
+			else
+				t_WriteChunk( *world.GetChunk( x, y ), data );
+
+			uLongf result_size= ::compressBound( data.size() );
+			compressed_data.resize( result_size );
+
+			const auto t0= std::chrono::steady_clock::now();
+			::compress( compressed_data.data(), &result_size, data.data(), data.size() );
+			const auto t1= std::chrono::steady_clock::now();
+
+			size[format]+= data.size();
+			compressed_size[format]+= result_size;
+			compress_time_s[format]+= std::chrono::duration<double>( t1 - t0 ).count();
+		}
+	}
+
+	for( unsigned int format= 0; format < 2; format++ )
+	{
+		std::cout << "\nchunk format v" << ( format + 1 ) << ": size " << size[format]
+			<< ", compressed " << compressed_size[format]
+			<< ", compression time " << compress_time_s[format] * 1000.0 << " ms";
+	}
+	std::cout << std::endl;
+
+	// New format must be much smaller.
+	H_TEST_EXPECT( size[1] * 4 < size[0] );
+	H_TEST_EXPECT( compressed_size[1] < compressed_size[0] );
+}
+
+H_TEST(ChunkSerializationAllocationsBenchmark)
+{
+	h_World& world= t_GetTestWorld();
+	const unsigned int c_iterations= 16;
+
+	// Reuse one storage for all chunks, like world does.
+	h_BinaryStorage data;
+	for( unsigned int y= 0; y < world.ChunkNumberY(); y++ )
+	for( unsigned int x= 0; x < world.ChunkNumberX(); x++ )
+		t_WriteChunk( *world.GetChunk( x, y ), data );
+
+	uint64_t total_size= 0;
+	// Storage memory is changed only on reallocation.
+	unsigned int reallocations= 0;
+	const unsigned char* storage_memory= data.data();
+	const auto t0= std::chrono::steady_clock::now();
+
+	for( unsigned int i= 0; i < c_iterations; i++ )
+	for( unsigned int y= 0; y < world.ChunkNumberY(); y++ )
+	for( unsigned int x= 0; x < world.ChunkNumberX(); x++ )
+	{
+		t_WriteChunk( *world.GetChunk( x, y ), data );
+		total_size+= data.size();
+
+		if( data.data() != storage_memory )
+		{
+			reallocations++;
+			storage_memory= data.data();
+		}
+	}
+
+	const auto t1= std::chrono::steady_clock::now();
+
+	const unsigned int chunks= c_iterations * world.ChunkNumberX() * world.ChunkNumberY();
+	std::cout << "\nchunk serialization: " << std::chrono::duration<double>( t1 - t0 ).count() * 1.0e6 / double(chunks) << " us per chunk, "
+		<< double(total_size) / ( 1024.0 * 1024.0 ) / std::chrono::duration<double>( t1 - t0 ).count() << " MB/s, "
+		<< reallocations << " storage reallocations" << std::endl;
+
+	// Serialization into warmed-up storage must not allocate.
+	H_TEST_EXPECT( reallocations == 0 );
+}
+
+H_TEST(ChunkLoadingBenchmark)
+{
+	h_World& world= t_GetTestWorld();
+	const unsigned int c_iterations= 16;
+
+	std::vector<h_BinaryStorage> chunks_data[2];
+	for( unsigned int y= 0; y < world.ChunkNumberY(); y++ )
+	for( unsigned int x= 0; x < world.ChunkNumberX(); x++ )
+	{
+		chunks_data[0].emplace_back();
+		WriteChunkV1( *world.GetChunk( x, y ), chunks_data[0].back() );
+		chunks_data[1].emplace_back();
+		t_WriteChunk( *world.GetChunk( x, y ), chunks_data[1].back() );
+	}
+
+	const unsigned int chunks= c_iterations * chunks_data[0].size();
+
+	for( unsigned int format= 0; format < 2; format++ )
+	{
+		const auto t0= std::chrono::steady_clock::now();
+		for( unsigned int i= 0; i < c_iterations; i++ )
+		for( const h_BinaryStorage& data : chunks_data[format] )
+			delete t_ReadChunk( world, data );
+		const auto t1= std::chrono::steady_clock::now();
+
+		std::cout << "\nchunk format v" << ( format + 1 ) << " loading: "
+			<< std::chrono::duration<double>( t1 - t0 ).count() * 1.0e6 / double(chunks) << " us per chunk";
+	}
+	std::cout << std::endl;
+
+	for( unsigned int i= 0; i < chunks_data[0].size(); i++ )
+	{
+		h_Chunk* const chunk_v1= t_ReadChunk( world, chunks_data[0][i] );
+		h_Chunk* const chunk_v2= t_ReadChunk( world, chunks_data[1][i] );
+		H_TEST_EXPECT( ChunksAreEqual( *chunk_v1, *chunk_v2 ) );
+		delete chunk_v1;
+		delete chunk_v2;
+	}
+}
@@ -0,0 +1,33 @@
+#include "test.h"
+#include "test_world.hpp"
+
+#include "../chunk.hpp"
+#include "../world.hpp"
+
+static const unsigned int g_chunk_blocks= H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT;
+
+H_TEST(ChunkBlockIdsTest)
+{
+	h_World& world= t_GetTestWorld();
+
+	for( unsigned int y= 0; y < world.ChunkNumberY(); y++ )
+	for( unsigned int x= 0; x < world.ChunkNumberX(); x++ )
+	{
+		const h_Chunk& chunk= *world.GetChunk( x, y );
+
+		// Block ids and state index must match blocks.
+		bool types_are_correct= true;
+		for( unsigned int i= 0; i < g_chunk_blocks; i++ )
+			if( chunk.GetBlockType(i) != chunk.GetBlock(i)->Type() ||
+				hBlockIdType( chunk.GetBlockIdsData()[i] ) != chunk.GetBlockType(i) )
+				types_are_correct= false;
+		H_TEST_EXPECT( types_are_correct );
+
+		// Stateful blocks must be resolved from state index.
+		bool water_is_correct= true;
+		for( const h_LiquidBlock* const b : chunk.GetWaterList() )
+			if( chunk.GetBlock( b->x_, b->y_, b->z_ ) != b )
+				water_is_correct= false;
+		H_TEST_EXPECT( water_is_correct );
+	}
+}
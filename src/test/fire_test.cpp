@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "test.h"
+#include "test_world.hpp"
+
+#include "../chunk.hpp"
+#include "../world.hpp"
+
+static const unsigned int g_chunk_blocks= H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT;
+
+H_TEST(ChunkForestFireBenchmark)
+{
+	h_World& world= t_GetTestWorld();
+	const unsigned int c_iterations= 64;
+
+	// Make chunk with large forest fire - half of forest cells are burning.
+	h_BinaryStorage data_v1;
+	{
+		h_BinaryOuptutStream stream( data_v1 );
+
+		HEXCHUNK_header header;
+		std::memset( &header, 0, sizeof(header) );
+		header.Write( stream );
+
+		for( unsigned int i= 0; i < g_chunk_blocks; i++ )
+		{
+			const unsigned int z= i & ( H_CHUNK_HEIGHT - 1 );
+			const unsigned int column= i >> H_CHUNK_HEIGHT_LOG2;
+
+			if( z == 0 || z == H_CHUNK_HEIGHT - 1 )
+				stream << (unsigned short)h_BlockType::SphericalBlock;
+			else if( z < 60 )
+				stream << (unsigned short)h_BlockType::Stone;
+			else if( z < 90 && ( ( column + z ) & 1 ) != 0 )
+				stream << (unsigned short)h_BlockType::Fire << (unsigned char)( ( z * 7 ) & 127 );
+			else if( z < 90 )
+				stream << (unsigned short)( ( column & 7 ) == 0 ? h_BlockType::Wood : h_BlockType::Foliage );
+			else
+				stream << (unsigned short)h_BlockType::Air;
+		}
+	}
+
+	h_Chunk* const chunk_v1= t_ReadChunk( world, data_v1 );
+	const unsigned int fire_count= (unsigned int)chunk_v1->GetFireList().size();
+	const unsigned int allocator_blocks= (unsigned int)chunk_v1->ObjectsAllocatorsBlockCount();
+	h_BinaryStorage data;
+	t_WriteChunk( *chunk_v1, data );
+	delete chunk_v1;
+
+	const auto t0= std::chrono::steady_clock::now();
+
+	for( unsigned int i= 0; i < c_iterations; i++ )
+		delete t_ReadChunk( world, data );
+
+	const auto t1= std::chrono::steady_clock::now();
+
+	std::cout << "\nforest fire chunk with " << fire_count << " fires: "
+		<< std::chrono::duration<double>( t1 - t0 ).count() * 1.0e6 / double(c_iterations) << " us per loading and destruction, "
+		<< allocator_blocks << " allocator blocks" << std::endl;
+
+	// Fires are allocated by pools of chunk, not one by one.
+	H_TEST_EXPECT( allocator_blocks < fire_count / 16 );
+}
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <queue>
+#include <vector>
+
+#include "test.h"
+#include "test_world.hpp"
+
+#include "../chunk.hpp"
+#include "../world.hpp"
+
+// Simple reference light propagation - breadth first search over whole world.
+// Returns light map with index BlockAddr of world coordinates.
+static std::vector<unsigned char> CalculateReferenceLight( const h_World& world, const bool sun )
+{
+	const int size_x= int( world.ChunkNumberX() * H_CHUNK_WIDTH );
+	const int size_y= int( world.ChunkNumberY() * H_CHUNK_WIDTH );
+	const unsigned char transparency_bit= sun ? H_SECONDARY_SUN_LIGHT_TRANSPARENCY_BIT : H_FIRE_LIGHT_TRANSPARENCY_BIT;
+
+	const auto cell_index=
+	[size_y]( const int x, const int y, const int z )
+	{
+		return ( x * size_y + y ) * H_CHUNK_HEIGHT + z;
+	};
+	const auto transparency=
+	[&world]( const int x, const int y, const int z )
+	{
+		const h_Chunk* const ch= world.GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
+		return ch->GetTransparencyData()[ BlockAddr( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), z ) ];
+	};
+
+	std::vector<unsigned char> light( size_x * size_y * H_CHUNK_HEIGHT, 0 );
+
+	// Initial light - direct sun light or light sources.
+	for( int x= 0; x < size_x; x++ )
+	for( int y= 0; y < size_y; y++ )
+	{
+		if( sun )
+		{
+			for( int z= H_CHUNK_HEIGHT - 2; z > 0 && ( transparency( x, y, z ) & H_DIRECT_SUN_LIGHT_TRANSPARENCY_BIT ) != 0; z-- )
+				light[ cell_index( x, y, z ) ]= H_MAX_SUN_LIGHT;
+		}
+	}
+	if( !sun )
+	{
+		for( unsigned int X= 0; X < world.ChunkNumberX(); X++ )
+		for( unsigned int Y= 0; Y < world.ChunkNumberY(); Y++ )
+		for( const unsigned short addr : world.GetChunk( X, Y )->GetLightSourceList() )
+		{
+			const h_LightSource* source= world.GetChunk( X, Y )->GetLightSource( addr );
+			unsigned char& l= light[ cell_index( X * H_CHUNK_WIDTH + source->x_, Y * H_CHUNK_WIDTH + source->y_, source->z_ ) ];
+			l= std::max( l, source->LightLevel() );
+		}
+	}
+
+	struct Cell{ int x, y, z; };
+	std::queue<Cell> queue;
+	for( int x= 0; x < size_x; x++ )
+	for( int y= 0; y < size_y; y++ )
+	for( int z= 1; z < H_CHUNK_HEIGHT - 1; z++ )
+		if( light[ cell_index( x, y, z ) ] > 1 )
+			queue.push( Cell{ x, y, z } );
+
+	while( !queue.empty() )
+	{
+		const Cell cell= queue.front();
+		queue.pop();
+		if( ( transparency( cell.x, cell.y, cell.z ) & transparency_bit ) == 0 )
+			continue;
+
+		const unsigned char l= light[ cell_index( cell.x, cell.y, cell.z ) ];
+		const Cell neighbors[8]=
+		{
+			{ cell.x, cell.y, cell.z + 1 },
+			{ cell.x, cell.y, cell.z - 1 },
+			{ cell.x, cell.y + 1, cell.z },
+			{ cell.x, cell.y - 1, cell.z },
+			{ cell.x + 1, cell.y + ((cell.x+1)&1), cell.z },
+			{ cell.x + 1, cell.y - (cell.x&1), cell.z },
+			{ cell.x - 1, cell.y + ((cell.x+1)&1), cell.z },
+			{ cell.x - 1, cell.y - (cell.x&1), cell.z },
+		};
+		for( const Cell& n : neighbors )
+		{
+			if( n.x < 0 || n.y < 0 || n.x >= size_x || n.y >= size_y || n.z <= 0 || n.z >= H_CHUNK_HEIGHT - 1 )
+				continue;
+
+			unsigned char& neighbor_light= light[ cell_index( n.x, n.y, n.z ) ];
+			if( neighbor_light < l - 1 )
+			{
+				neighbor_light= (unsigned char)( l - 1 );
+				if( neighbor_light > 1 )
+					queue.push( n );
+			}
+		}
+	}
+
+	return light;
+}
+
+static bool WorldLightIsEqualToReference( const h_World& world, const bool sun )
+{
+	const std::vector<unsigned char> reference_light= CalculateReferenceLight( world, sun );
+
+	const int size_x= int( world.ChunkNumberX() * H_CHUNK_WIDTH );
+	const int size_y= int( world.ChunkNumberY() * H_CHUNK_WIDTH );
+	for( int x= 0; x < size_x; x++ )
+	for( int y= 0; y < size_y; y++ )
+	{
+		const h_Chunk* const ch= world.GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
+		for( int z= 1; z < H_CHUNK_HEIGHT - 1; z++ )
+		{
+			const unsigned char l=
+				sun
+					? ch->SunLightLevel ( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), z )
+					: ch->FireLightLevel( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), z );
+			if( l != reference_light[ ( x * size_y + y ) * H_CHUNK_HEIGHT + z ] )
+				return false;
+		}
+	}
+	return true;
+}
+
+H_TEST(LightWorldSunLightTest)
+{
+	H_TEST_EXPECT( WorldLightIsEqualToReference( t_GetTestWorld(), true ) );
+}
+
+H_TEST(LightWorldFireLightTest)
+{
+	H_TEST_EXPECT( WorldLightIsEqualToReference( t_GetTestWorld(), false ) );
+}
+
+static bool WorldLightIsCorrect( const h_World& world )
+{
+	return WorldLightIsEqualToReference( world, true ) && WorldLightIsEqualToReference( world, false );
+}
+
+static h_BlockType GetBlockType( const h_World& world, const int x, const int y, const int z )
+{
+	return world.GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 )->
+		GetBlockType( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), z );
+}
+
+static int ColumnTop( const h_World& world, const int x, const int y )
+{
+	return world.GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 )->
+		HeightMapValue( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1) );
+}
+
+H_TEST(LightBuildDestroyOpaqueBlockTest)
+{
+	h_World& world= t_GetModifiableTestWorld();
+	H_TEST_EXPECT( WorldLightIsCorrect( world ) );
+
+	// Block above ground near chunk border. Its shadow and light removal cross border.
+	const int x= int( world.ChunkNumberX() / 2 ) * H_CHUNK_WIDTH;
+	const int y= int( world.ChunkNumberY() / 2 + 1 ) * H_CHUNK_WIDTH + H_CHUNK_WIDTH / 2;
+	const int z= ColumnTop( world, x, y ) + 3;
+
+	t_WorldTestAccess::Build( world, x, y, z, h_BlockType::Stone );
+	H_TEST_EXPECT( GetBlockType( world, x, y, z ) == h_BlockType::Stone );
+	H_TEST_EXPECT( WorldLightIsCorrect( world ) );
+
+	t_WorldTestAccess::Build( world, x - 1, y, z, h_BlockType::Stone );
+	H_TEST_EXPECT( WorldLightIsCorrect( world ) );
+
+	t_WorldTestAccess::Destroy( world, x, y, z );
+	H_TEST_EXPECT( WorldLightIsCorrect( world ) );
+
+	t_WorldTestAccess::Destroy( world, x - 1, y, z );
+	H_TEST_EXPECT( WorldLightIsCorrect( world ) );
+}
+
+H_TEST(LightBuildDestroyLightSourceTest)
+{
+	h_World& world= t_GetModifiableTestWorld();
+	H_TEST_EXPECT( WorldLightIsCorrect( world ) );
+
+	// Light source near chunk border. Its light spreads into neighbor chunk.
+	const int x= int( world.ChunkNumberX() / 2 + 1 ) * H_CHUNK_WIDTH - 1;
+	const int y= int( world.ChunkNumberY() / 2 + 1 ) * H_CHUNK_WIDTH + H_CHUNK_WIDTH / 2;
+	const int z= ColumnTop( world, x, y ) + 1;
+
+	t_WorldTestAccess::Build( world, x, y, z, h_BlockType::FireStone );
+	H_TEST_EXPECT( GetBlockType( world, x, y, z ) == h_BlockType::FireStone );
+	H_TEST_EXPECT( WorldLightIsCorrect( world ) );
+
+	// Opaque block in light of source, on other side of border.
+	t_WorldTestAccess::Build( world, x + 1, y, z, h_BlockType::Stone );
+	H_TEST_EXPECT( WorldLightIsCorrect( world ) );
+
+	t_WorldTestAccess::Destroy( world, x + 1, y, z );
+	H_TEST_EXPECT( WorldLightIsCorrect( world ) );
+
+	// Light removal crosses chunk border.
+	t_WorldTestAccess::Destroy( world, x, y, z );
+	H_TEST_EXPECT( WorldLightIsCorrect( world ) );
+}
+
+H_TEST(ChunkHeightMapTest)
+{
+	const h_World& world= t_GetTestWorld();
+	for( unsigned int X= 0; X < world.ChunkNumberX(); X++ )
+	for( unsigned int Y= 0; Y < world.ChunkNumberY(); Y++ )
+	{
+		const h_Chunk* const ch= world.GetChunk( X, Y );
+		for( int x= 0; x < H_CHUNK_WIDTH; x++ )
+		for( int y= 0; y < H_CHUNK_WIDTH; y++ )
+		{
+			int z= H_CHUNK_HEIGHT - 2;
+			while( z > 0 && ( ch->Transparency( x, y, z ) & H_DIRECT_SUN_LIGHT_TRANSPARENCY_BIT ) != 0 )
+				z--;
+			H_TEST_EXPECT( ch->HeightMapValue( x, y ) == z );
+		}
+	}
+}
+
+// z of highest block, opaque for direct sun light, found by column scanning.
+static int CalculateColumnTop( const h_World& world, const int x, const int y )
+{
+	const h_Chunk* const ch= world.GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
+
+	int z= H_CHUNK_HEIGHT - 2;
+	while( z > 0 && ( ch->Transparency( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), z ) & H_DIRECT_SUN_LIGHT_TRANSPARENCY_BIT ) != 0 )
+		z--;
+	return z;
+}
+
+H_TEST(ChunkHeightMapUpdateTest)
+{
+	h_World& world= t_GetModifiableTestWorld();
+
+	// Column with solid top block, which can be destroyed.
+	const int y= int( world.ChunkNumberY() / 2 + 1 ) * H_CHUNK_WIDTH + 3;
+	int x= int( world.ChunkNumberX() / 2 - 1 ) * H_CHUNK_WIDTH;
+	while( GetBlockType( world, x, y, ColumnTop( world, x, y ) ) == h_BlockType::Water )
+		x++;
+
+	const int top= ColumnTop( world, x, y );
+	H_TEST_EXPECT( top == CalculateColumnTop( world, x, y ) );
+
+	// Place block above column top and remove it.
+	t_WorldTestAccess::Build( world, x, y, top + 5, h_BlockType::Stone );
+	H_TEST_EXPECT( ColumnTop( world, x, y ) == top + 5 );
+
+	t_WorldTestAccess::Destroy( world, x, y, top + 5 );
+	H_TEST_EXPECT( ColumnTop( world, x, y ) == top );
+
+	// Remove top block of column. New top is lower.
+	t_WorldTestAccess::Destroy( world, x, y, top );
+	H_TEST_EXPECT( ColumnTop( world, x, y ) < top );
+	H_TEST_EXPECT( ColumnTop( world, x, y ) == CalculateColumnTop( world, x, y ) );
+}
+
+H_TEST(ChunkPackedLightTest)
+{
+	const h_World& world= t_GetTestWorld();
+	const h_Chunk* const ch= world.GetChunk( 1, 1 );
+
+	bool light_is_correct= true;
+	for( int x= 0; x < H_CHUNK_WIDTH; x++ )
+	for( int y= 0; y < H_CHUNK_WIDTH; y++ )
+	{
+		unsigned char sun_light[ H_CHUNK_HEIGHT ], fire_light[ H_CHUNK_HEIGHT ];
+		ch->GetLightsLevelColumn( x, y, 0, H_CHUNK_HEIGHT, sun_light, fire_light );
+
+		for( int z= 0; z < H_CHUNK_HEIGHT; z++ )
+		{
+			const unsigned char packed_light= ch->GetLightData()[ BlockAddr( x, y, z ) ];
+			unsigned char lights[2];
+			ch->GetLightsLevel( x, y, z, lights );
+
+			if( sun_light [z] != ch->SunLightLevel ( x, y, z ) || sun_light [z] != lights[0] || sun_light [z] != hPackedSunLight ( packed_light ) ||
+				fire_light[z] != ch->FireLightLevel( x, y, z ) || fire_light[z] != lights[1] || fire_light[z] != hPackedFireLight( packed_light ) ||
+				sun_light[z] > H_MAX_SUN_LIGHT || fire_light[z] > H_MAX_FIRE_LIGHT ||
+				hPackLight( sun_light[z], fire_light[z] ) != packed_light )
+				light_is_correct= false;
+		}
+	}
+
+	H_TEST_EXPECT( light_is_correct );
+}
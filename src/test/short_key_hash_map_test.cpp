@@ -0,0 +1,93 @@
+#include <map>
+
+#include "test.h"
+
+#include "../math_lib/rand.hpp"
+#include "../math_lib/short_key_hash_map.hpp"
+
+typedef ShortKeyHashMap<int> Map;
+
+static bool MapIsEqualToReference( const Map& map, const std::map<unsigned short, int>& reference )
+{
+	if( map.size() != reference.size() )
+		return false;
+
+	for( const auto& value : reference )
+	{
+		const int* const found= map.find( value.first );
+		if( found == nullptr || *found != value.second )
+			return false;
+	}
+
+	size_t iterations= 0;
+	bool values_are_equal= true;
+	map.for_each(
+		[&]( const unsigned short key, const int value )
+		{
+			const auto it= reference.find( key );
+			if( it == reference.end() || it->second != value )
+				values_are_equal= false;
+			iterations++;
+		} );
+
+	return values_are_equal && iterations == reference.size();
+}
+
+H_TEST(ShortKeyHashMapBasicTest)
+{
+	Map map;
+	H_TEST_EXPECT( map.empty() );
+	H_TEST_EXPECT( map.find( 0 ) == nullptr );
+
+	map.insert( 0, 10 );
+	map.insert( 32767, 20 );
+	map.insert( 5, 30 );
+	H_TEST_EXPECT( map.size() == 3 );
+	H_TEST_EXPECT( *map.find( 0 ) == 10 );
+	H_TEST_EXPECT( *map.find( 32767 ) == 20 );
+	H_TEST_EXPECT( *map.find( 5 ) == 30 );
+
+	// Insertion with same key must replace value.
+	map.insert( 5, 40 );
+	H_TEST_EXPECT( map.size() == 3 );
+	H_TEST_EXPECT( *map.find( 5 ) == 40 );
+
+	H_TEST_EXPECT( map.erase( 0 ) );
+	H_TEST_EXPECT( !map.erase( 0 ) );
+	H_TEST_EXPECT( map.find( 0 ) == nullptr );
+	H_TEST_EXPECT( map.size() == 2 );
+
+	map.clear();
+	H_TEST_EXPECT( map.empty() );
+	H_TEST_EXPECT( map.find( 32767 ) == nullptr );
+}
+
+H_TEST(ShortKeyHashMapRandomTest)
+{
+	Map map;
+	std::map<unsigned short, int> reference;
+	m_Rand rand;
+
+	bool is_equal= true;
+	for( unsigned int i= 0; i < 200000; i++ )
+	{
+		// Keys in small range, like chunk cell addresses in column, to get long probe sequences.
+		const unsigned short key= (unsigned short)( ( i & 4096 ) == 0 ? rand.RandI( 32768u ) : rand.RandI( 512u ) );
+		if( rand.RandI( 3u ) == 0 )
+		{
+			if( map.erase( key ) != ( reference.erase( key ) != 0 ) )
+				is_equal= false;
+		}
+		else
+		{
+			map.insert( key, int(i) );
+			reference[key]= int(i);
+		}
+
+		if( i % 10000 == 0 && !MapIsEqualToReference( map, reference ) )
+			is_equal= false;
+	}
+
+	H_TEST_EXPECT( is_equal );
+	H_TEST_EXPECT( MapIsEqualToReference( map, reference ) );
+}
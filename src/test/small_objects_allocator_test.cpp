@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "test.h"
+
+#include "../block.hpp"
+#include "../math_lib/aligned_small_objects_allocator.hpp"
+#include "../math_lib/rand.hpp"
+#include "../math_lib/small_objects_allocator.hpp"
+
+struct AllocatorTestData
+{
+	unsigned int value;
+	unsigned short something;
+};
+
+typedef AlignedSmallObjectsAllocator<AllocatorTestData, 512> TestAllocator;
+
+H_TEST(AlignedSmallObjectsAllocatorRandomTest)
+{
+	TestAllocator allocator;
+	std::vector<AllocatorTestData*> objects;
+	m_Rand randomizer;
+
+	for( unsigned int i= 0; i < 65536; i++ )
+	{
+		if( objects.empty() || randomizer.RandI( 3 ) != 0 )
+		{
+			AllocatorTestData* const object= allocator.New();
+			object->value= i;
+			object->something= (unsigned short)( i * 7u );
+			objects.push_back( object );
+		}
+		else
+		{
+			const unsigned int index= randomizer.Rand() % (unsigned int)objects.size();
+			AllocatorTestData* const object= objects[index];
+			H_TEST_EXPECT( object->something == (unsigned short)( object->value * 7u ) );
+
+			allocator.Delete( object );
+			objects[index]= objects.back();
+			objects.pop_back();
+		}
+	}
+
+	// Objects must not overlap.
+	std::sort( objects.begin(), objects.end() );
+	H_TEST_EXPECT( std::unique( objects.begin(), objects.end() ) == objects.end() );
+	for( const AllocatorTestData* const object : objects )
+		H_TEST_EXPECT( object->something == (unsigned short)( object->value * 7u ) );
+
+	H_TEST_EXPECT( allocator.BlockCount() >= objects.size() / TestAllocator::c_objects_per_block );
+
+	for( AllocatorTestData* const object : objects )
+		allocator.Delete( object );
+	H_TEST_EXPECT( allocator.BlockCount() == TestAllocator::c_default_max_empty_blocks );
+}
+
+H_TEST(AlignedSmallObjectsAllocatorRetentionTest)
+{
+	TestAllocator allocator;
+	std::vector<AllocatorTestData*> objects;
+
+	for( unsigned int i= 0; i < TestAllocator::c_objects_per_block * 2u; i++ )
+		objects.push_back( allocator.Alloc() );
+	H_TEST_EXPECT( allocator.BlockCount() == 2 );
+	H_TEST_EXPECT( allocator.EmptyBlockCount() == 0 );
+
+	// Alloc/free near block boundary must not free block.
+	allocator.Free( objects.back() );
+	objects.back()= allocator.Alloc();
+	allocator.Free( objects.back() );
+	objects.pop_back();
+	H_TEST_EXPECT( allocator.BlockCount() == 2 );
+
+	for( AllocatorTestData* const object : objects )
+		allocator.Free( object );
+	H_TEST_EXPECT( allocator.BlockCount() == 1 );
+	H_TEST_EXPECT( allocator.EmptyBlockCount() == 1 );
+
+	// Retained block must be reused.
+	AllocatorTestData* const object= allocator.Alloc();
+	H_TEST_EXPECT( allocator.BlockCount() == 1 );
+	H_TEST_EXPECT( allocator.EmptyBlockCount() == 0 );
+	allocator.Free( object );
+
+	allocator.SetMaxEmptyBlocks( 0 );
+	H_TEST_EXPECT( allocator.BlockCount() == 0 );
+	H_TEST_EXPECT( allocator.EmptyBlockCount() == 0 );
+}
+
+template<class Allocator>
+static double FloodBenchmark( Allocator& allocator )
+{
+	const unsigned int c_water_blocks= 16384;
+	const unsigned int c_iterations= 64;
+
+	std::vector<h_LiquidBlock*> blocks;
+	blocks.reserve( c_water_blocks );
+	m_Rand randomizer;
+
+	const auto t0= std::chrono::steady_clock::now();
+	for( unsigned int i= 0; i < c_iterations; i++ )
+	{
+		// Water spreads and dries in random order.
+		while( blocks.size() < c_water_blocks )
+			blocks.push_back( allocator.New() );
+		for( unsigned int j= 0; j < c_water_blocks / 2u; j++ )
+		{
+			const unsigned int index= randomizer.Rand() % (unsigned int)blocks.size();
+			allocator.Delete( blocks[index] );
+			blocks[index]= blocks.back();
+			blocks.pop_back();
+		}
+	}
+	for( h_LiquidBlock* const block : blocks )
+		allocator.Delete( block );
+	const auto t1= std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double>( t1 - t0 ).count() * 1.0e3;
+}
+
+H_TEST(SmallObjectsAllocatorsFloodBenchmark)
+{
+	SmallObjectsAllocator< h_LiquidBlock, 256, unsigned char > tree_allocator;
+	AlignedSmallObjectsAllocator< h_LiquidBlock, 4096 > aligned_allocator;
+
+	const double tree_time= FloodBenchmark( tree_allocator );
+	const double aligned_time= FloodBenchmark( aligned_allocator );
+
+	std::cout << std::endl
+		<< "SmallObjectsAllocator: " << tree_time << " ms" << std::endl
+		<< "AlignedSmallObjectsAllocator: " << aligned_time << " ms" << std::endl;
+
+	H_TEST_EXPECT( aligned_allocator.BlockCount() == decltype(aligned_allocator)::c_default_max_empty_blocks );
+}
@@ -0,0 +1,152 @@
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "test_world.hpp"
+
+#include "../renderer/i_world_renderer.hpp"
+#include "../settings.hpp"
+#include "../settings_keys.hpp"
+#include "../world.hpp"
+#include "../world_header.hpp"
+
+static const char g_test_world_directory[]= "test_world";
+static const char g_modifiable_test_world_directory[]= "test_world_modifiable";
+
+// Renderer for modifiable world. Does nothing.
+class TestWorldRenderer final : public r_IWorldRenderer
+{
+public:
+	void Update() override {}
+	void UpdateChunk( unsigned int, unsigned int, bool ) override {}
+	void UpdateChunkWater( unsigned int, unsigned int, bool ) override {}
+	void UpdateWorldPosition( int, int ) override {}
+};
+
+static h_World* CreateTestWorld( const char* const directory, h_SettingsPtr& out_settings )
+{
+#ifdef _WIN32
+	_mkdir( directory );
+#else
+	mkdir( directory, 0755 );
+#endif
+
+	out_settings= std::make_shared<h_Settings>( ( std::string(directory) + "/settings.json" ).c_str() );
+	out_settings->SetSetting( h_SettingsKeys::chunk_number_x, H_MIN_CHUNKS );
+	out_settings->SetSetting( h_SettingsKeys::chunk_number_y, H_MIN_CHUNKS );
+
+	return
+		new h_World(
+			[]( float ) {},
+			out_settings,
+			std::make_shared<h_WorldHeader>(),
+			directory );
+}
+
+h_World& t_GetTestWorld()
+{
+	static h_SettingsPtr settings;
+	static std::unique_ptr<h_World> world;
+
+	if( world == nullptr )
+		world.reset( CreateTestWorld( g_test_world_directory, settings ) );
+
+	return *world;
+}
+
+h_World& t_GetModifiableTestWorld()
+{
+	static h_SettingsPtr settings;
+	static std::unique_ptr<h_World> world;
+
+	if( world == nullptr )
+	{
+		// Remove regions, saved by previous tests run. World is placed near zero longitude and latitude.
+		for( int region_x= -1; region_x <= 0; region_x++ )
+		for( int region_y= -1; region_y <= 0; region_y++ )
+		{
+			const std::string region_file=
+				std::string(g_modifiable_test_world_directory) +
+				"/lon_" + std::to_string( region_x * H_WORLD_REGION_SIZE_X ) +
+				"_lat_" + std::to_string( region_y * H_WORLD_REGION_SIZE_Y ) + "_.region";
+			std::remove( region_file.c_str() );
+		}
+
+		world.reset( t_CreateModifiableWorld( g_modifiable_test_world_directory, settings ) );
+	}
+
+	return *world;
+}
+
+h_World* t_CreateModifiableWorld( const char* const directory, h_SettingsPtr& out_settings )
+{
+	static TestWorldRenderer renderer;
+
+	h_World* const world= CreateTestWorld( directory, out_settings );
+	t_WorldTestAccess::SetRenderer( *world, &renderer );
+	return world;
+}
+
+void t_WriteChunk( const h_Chunk& chunk, h_BinaryStorage& out_data )
+{
+	h_BinaryOuptutStream stream( out_data );
+
+	HEXCHUNK_header header;
+	std::memset( &header, 0, sizeof(header) );
+	std::memcpy( header.format_key, H_CHUNK_FORMAT_HEADER, sizeof(header.format_key) );
+	header.version= H_CHUNK_FORMAT_VERSION;
+	header.longitude= chunk.Longitude();
+	header.latitude = chunk.Latitude ();
+	header.Write( stream );
+
+	chunk.SaveChunkToFile( stream );
+}
+
+h_Chunk* t_ReadChunk( h_World& world, const h_BinaryStorage& data )
+{
+	h_BinaryInputStream stream( data );
+	HEXCHUNK_header header;
+	header.Read( stream );
+	return new h_Chunk( &world, header, stream );
+}
+
+void t_WorldTestAccess::SetRenderer( h_World& world, r_IWorldRenderer* const renderer )
+{
+	world.renderer_= renderer;
+}
+
+void t_WorldTestAccess::Build( h_World& world, const int x, const int y, const int z, const h_BlockType block_type )
+{
+	world.Build( x, y, z, block_type, h_Direction::Forward, h_Direction::Up );
+}
+
+void t_WorldTestAccess::Destroy( h_World& world, const int x, const int y, const int z )
+{
+	world.Destroy( x, y, z );
+}
+
+void t_WorldTestAccess::WaterPhysTick( h_World& world )
+{
+	for( unsigned int y= world.active_area_margins_[1]; y < world.ChunkNumberY() - world.active_area_margins_[1]; y++ )
+	for( unsigned int x= world.active_area_margins_[0]; x < world.ChunkNumberX() - world.active_area_margins_[0]; x++ )
+		world.ChunkWaterPhysTick( x, y );
+
+	world.RelightWaterModifedChunksLight();
+}
+
+void t_WorldTestAccess::MoveWorld( h_World& world, const h_WorldMoveDirection dir )
+{
+	world.MoveWorld( dir );
+}
+
+void t_WorldTestAccess::WaitForChunksSaving( h_World& world )
+{
+	world.WaitForChunksSaving();
+}
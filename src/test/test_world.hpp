@@ -0,0 +1,38 @@
+#pragma once
+#include "../fwd.hpp"
+#include "../hex.hpp"
+#include "../math_lib/binary_stream.hpp"
+
+// Small generated world for tests, which need chunks.
+// World created at first call and shared between tests. Do not modify it.
+h_World& t_GetTestWorld();
+
+// Separate world for tests, which modify world. World is generated again in each tests run.
+// Tests must use own places of world and prepare blocks there.
+h_World& t_GetModifiableTestWorld();
+
+// Create new world in given directory, for tests, which need own world. World renderer does nothing.
+// Settings must live longer, than world.
+h_World* t_CreateModifiableWorld( const char* directory, h_SettingsPtr& out_settings );
+
+// Write chunk header and chunk data in current format - same data, as world saves.
+void t_WriteChunk( const h_Chunk& chunk, h_BinaryStorage& out_data );
+// Create chunk from data with header.
+h_Chunk* t_ReadChunk( h_World& world, const h_BinaryStorage& data );
+
+// Calls of world internals for tests of world logic. Coordinates - relative.
+class t_WorldTestAccess
+{
+public:
+	// Renderer must be set before any world modification.
+	static void SetRenderer( h_World& world, r_IWorldRenderer* renderer );
+
+	static void Build( h_World& world, int x, int y, int z, h_BlockType block_type );
+	static void Destroy( h_World& world, int x, int y, int z );
+
+	// Simulate water of all chunks of active area once and update light, like world tick does.
+	static void WaterPhysTick( h_World& world );
+
+	static void MoveWorld( h_World& world, h_WorldMoveDirection dir );
+	static void WaitForChunksSaving( h_World& world );
+};
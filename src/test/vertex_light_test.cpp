@@ -0,0 +1,185 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "test.h"
+#include "test_world.hpp"
+
+#include "../world.hpp"
+#include "../vertex_light.hpp"
+
+// Columns of test world, for which all neighbor columns exist. Coordinates - relative.
+static void GetTestColumnsRange( const h_World& world, int* out_min, int* out_max )
+{
+	out_min[0]= out_min[1]= 1;
+	out_max[0]= int( world.ChunkNumberX() * H_CHUNK_WIDTH ) - 1;
+	out_max[1]= int( world.ChunkNumberY() * H_CHUNK_WIDTH ) - 1;
+}
+
+static h_VertexLightColumns GetColumns( const h_World& world, const int (&columns_xy)[3][2] )
+{
+	h_VertexLightColumns columns;
+	for( unsigned int i= 0; i < 3; i++ )
+	{
+		const h_Chunk* const ch= world.GetChunk( columns_xy[i][0] >> H_CHUNK_WIDTH_LOG2, columns_xy[i][1] >> H_CHUNK_WIDTH_LOG2 );
+		const unsigned int offset= BlockAddr( columns_xy[i][0] & (H_CHUNK_WIDTH - 1), columns_xy[i][1] & (H_CHUNK_WIDTH - 1), 0 );
+		columns.transparency[i]= ch->GetTransparencyData() + offset;
+		columns.light       [i]= ch->GetLightData() + offset;
+	}
+	return columns;
+}
+
+// Reference vertex light - copy of old per-vertex code.
+static void GetReferenceVertexLight( const h_World& world, const int (&columns_xy)[3][2], const int z, unsigned char* out_light )
+{
+	static const unsigned int div_table[]=
+	{
+		0,
+		65536 * (13+1)/1, 65536 * (13+2)/2, 65536 * (13+3)/3,
+		65536 * (13+4)/4, 65536 * (13+5)/5, 65536 * (13+6)/6,
+	};
+
+	unsigned int block_count= 0;
+	unsigned int light[2]= { 0, 0 };
+	for( unsigned int i= 0; i < 3; i++ )
+	{
+		const int x= columns_xy[i][0], y= columns_xy[i][1];
+		const h_Chunk* const ch= world.GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
+		for( int dz= 0; dz < 2; dz++ )
+		{
+			const int local_x= x & (H_CHUNK_WIDTH - 1), local_y= y & (H_CHUNK_WIDTH - 1);
+			if( ( ch->Transparency( local_x, local_y, z + dz ) & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
+			{
+				light[0]+= ch->SunLightLevel ( local_x, local_y, z + dz );
+				light[1]+= ch->FireLightLevel( local_x, local_y, z + dz );
+				block_count++;
+			}
+		}
+	}
+
+	out_light[0]= ( light[0] * div_table[ block_count ] ) >> 16;
+	out_light[1]= ( light[1] * div_table[ block_count ] ) >> 16;
+}
+
+H_TEST(VertexLightColumnTest)
+{
+	const h_World& world= t_GetTestWorld();
+	int min[2], max[2];
+	GetTestColumnsRange( world, min, max );
+
+	// Check ranges of different size and alignment - for SIMD groups and scalar tails.
+	static const int c_ranges[][2]= { { 0, H_CHUNK_HEIGHT - 1 }, { 1, 17 }, { 5, 20 }, { 37, 90 }, { 110, H_CHUNK_HEIGHT - 1 }, { 64, 65 } };
+
+	bool column_light_is_correct= true;
+	bool vertex_light_is_correct= true;
+	for( int x= min[0]; x < max[0]; x+= 3 )
+	for( int y= min[1]; y < max[1]; y+= 2 )
+	{
+		const int forward_columns[3][2]= { { x, y }, { x, y + 1 }, { x + 1, y + ((x+1)&1) } };
+		const int back_columns[3][2]= { { x, y }, { x, y - 1 }, { x - 1, y - (x&1) } };
+
+		unsigned char reference[2][ H_CHUNK_HEIGHT - 1 ][2];
+		for( int z= 0; z < H_CHUNK_HEIGHT - 1; z++ )
+		{
+			GetReferenceVertexLight( world, forward_columns, z, reference[0][z] );
+			GetReferenceVertexLight( world, back_columns, z, reference[1][z] );
+
+			unsigned char light[2][2];
+			world.GetForwardVertexLight( x, y, z, light[0] );
+			world.GetBackVertexLight( x, y, z, light[1] );
+			if( std::memcmp( light[0], reference[0][z], 2 ) != 0 || std::memcmp( light[1], reference[1][z], 2 ) != 0 )
+				vertex_light_is_correct= false;
+		}
+
+		for( unsigned int k= 0; k < (unsigned int)h_VertexLightKernel::NumKernels; k++ )
+		{
+			const h_VertexLightKernel kernel= h_VertexLightKernel(k);
+			if( !hVertexLightKernelSupported( kernel ) )
+				continue;
+
+			for( const auto& range : c_ranges )
+			{
+				// Use world methods only for best kernel, for other kernels get columns data directly.
+				unsigned char light[2][ H_CHUNK_HEIGHT - 1 ][2];
+				if( kernel == hGetBestVertexLightKernel() )
+				{
+					world.GetForwardVertexLightColumn( x, y, range[0], range[1], light[0][ range[0] ] );
+					world.GetBackVertexLightColumn( x, y, range[0], range[1], light[1][ range[0] ] );
+				}
+				else
+				{
+					for( unsigned int i= 0; i < 2; i++ )
+					{
+						const int (&columns_xy)[3][2]= i == 0 ? forward_columns : back_columns;
+						hCalculateVertexLightColumn( GetColumns( world, columns_xy ), range[0], range[1], light[i][ range[0] ], kernel );
+					}
+				}
+
+				for( unsigned int i= 0; i < 2; i++ )
+				for( int z= range[0]; z < range[1]; z++ )
+					if( std::memcmp( light[i][z], reference[i][z], 2 ) != 0 )
+						column_light_is_correct= false;
+			}
+		}
+	}
+
+	H_TEST_EXPECT( vertex_light_is_correct );
+	H_TEST_EXPECT( column_light_is_correct );
+}
+
+H_TEST(VertexLightBenchmark)
+{
+	const h_World& world= t_GetTestWorld();
+	int min[2], max[2];
+	GetTestColumnsRange( world, min, max );
+
+	const unsigned int c_iterations= 8;
+	const unsigned int vertex_count= c_iterations * ( max[0] - min[0] ) * ( max[1] - min[1] ) * ( H_CHUNK_HEIGHT - 1 ) * 2;
+
+	// Prevent calculations removing by compiler.
+	unsigned int checksum= 0;
+	unsigned char light[ H_CHUNK_HEIGHT - 1 ][2];
+
+	std::cout << std::endl;
+	const auto t0= std::chrono::steady_clock::now();
+	for( unsigned int i= 0; i < c_iterations; i++ )
+	for( int x= min[0]; x < max[0]; x++ )
+	for( int y= min[1]; y < max[1]; y++ )
+	{
+		for( int z= 0; z < H_CHUNK_HEIGHT - 1; z++ )
+			world.GetForwardVertexLight( x, y, z, light[z] );
+		checksum+= light[ x & 63 ][0];
+		for( int z= 0; z < H_CHUNK_HEIGHT - 1; z++ )
+			world.GetBackVertexLight( x, y, z, light[z] );
+		checksum+= light[ y & 63 ][1];
+	}
+	const auto t1= std::chrono::steady_clock::now();
+	std::cout << "per vertex: " << double( vertex_count ) / std::chrono::duration<double>( t1 - t0 ).count() / 1e6 << " Mvertices/s" << std::endl;
+
+	for( unsigned int k= 0; k < (unsigned int)h_VertexLightKernel::NumKernels; k++ )
+	{
+		const h_VertexLightKernel kernel= h_VertexLightKernel(k);
+		if( !hVertexLightKernelSupported( kernel ) )
+			continue;
+
+		const auto t2= std::chrono::steady_clock::now();
+		for( unsigned int i= 0; i < c_iterations; i++ )
+		for( int x= min[0]; x < max[0]; x++ )
+		for( int y= min[1]; y < max[1]; y++ )
+		{
+			const int forward_columns[3][2]= { { x, y }, { x, y + 1 }, { x + 1, y + ((x+1)&1) } };
+			const int back_columns[3][2]= { { x, y }, { x, y - 1 }, { x - 1, y - (x&1) } };
+			for( unsigned int j= 0; j < 2; j++ )
+			{
+				const int (&columns_xy)[3][2]= j == 0 ? forward_columns : back_columns;
+				hCalculateVertexLightColumn( GetColumns( world, columns_xy ), 0, H_CHUNK_HEIGHT - 1, light[0], kernel );
+				checksum+= light[ ( x + y ) & 63 ][j];
+			}
+		}
+		const auto t3= std::chrono::steady_clock::now();
+		std::cout << "column, " << hGetVertexLightKernelName( kernel ) << ": "
+			<< double( vertex_count ) / std::chrono::duration<double>( t3 - t2 ).count() / 1e6 << " Mvertices/s" << std::endl;
+	}
+
+	std::cout << "checksum: " << checksum << std::endl;
+}
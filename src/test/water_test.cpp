@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "test.h"
+#include "test_world.hpp"
+
+#include "../chunk.hpp"
+#include "../world.hpp"
+
+// Basin - ring of stone walls on stone floor, with water inside.
+static const int g_basin_radius= 3;
+static const int g_basin_floor_z= 100;
+static const int g_basin_water_z= g_basin_floor_z + 1;
+static const unsigned int g_max_settle_ticks= 1024;
+
+static bool IsWater( h_World& world, const int x, const int y, const int z )
+{
+	return world.GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 )->
+		GetBlockType( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), z ) == h_BlockType::Water;
+}
+
+static bool IsUnsettledWater( h_World& world, const int x, const int y, const int z )
+{
+	const std::vector<unsigned short>& unsettled=
+		world.GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 )->GetUnsettledWaterList();
+	const unsigned short addr= (unsigned short)BlockAddr( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), z );
+	return std::find( unsettled.begin(), unsettled.end(), addr ) != unsettled.end();
+}
+
+static bool BasinWaterIsUnsettled( h_World& world, const int center_x, const int center_y )
+{
+	for( int x= center_x - g_basin_radius + 1; x < center_x + g_basin_radius; x++ )
+	for( int y= center_y - g_basin_radius + 1; y < center_y + g_basin_radius; y++ )
+		if( IsUnsettledWater( world, x, y, g_basin_water_z ) )
+			return true;
+	return false;
+}
+
+// Make basin in center of chunk, put water into its center and wait, until water settles.
+// Returns true, if water settled.
+static bool MakeSettledBasin( h_World& world, const unsigned int chunk_x, const unsigned int chunk_y )
+{
+	const int center_x= int( chunk_x << H_CHUNK_WIDTH_LOG2 ) + H_CHUNK_WIDTH / 2;
+	const int center_y= int( chunk_y << H_CHUNK_WIDTH_LOG2 ) + H_CHUNK_WIDTH / 2;
+
+	for( int x= center_x - g_basin_radius; x <= center_x + g_basin_radius; x++ )
+	for( int y= center_y - g_basin_radius; y <= center_y + g_basin_radius; y++ )
+	{
+		const bool is_wall= std::abs( x - center_x ) == g_basin_radius || std::abs( y - center_y ) == g_basin_radius;
+		for( int z= g_basin_floor_z; z <= g_basin_water_z + 2; z++ )
+		{
+			t_WorldTestAccess::Destroy( world, x, y, z );
+			if( z == g_basin_floor_z || ( is_wall && z <= g_basin_water_z + 1 ) )
+				t_WorldTestAccess::Build( world, x, y, z, h_BlockType::Stone );
+		}
+	}
+
+	t_WorldTestAccess::Build( world, center_x, center_y, g_basin_water_z, h_BlockType::Water );
+
+	for( unsigned int i= 0; i < g_max_settle_ticks; i++ )
+	{
+		if( !BasinWaterIsUnsettled( world, center_x, center_y ) )
+			return true;
+		t_WorldTestAccess::WaterPhysTick( world );
+	}
+	return false;
+}
+
+H_TEST(WaterSettlesTest)
+{
+	h_World& world= t_GetModifiableTestWorld();
+	const unsigned int chunk_x= world.ChunkNumberX() / 2, chunk_y= world.ChunkNumberY() / 2;
+	const int center_x= int( chunk_x << H_CHUNK_WIDTH_LOG2 ) + H_CHUNK_WIDTH / 2;
+	const int center_y= int( chunk_y << H_CHUNK_WIDTH_LOG2 ) + H_CHUNK_WIDTH / 2;
+
+	H_TEST_EXPECT( MakeSettledBasin( world, chunk_x, chunk_y ) );
+
+	// Water spreads over whole basin and stays there.
+	unsigned int total_level= 0;
+	bool basin_is_full= true;
+	for( int x= center_x - g_basin_radius + 1; x < center_x + g_basin_radius; x++ )
+	for( int y= center_y - g_basin_radius + 1; y < center_y + g_basin_radius; y++ )
+	{
+		if( !IsWater( world, x, y, g_basin_water_z ) )
+		{
+			basin_is_full= false;
+			continue;
+		}
+		total_level+=
+			static_cast<const h_LiquidBlock*>(
+				world.GetChunk( chunk_x, chunk_y )->GetBlock( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), g_basin_water_z ) )->
+			LiquidLevel();
+	}
+	H_TEST_EXPECT( basin_is_full );
+	H_TEST_EXPECT( total_level == H_MAX_WATER_LEVEL );
+
+	// Settled water is not simulated again.
+	for( unsigned int i= 0; i < 16; i++ )
+	{
+		t_WorldTestAccess::WaterPhysTick( world );
+		H_TEST_EXPECT( !BasinWaterIsUnsettled( world, center_x, center_y ) );
+	}
+}
+
+H_TEST(WaterWakesAfterBlockDestroyingTest)
+{
+	h_World& world= t_GetModifiableTestWorld();
+	const unsigned int chunk_x= world.ChunkNumberX() / 2 - 1, chunk_y= world.ChunkNumberY() / 2 - 1;
+	const int center_x= int( chunk_x << H_CHUNK_WIDTH_LOG2 ) + H_CHUNK_WIDTH / 2;
+	const int center_y= int( chunk_y << H_CHUNK_WIDTH_LOG2 ) + H_CHUNK_WIDTH / 2;
+
+	H_TEST_EXPECT( MakeSettledBasin( world, chunk_x, chunk_y ) );
+
+	// Make hole in wall. Water near hole must flow into it.
+	const int hole_x= center_x, hole_y= center_y + g_basin_radius;
+	t_WorldTestAccess::Destroy( world, hole_x, hole_y, g_basin_water_z );
+	H_TEST_EXPECT( IsUnsettledWater( world, hole_x, hole_y - 1, g_basin_water_z ) );
+
+	t_WorldTestAccess::WaterPhysTick( world );
+	H_TEST_EXPECT( IsWater( world, hole_x, hole_y, g_basin_water_z ) );
+}
+
+H_TEST(WaterWakesAfterBlastTest)
+{
+	h_World& world= t_GetModifiableTestWorld();
+	const unsigned int chunk_x= world.ChunkNumberX() / 2, chunk_y= world.ChunkNumberY() / 2 - 1;
+	const int center_x= int( chunk_x << H_CHUNK_WIDTH_LOG2 ) + H_CHUNK_WIDTH / 2;
+	const int center_y= int( chunk_y << H_CHUNK_WIDTH_LOG2 ) + H_CHUNK_WIDTH / 2;
+
+	H_TEST_EXPECT( MakeSettledBasin( world, chunk_x, chunk_y ) );
+
+	// Blast with radius 1 destroys only one block.
+	const int hole_x= center_x, hole_y= center_y - g_basin_radius;
+	world.Blast( hole_x, hole_y, g_basin_water_z, 1 );
+	H_TEST_EXPECT( IsUnsettledWater( world, hole_x, hole_y + 1, g_basin_water_z ) );
+
+	t_WorldTestAccess::WaterPhysTick( world );
+	H_TEST_EXPECT( IsWater( world, hole_x, hole_y, g_basin_water_z ) );
+}
@@ -0,0 +1,57 @@
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <memory>
+#include <string>
+
+#include "test.h"
+#include "test_world.hpp"
+
+#include "../chunk.hpp"
+#include "../world.hpp"
+
+static const char g_save_failure_world_directory[]= "test_world_save_failure";
+
+static void MakeDirectory( const std::string& directory )
+{
+#ifdef _WIN32
+	_mkdir( directory.c_str() );
+#else
+	mkdir( directory.c_str(), 0755 );
+#endif
+}
+
+H_TEST(WorldKeepsChunkAfterSaveFailureTest)
+{
+	// Directories in place of region files - regions can not be created, so, each chunk saving fails.
+	// World is placed near zero longitude and latitude.
+	MakeDirectory( g_save_failure_world_directory );
+	for( int region_x= -2; region_x <= 1; region_x++ )
+	for( int region_y= -2; region_y <= 1; region_y++ )
+		MakeDirectory(
+			std::string(g_save_failure_world_directory) +
+			"/lon_" + std::to_string( region_x * H_WORLD_REGION_SIZE_X ) +
+			"_lat_" + std::to_string( region_y * H_WORLD_REGION_SIZE_Y ) + "_.region" );
+
+	h_SettingsPtr settings;
+	std::unique_ptr<h_World> world( t_CreateModifiableWorld( g_save_failure_world_directory, settings ) );
+
+	// Modify chunk of west column.
+	const int x= H_CHUNK_WIDTH / 2, y= int( world->ChunkNumberY() / 2 * H_CHUNK_WIDTH ) + H_CHUNK_WIDTH / 2, z= H_CHUNK_HEIGHT - 2;
+	t_WorldTestAccess::Destroy( *world, x, y, z );
+	t_WorldTestAccess::Build( *world, x, y, z, h_BlockType::Stone );
+
+	// Release west column. Its saving fails, saving retry fails too.
+	t_WorldTestAccess::MoveWorld( *world, EAST );
+	t_WorldTestAccess::WaitForChunksSaving( *world );
+	t_WorldTestAccess::WaitForChunksSaving( *world );
+
+	// Modified chunk must be returned back, not loaded or generated again.
+	t_WorldTestAccess::MoveWorld( *world, WEST );
+	H_TEST_EXPECT(
+		world->GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 )->
+		GetBlockType( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), z ) == h_BlockType::Stone );
+}
@@ -0,0 +1,355 @@
+#include "hex.hpp"
+#include "vertex_light.hpp"
+#include "math_lib/assert.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define H_VERTEX_LIGHT_SSE2
+#include <emmintrin.h>
+
+#if defined(__GNUC__) || defined(_MSC_VER)
+#define H_VERTEX_LIGHT_AVX2
+#include <immintrin.h>
+#ifdef __GNUC__
+// Compile AVX2 kernel without global AVX2 flag, kernel is selected in runtime.
+#define H_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#include <intrin.h>
+#define H_TARGET_AVX2
+#endif
+#endif
+#endif
+
+// Table for replacement of division in vertex light calculation.
+// This method not precise, but fast.
+static const unsigned int g_vertex_light_div_shift= 16;
+static const unsigned int g_vertex_light_div_table_multiplier= 1 << g_vertex_light_div_shift;
+static const unsigned int g_vertex_light_div_table[]=
+{
+	0,
+	g_vertex_light_div_table_multiplier * (13+1)/1,
+	g_vertex_light_div_table_multiplier * (13+2)/2,
+	g_vertex_light_div_table_multiplier * (13+3)/3,
+	g_vertex_light_div_table_multiplier * (13+4)/4,
+	g_vertex_light_div_table_multiplier * (13+5)/5,
+	g_vertex_light_div_table_multiplier * (13+6)/6,
+};
+
+// Max sum of light is 6 * H_MAX_FIRE_LIGHT, result of division is less, than 256.
+// In SIMD kernels sum multiplied by integer and fractional parts of table value separately,
+// ( sum * table[n] ) >> 16 == sum * ( table[n] >> 16 ) + ( ( sum * ( table[n] & 65535 ) ) >> 16 ).
+static_assert( 6 * H_MAX_FIRE_LIGHT < 256, "Light sum does not fit into byte" );
+static_assert( H_MAX_FIRE_LIGHT * ( 13 + 6 ) < 256, "Vertex light does not fit into byte" );
+
+static bool IsVisible( const unsigned char transparency )
+{
+	return ( transparency & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID;
+}
+
+static void CalculateVertexLightColumnScalar(
+	const h_VertexLightColumns& columns,
+	const unsigned int z_begin, const unsigned int z_end,
+	unsigned char* out_light )
+{
+	for( unsigned int z= z_begin; z < z_end; z++, out_light+= 2 )
+	{
+		unsigned int block_count= 0;
+		unsigned int light[2]= { 0, 0 };
+
+		for( unsigned int i= 0; i < 3; i++ )
+		for( unsigned int dz= 0; dz < 2; dz++ )
+		{
+			if( IsVisible( columns.transparency[i][ z + dz ] ) )
+			{
+				light[0]+= hPackedSunLight ( columns.light[i][ z + dz ] );
+				light[1]+= hPackedFireLight( columns.light[i][ z + dz ] );
+				block_count++;
+			}
+		}
+
+		out_light[0]= ( light[0] * g_vertex_light_div_table[ block_count ] ) >> g_vertex_light_div_shift;
+		out_light[1]= ( light[1] * g_vertex_light_div_table[ block_count ] ) >> g_vertex_light_div_shift;
+	}
+}
+
+#ifdef H_VERTEX_LIGHT_SSE2
+
+static void Sse2DivFactors( const __m128i count, __m128i& out_int, __m128i& out_frac )
+{
+	// Select integer and fractional parts of table values by block count.
+	out_int= out_frac= _mm_setzero_si128();
+	for( int n= 1; n <= 6; n++ )
+	{
+		const __m128i mask= _mm_cmpeq_epi16( count, _mm_set1_epi16( short(n) ) );
+		out_int = _mm_or_si128( out_int , _mm_and_si128( mask, _mm_set1_epi16( short( g_vertex_light_div_table[n] >> 16 ) ) ) );
+		out_frac= _mm_or_si128( out_frac, _mm_and_si128( mask, _mm_set1_epi16( short( g_vertex_light_div_table[n] & 65535 ) ) ) );
+	}
+}
+
+static __m128i Sse2Divide( const __m128i sum, const __m128i* div_int, const __m128i* div_frac )
+{
+	const __m128i zero= _mm_setzero_si128();
+	const __m128i sum_lo= _mm_unpacklo_epi8( sum, zero );
+	const __m128i sum_hi= _mm_unpackhi_epi8( sum, zero );
+
+	return
+		_mm_packus_epi16(
+			_mm_add_epi16( _mm_mullo_epi16( sum_lo, div_int[0] ), _mm_mulhi_epu16( sum_lo, div_frac[0] ) ),
+			_mm_add_epi16( _mm_mullo_epi16( sum_hi, div_int[1] ), _mm_mulhi_epu16( sum_hi, div_frac[1] ) ) );
+}
+
+// Calculate light of 16 vertices, starting from z.
+static void CalculateVertexLightGroupSSE2(
+	const h_VertexLightColumns& columns,
+	const unsigned int z,
+	unsigned char* const out_light )
+{
+	const __m128i zero= _mm_setzero_si128();
+	const __m128i visibly_transparency_bits= _mm_set1_epi8( H_VISIBLY_TRANSPARENCY_BITS );
+	const __m128i solid= _mm_set1_epi8( TRANSPARENCY_SOLID );
+	const __m128i light_mask= _mm_set1_epi8( H_LIGHT_MASK );
+
+	__m128i sun_sum= zero, fire_sum= zero, count= zero;
+	for( unsigned int i= 0; i < 3; i++ )
+	for( unsigned int dz= 0; dz < 2; dz++ )
+	{
+		const __m128i transparency= _mm_loadu_si128( reinterpret_cast<const __m128i*>( columns.transparency[i] + z + dz ) );
+		// 0 for solid blocks, 0xFF for others.
+		const __m128i visible= _mm_xor_si128(
+			_mm_cmpeq_epi8( _mm_and_si128( transparency, visibly_transparency_bits ), solid ),
+			_mm_set1_epi8( -1 ) );
+
+		// SSE has no 8-bit shifts, so, shift 16-bit values and mask bits of neighbor bytes.
+		const __m128i light= _mm_and_si128( visible, _mm_loadu_si128( reinterpret_cast<const __m128i*>( columns.light[i] + z + dz ) ) );
+		sun_sum = _mm_add_epi8( sun_sum , _mm_and_si128( light, light_mask ) );
+		fire_sum= _mm_add_epi8( fire_sum, _mm_and_si128( _mm_srli_epi16( light, H_LIGHT_BITS ), light_mask ) );
+		count= _mm_sub_epi8( count, visible );
+	}
+
+	__m128i div_int[2], div_frac[2];
+	Sse2DivFactors( _mm_unpacklo_epi8( count, zero ), div_int[0], div_frac[0] );
+	Sse2DivFactors( _mm_unpackhi_epi8( count, zero ), div_int[1], div_frac[1] );
+
+	const __m128i sun = Sse2Divide( sun_sum , div_int, div_frac );
+	const __m128i fire= Sse2Divide( fire_sum, div_int, div_frac );
+
+	_mm_storeu_si128( reinterpret_cast<__m128i*>( out_light      ), _mm_unpacklo_epi8( sun, fire ) );
+	_mm_storeu_si128( reinterpret_cast<__m128i*>( out_light + 16 ), _mm_unpackhi_epi8( sun, fire ) );
+}
+
+// Range must contain at least 16 vertices.
+static void CalculateVertexLightColumnSSE2(
+	const h_VertexLightColumns& columns,
+	const unsigned int z_begin, const unsigned int z_end,
+	unsigned char* const out_light )
+{
+	unsigned int z= z_begin;
+	for( ; z + 16 <= z_end; z+= 16 )
+		CalculateVertexLightGroupSSE2( columns, z, out_light + ( z - z_begin ) * 2 );
+
+	// Calculate rest vertices in group, overlapping with previous one.
+	if( z < z_end )
+		CalculateVertexLightGroupSSE2( columns, z_end - 16, out_light + ( z_end - 16 - z_begin ) * 2 );
+}
+
+#endif // H_VERTEX_LIGHT_SSE2
+
+#ifdef H_VERTEX_LIGHT_AVX2
+
+// Bytes of division table values, for lookup by shuffle.
+struct DivTableBytes
+{
+	alignas(16) unsigned char int_part[16];
+	alignas(16) unsigned char frac_lo[16];
+	alignas(16) unsigned char frac_hi[16];
+};
+
+static DivTableBytes MakeDivTableBytes()
+{
+	DivTableBytes result= {};
+	for( unsigned int n= 0; n <= 6; n++ )
+	{
+		result.int_part[n]= (unsigned char)( g_vertex_light_div_table[n] >> 16 );
+		result.frac_lo [n]= (unsigned char)( g_vertex_light_div_table[n] );
+		result.frac_hi [n]= (unsigned char)( g_vertex_light_div_table[n] >> 8 );
+	}
+	return result;
+}
+
+static const DivTableBytes g_div_table_bytes= MakeDivTableBytes();
+
+H_TARGET_AVX2 static __m256i Avx2Divide( const __m128i sum, const __m256i div_int, const __m256i div_frac )
+{
+	const __m256i sum_extended= _mm256_cvtepu8_epi16( sum );
+	return _mm256_add_epi16( _mm256_mullo_epi16( sum_extended, div_int ), _mm256_mulhi_epu16( sum_extended, div_frac ) );
+}
+
+// Calculate light of 16 vertices, starting from z.
+// Sums are calculated in bytes, like in SSE2 kernel, but division is performed for all 16 vertices at once.
+H_TARGET_AVX2 static void CalculateVertexLightGroupAVX2(
+	const h_VertexLightColumns& columns,
+	const unsigned int z,
+	unsigned char* const out_light )
+{
+	const __m128i zero= _mm_setzero_si128();
+	const __m128i visibly_transparency_bits= _mm_set1_epi8( H_VISIBLY_TRANSPARENCY_BITS );
+	const __m128i solid= _mm_set1_epi8( TRANSPARENCY_SOLID );
+	const __m128i light_mask= _mm_set1_epi8( H_LIGHT_MASK );
+
+	__m128i sun_sum= zero, fire_sum= zero, count= zero;
+	for( unsigned int i= 0; i < 3; i++ )
+	for( unsigned int dz= 0; dz < 2; dz++ )
+	{
+		const __m128i transparency= _mm_loadu_si128( reinterpret_cast<const __m128i*>( columns.transparency[i] + z + dz ) );
+		// 0 for solid blocks, 0xFF for others.
+		const __m128i visible= _mm_xor_si128(
+			_mm_cmpeq_epi8( _mm_and_si128( transparency, visibly_transparency_bits ), solid ),
+			_mm_set1_epi8( -1 ) );
+
+		const __m128i light= _mm_and_si128( visible, _mm_loadu_si128( reinterpret_cast<const __m128i*>( columns.light[i] + z + dz ) ) );
+		sun_sum = _mm_add_epi8( sun_sum , _mm_and_si128( light, light_mask ) );
+		fire_sum= _mm_add_epi8( fire_sum, _mm_and_si128( _mm_srli_epi16( light, H_LIGHT_BITS ), light_mask ) );
+		count= _mm_sub_epi8( count, visible );
+	}
+
+	// Select bytes of table values by block count, using shuffle as table lookup.
+	const __m128i div_int_table    = _mm_load_si128( reinterpret_cast<const __m128i*>( g_div_table_bytes.int_part ) );
+	const __m128i div_frac_lo_table= _mm_load_si128( reinterpret_cast<const __m128i*>( g_div_table_bytes.frac_lo  ) );
+	const __m128i div_frac_hi_table= _mm_load_si128( reinterpret_cast<const __m128i*>( g_div_table_bytes.frac_hi  ) );
+
+	const __m256i div_int= _mm256_cvtepu8_epi16( _mm_shuffle_epi8( div_int_table, count ) );
+	const __m256i div_frac=
+		_mm256_or_si256(
+			_mm256_cvtepu8_epi16( _mm_shuffle_epi8( div_frac_lo_table, count ) ),
+			_mm256_slli_epi16( _mm256_cvtepu8_epi16( _mm_shuffle_epi8( div_frac_hi_table, count ) ), 8 ) );
+
+	// Sun light in low byte, fire light in high byte - same order, as in output.
+	const __m256i light=
+		_mm256_or_si256(
+			Avx2Divide( sun_sum, div_int, div_frac ),
+			_mm256_slli_epi16( Avx2Divide( fire_sum, div_int, div_frac ), 8 ) );
+	_mm256_storeu_si256( reinterpret_cast<__m256i*>( out_light ), light );
+}
+
+// Range must contain at least 16 vertices.
+H_TARGET_AVX2 static void CalculateVertexLightColumnAVX2(
+	const h_VertexLightColumns& columns,
+	const unsigned int z_begin, const unsigned int z_end,
+	unsigned char* const out_light )
+{
+	unsigned int z= z_begin;
+	for( ; z + 16 <= z_end; z+= 16 )
+		CalculateVertexLightGroupAVX2( columns, z, out_light + ( z - z_begin ) * 2 );
+
+	// Calculate rest vertices in group, overlapping with previous one.
+	if( z < z_end )
+		CalculateVertexLightGroupAVX2( columns, z_end - 16, out_light + ( z_end - 16 - z_begin ) * 2 );
+}
+
+static bool CpuSupportsAVX2()
+{
+#ifdef __GNUC__
+	return __builtin_cpu_supports( "avx2" );
+#else
+	int regs[4];
+	__cpuid( regs, 1 );
+	// OS must save AVX registers.
+	if( ( regs[2] & ( 1 << 27 ) ) == 0 || ( _xgetbv(0) & 6 ) != 6 )
+		return false;
+	__cpuidex( regs, 7, 0 );
+	return ( regs[1] & ( 1 << 5 ) ) != 0;
+#endif
+}
+
+#endif // H_VERTEX_LIGHT_AVX2
+
+bool hVertexLightKernelSupported( const h_VertexLightKernel kernel )
+{
+	switch( kernel )
+	{
+	case h_VertexLightKernel::Scalar:
+		return true;
+
+	case h_VertexLightKernel::SSE2:
+#ifdef H_VERTEX_LIGHT_SSE2
+		return true;
+#else
+		return false;
+#endif
+
+	case h_VertexLightKernel::AVX2:
+#ifdef H_VERTEX_LIGHT_AVX2
+		{
+			static const bool supported= CpuSupportsAVX2();
+			return supported;
+		}
+#else
+		return false;
+#endif
+
+	case h_VertexLightKernel::NumKernels:
+		break;
+	}
+
+	return false;
+}
+
+h_VertexLightKernel hGetBestVertexLightKernel()
+{
+	static const h_VertexLightKernel best_kernel=
+		hVertexLightKernelSupported( h_VertexLightKernel::AVX2 )
+			? h_VertexLightKernel::AVX2
+			: ( hVertexLightKernelSupported( h_VertexLightKernel::SSE2 ) ? h_VertexLightKernel::SSE2 : h_VertexLightKernel::Scalar );
+
+	return best_kernel;
+}
+
+const char* hGetVertexLightKernelName( const h_VertexLightKernel kernel )
+{
+	switch( kernel )
+	{
+	case h_VertexLightKernel::Scalar: return "scalar";
+	case h_VertexLightKernel::SSE2: return "SSE2";
+	case h_VertexLightKernel::AVX2: return "AVX2";
+	case h_VertexLightKernel::NumKernels: break;
+	}
+
+	return "";
+}
+
+void hCalculateVertexLightColumn(
+	const h_VertexLightColumns& columns,
+	const unsigned int z_begin, const unsigned int z_end,
+	unsigned char* const out_light )
+{
+	hCalculateVertexLightColumn( columns, z_begin, z_end, out_light, hGetBestVertexLightKernel() );
+}
+
+void hCalculateVertexLightColumn(
+	const h_VertexLightColumns& columns,
+	const unsigned int z_begin, const unsigned int z_end,
+	unsigned char* const out_light,
+	const h_VertexLightKernel kernel )
+{
+	H_ASSERT( z_begin <= z_end );
+	H_ASSERT( z_end <= H_CHUNK_HEIGHT - 1 );
+	H_ASSERT( hVertexLightKernelSupported( kernel ) );
+
+	// SIMD kernels process vertices by groups of 16, use scalar kernel for short ranges.
+	const unsigned int vertex_count= z_end - z_begin;
+#ifdef H_VERTEX_LIGHT_AVX2
+	if( kernel == h_VertexLightKernel::AVX2 && vertex_count >= 16 )
+	{
+		CalculateVertexLightColumnAVX2( columns, z_begin, z_end, out_light );
+		return;
+	}
+#endif
+#ifdef H_VERTEX_LIGHT_SSE2
+	if( kernel == h_VertexLightKernel::SSE2 && vertex_count >= 16 )
+	{
+		CalculateVertexLightColumnSSE2( columns, z_begin, z_end, out_light );
+		return;
+	}
+#endif
+
+	CalculateVertexLightColumnScalar( columns, z_begin, z_end, out_light );
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Vertex light is average light of not solid prisms around vertex.
+// Vertex of upper hexagon of prism touches three prisms of same level and three prisms above.
+// Functions below calculate light of such vertices for whole column at once.
+
+enum class h_VertexLightKernel
+{
+	Scalar,
+	SSE2,
+	AVX2,
+	NumKernels,
+};
+
+// Returns true, if kernel is compiled and supported by current CPU.
+bool hVertexLightKernelSupported( h_VertexLightKernel kernel );
+// Fastest kernel, supported by current CPU.
+h_VertexLightKernel hGetBestVertexLightKernel();
+const char* hGetVertexLightKernelName( h_VertexLightKernel kernel );
+
+// Data of three prism columns around vertex column. Each pointer points to begin of chunk column.
+struct h_VertexLightColumns
+{
+	const unsigned char* transparency[3];
+	const unsigned char* light[3]; // Packed sun and fire light.
+};
+
+// Calculate light of vertices with z in range [ z_begin; z_end ). z_end must be not greater, than H_CHUNK_HEIGHT - 1.
+// out_light - array of ( z_end - z_begin ) pairs of sun and fire light, first pair is light of vertex z_begin.
+// SIMD kernels process vertices by groups of 16, shorter ranges are processed without SIMD.
+void hCalculateVertexLightColumn(
+	const h_VertexLightColumns& columns,
+	unsigned int z_begin, unsigned int z_end,
+	unsigned char* out_light );
+
+void hCalculateVertexLightColumn(
+	const h_VertexLightColumns& columns,
+	unsigned int z_begin, unsigned int z_end,
+	unsigned char* out_light,
+	h_VertexLightKernel kernel );
@@ -1,8 +1,6 @@
 #include <chrono>
 #include <cstring>
 
-#include <zlib.h>
-
 #include "world.hpp"
 #include "player.hpp"
 #include "math_lib/math.hpp"
@@ -12,6 +10,7 @@
 #include "world_generator/world_generator.hpp"
 #include "world_header.hpp"
 #include "world_phys_mesh.hpp"
+#include "parallel_for.hpp"
 #include "path_finder.hpp"
 #include "console.hpp"
 #include "time.hpp"
@@ -26,69 +25,6 @@ static constexpr const unsigned int g_northern_hemisphere_summer_solstice_day= g
 static constexpr const float g_planet_rotation_axis_inclination= 23.439281f * m_Math::deg2rad;
 static constexpr const float g_global_world_latitude= 40.0f * m_Math::deg2rad;
 
-// Returns true, if all is ok.
-// Replaces "out_data_compressed" content on success.
-// Clears "out_data_compressed" on failure.
-static bool CompressChunkData(
-	const h_BinaryStorage& data,
-	h_BinaryStorage& out_data_compressed )
-{
-	out_data_compressed.clear();
-
-	const int compress_bound= ::compressBound( data.size() );
-	out_data_compressed.resize( sizeof(uint32_t) + compress_bound );
-	uLongf result_size= compress_bound;
-	const int compress_code=
-		::compress(
-			out_data_compressed.data() + sizeof(uint32_t), &result_size,
-			data.data(), data.size() );
-	if( compress_code != Z_OK )
-	{
-		h_Console::Error( "Can not compress, code: ", compress_code );
-		return false;
-	}
-
-	out_data_compressed.resize( sizeof(uint32_t) + result_size );
-
-	const uint32_t uncompressed_size= static_cast<uint32_t>(data.size());
-	std::memcpy( out_data_compressed.data(), &uncompressed_size, sizeof(uint32_t) );
-
-	return true;
-}
-
-// Returns true, if all is ok.
-// Replaces "out_data_decompressed" content on success.
-// Clears "out_data_decompressed" on failure.
-static bool DecompressChunkData(
-	const h_BinaryStorage& data_compressed,
-	h_BinaryStorage& out_data_decompressed )
-{
-	out_data_decompressed.clear();
-
-	uint32_t uncompressed_size;
-	std::memcpy( &uncompressed_size, data_compressed.data(), sizeof(uint32_t) );
-
-	out_data_decompressed.resize( uncompressed_size );
-
-	uLongf uncompressed_size_returned= uncompressed_size;
-	const int uncompress_code=
-		::uncompress(
-			out_data_decompressed.data(), &uncompressed_size_returned,
-			data_compressed.data() + sizeof(uint32_t), data_compressed.size() - sizeof(uint32_t) );
-	if( uncompress_code != Z_OK )
-	{
-		h_Console::Error( "Can not uncompress, code: ", uncompress_code );
-		return false;
-	}
-	if( uncompressed_size_returned != uncompressed_size )
-	{
-		h_Console::Error( "Can not uncompress - bad size" );
-		return false;
-	}
-
-	return true;
-}
-
 // day of spring equinox
 // some time after sunrise.
 static constexpr const unsigned int g_world_start_tick=
@@ -150,6 +86,39 @@ h_World::h_World(
 	settings_->SetSetting( h_SettingsKeys::active_area_margins_x, (int)active_area_margins_[0] );
 	settings_->SetSetting( h_SettingsKeys::active_area_margins_y, (int)active_area_margins_[1] );
 
+	chunk_codec_= hChunkCodecFromName( settings_->GetString( h_SettingsKeys::chunk_compression ), h_ChunkCodec::Zlib );
+	settings_->SetSetting( h_SettingsKeys::chunk_compression, hChunkCodecName( chunk_codec_ ) );
+
+	{ // Regions cache size, in megabytes.
+		const int c_max_regions_cache_size_mb= 1024;
+		const int regions_cache_size_mb=
+			std::max(
+				0,
+				std::min(
+					settings_->GetInt( h_SettingsKeys::regions_cache_size, int( h_ChunkLoader::c_default_regions_cache_size >> 20u ) ),
+					c_max_regions_cache_size_mb ) );
+		settings_->SetSetting( h_SettingsKeys::regions_cache_size, regions_cache_size_mb );
+
+		chunk_loader_.SetRegionsCacheSize( size_t(regions_cache_size_mb) << 20u );
+	}
+
+	{ // Chunks pool. Keep storages for two rows of chunks - for world moving and prefetching.
+		chunk_pool_.SetMaxFreeStorages( 2u * std::max( chunk_number_x_, chunk_number_y_ ) );
+		const bool huge_pages= settings_->GetBool( h_SettingsKeys::chunk_pool_huge_pages, false );
+		settings_->SetSetting( h_SettingsKeys::chunk_pool_huge_pages, huge_pages );
+		chunk_pool_.SetUseHugePages( huge_pages );
+	}
+
+	{ // Autosave interval, in seconds. 0 - autosave disabled.
+		const int c_max_autosave_interval_s= 60 * 60;
+		const int autosave_interval_s=
+			std::max( 0, std::min( settings_->GetInt( h_SettingsKeys::autosave_interval, 60 ), c_max_autosave_interval_s ) );
+		settings_->SetSetting( h_SettingsKeys::autosave_interval, autosave_interval_s );
+
+		autosave_interval_ticks_= (unsigned int)autosave_interval_s * g_updates_frequency;
+		last_autosave_tick_= phys_tick_count_;
+	}
+
 	{ // Move world to player position
 		int player_xy[2];
 		pGetHexogonCoord( m_Vec2(header_->player.x, header->player.y), &player_xy[0], &player_xy[1] );
@@ -180,18 +149,41 @@ h_World::h_World(
 
 	long_loading_callback( progress+= c_progress_for_generation * progress_scaler );
 
-	for( unsigned int i= 0; i< chunk_number_x_; i++ )
-	for( unsigned int j= 0; j< chunk_number_y_; j++ )
-	{
-		chunks_[ i + j * H_MAX_CHUNKS ]= LoadChunk( i+longitude_, j+latitude_);
+	{ // Chunks are independent, so, load or generate them in parallel.
+		const unsigned int chunk_count= chunk_number_x_ * chunk_number_y_;
+		std::atomic<unsigned int> loaded_chunks{ 0 };
+		const float progress_before_chunks= progress;
+
+		// Each thread must use own buffers. Buffers of calling thread are world thread buffers.
+		std::vector<ChunkDataBuffers> threads_buffers( hParallelForThreadCount( chunk_count ) - 1u );
+
+		hParallelFor(
+			chunk_count,
+			[&]( const unsigned int index, const unsigned int thread_index )
+			{
+				const unsigned int i= index % chunk_number_x_;
+				const unsigned int j= index / chunk_number_x_;
+
+				ChunkDataBuffers& buffers= thread_index == 0 ? chunk_data_buffers_ : threads_buffers[ thread_index - 1u ];
+				chunks_[ i + j * H_MAX_CHUNKS ]= LoadChunk( i+longitude_, j+latitude_, buffers );
+
+				const unsigned int loaded= ++loaded_chunks;
+				// Callback can be called only in thread of world constructor caller.
+				if( thread_index == 0 )
+					long_loading_callback(
+						progress_before_chunks + c_progres_per_chunk * progress_scaler * float(loaded) );
+			} );
 
-		long_loading_callback( progress+= c_progres_per_chunk * progress_scaler );
+		long_loading_callback( progress+= c_progres_per_chunk * progress_scaler * float(chunk_count) );
 	}
 
 	LightWorld();
 
 	long_loading_callback( progress+= c_lighting_progress * progress_scaler );
 
+	StartChunksStreaming();
+	StartAutosave();
+
 	test_mob_target_pos_[0]= test_mob_discret_pos_[0]= 0;
 	test_mob_target_pos_[1]= test_mob_discret_pos_[1]= 0;
 	test_mob_target_pos_[2]= test_mob_discret_pos_[2]= 72;
@@ -209,13 +201,20 @@ h_World::~h_World()
 
 	H_ASSERT(!phys_thread_);
 
+	StopChunksStreaming();
+	StopAutosave();
+
 	for( unsigned int x= 0; x< chunk_number_x_; x++ )
 		for( unsigned int y= 0; y< chunk_number_y_; y++ )
 		{
 			h_Chunk* ch= GetChunk(x,y);
-			SaveChunk( ch );
-			chunk_loader_.FreeChunkData( ch->Longitude(), ch->Latitude() );
-			delete ch;
+			if( !SaveChunk( ch, chunk_data_buffers_ ) )
+				h_Console::Error( "Can not save chunk ", ch->Longitude(), " ", ch->Latitude(), ". Chunk changes are lost." );
+			{
+				std::lock_guard<std::mutex> lock( chunk_loader_mutex_ );
+				chunk_loader_.FreeChunkData( ch->Longitude(), ch->Latitude() );
+			}
+			chunk_pool_.Delete( ch );
 		}
 }
 
@@ -278,6 +277,7 @@ void h_World::StartUpdates( h_Player* player, r_IWorldRenderer* renderer )
 
 	player_= player;
 	renderer_= renderer;
+	prev_player_pos_= player_->EyesPos();
 
 	phys_thread_need_stop_.store(false);
 	phys_thread_paused_.store(false);
@@ -326,9 +326,23 @@ p_WorldPhysMeshConstPtr h_World::GetPhysMesh() const
 
 void h_World::Save()
 {
-	for( unsigned int x= 0; x< chunk_number_x_; x++ )
-		for( unsigned int y= 0; y< chunk_number_y_; y++ )
-			SaveChunk( GetChunk(x,y) );
+	if( phys_thread_ )
+	{
+		// Chunks are modified in world thread, so, only world thread can take snapshot of them.
+		std::unique_lock<std::mutex> lock( autosave_mutex_ );
+		const unsigned int snapshots_taken= autosave_snapshots_taken_;
+		snapshot_requested_.store(true);
+		autosave_done_condition_.wait(
+			lock,
+			[this, snapshots_taken] { return autosave_snapshots_taken_ != snapshots_taken; } );
+	}
+	else
+		TakeChunksSnapshot();
+
+	WaitForAutosave();
+	WaitForChunksSaving();
+
+	std::lock_guard<std::mutex> lock( chunk_loader_mutex_ );
 	chunk_loader_.ForceSaveAllChunks();
 }
 
@@ -401,22 +415,15 @@ void h_World::Build(
 		s->SetLightLevel( H_MAX_FIRE_LIGHT );
 
 		ch->SetBlock( local_x, local_y, z, s );
-		AddFireLight_r( x, y, z, H_MAX_FIRE_LIGHT );
+		AddFireLight( x, y, z, H_MAX_FIRE_LIGHT );
 	}
 	else if( block_type == h_BlockType::Fire )
 	{
 		h_Chunk* ch= GetChunk( chunk_x, chunk_y );
 
-		h_Fire* fire= new h_Fire();
-		fire->x_= local_x;
-		fire->y_= local_y;
-		fire->z_= z;
-
-		ch->light_source_list_.push_back( fire );
-		ch->fire_list_.push_back( fire );
-
+		h_Fire* fire= ch->NewFire( local_x, local_y, z );
 		ch->SetBlock( local_x, local_y, z, fire );
-		AddFireLight_r( x, y, z, fire->LightLevel() );
+		AddFireLight( x, y, z, fire->LightLevel() );
 	}
 	else if( block_type == h_BlockType::Grass )
 	{
@@ -625,18 +632,7 @@ void h_World::RemoveFire( const int x, const int y, const int z )
 	UpdateInRadius( x, y, r );
 	UpdateWaterInRadius( x, y, r );
 
-	for( unsigned int i= 0; i < chunk->fire_list_.size(); i++ )
-	{
-		if( chunk->fire_list_[i] == fire )
-		{
-			if( i + 1 != chunk->fire_list_.size() )
-				chunk->fire_list_[i]= chunk->fire_list_.back();
-			chunk->fire_list_.pop_back();
-
-			return;
-		}
-	}
-	H_ASSERT(false);
+	CheckBlockNeighbors( x, y, z );
 }
 
 void h_World::CheckBlockNeighbors( const int x, const int y, const int z )
@@ -670,7 +666,7 @@ void h_World::CheckBlockNeighbors( const int x, const int y, const int z )
 			 neighbor_z <= std::min(int(z) + 1, H_CHUNK_HEIGHT - 1);
 			 neighbor_z++ )
 		{
-			h_Block* block= chunk->blocks_[ neighbor_addr + neighbor_z ];
+			h_Block* block= chunk->GetBlock( neighbor_addr + neighbor_z );
 			switch( block->Type() )
 			{
 				// Activate unactive grass blocks.
@@ -678,15 +674,19 @@ void h_World::CheckBlockNeighbors( const int x, const int y, const int z )
 				{
 					h_GrassBlock* grass_block= static_cast<h_GrassBlock*>(block);
 					if( !grass_block->IsActive() )
-						chunk->blocks_[ neighbor_addr + neighbor_z ]=
-							chunk->NewActiveGrassBlock( local_x, local_y, neighbor_z );
+					{
+						chunk->WriteBlock(
+							neighbor_addr + neighbor_z,
+							chunk->NewActiveGrassBlock( local_x, local_y, neighbor_z ) );
+						chunk->MarkModified();
+					}
 				}
 				break;
 
 				// If there is air under sand block - sand must fail.
 				case h_BlockType::Sand:
 				{
-					h_BlockType lower_block_type= chunk->blocks_[ neighbor_addr + neighbor_z - 1 ]->Type();
+					h_BlockType lower_block_type= chunk->GetBlockType( neighbor_addr + neighbor_z - 1 );
 					if( lower_block_type == h_BlockType::Air || lower_block_type == h_BlockType::Water  ||
 						lower_block_type == h_BlockType::Fire )
 					{
@@ -704,6 +704,7 @@ void h_World::CheckBlockNeighbors( const int x, const int y, const int z )
 			// If something happens near water blocks, water mesh must be rebuilded,
 			// bacause it depends on nonwater blocks.
 			case h_BlockType::Water:
+				chunk->WakeWater( neighbor_addr + neighbor_z );
 				renderer_->UpdateChunkWater( chunk_x, chunk_y );
 				break;
 
@@ -756,9 +757,7 @@ void h_World::MoveWorld( h_WorldMoveDirection dir )
 		for( i= 0; i< chunk_number_x_; i++ )
 		{
 			h_Chunk* deleted_chunk= chunks_[ i | ( 0 << H_MAX_CHUNKS_LOG2 ) ];
-			SaveChunk( deleted_chunk );
-			chunk_loader_.FreeChunkData( deleted_chunk->Longitude(), deleted_chunk->Latitude() );
-			delete deleted_chunk;
+			ReleaseChunk( deleted_chunk );
 			for( j= 1; j< chunk_number_y_; j++ )
 			{
 				chunks_[ i | ( (j-1) << H_MAX_CHUNKS_LOG2 ) ]=
@@ -766,7 +765,7 @@ void h_World::MoveWorld( h_WorldMoveDirection dir )
 			}
 
 			chunks_[ i | ( (chunk_number_y_-1) << H_MAX_CHUNKS_LOG2 ) ]=
-				LoadChunk( i + longitude_, chunk_number_y_ + latitude_ );
+				AcquireChunk( i + longitude_, chunk_number_y_ + latitude_ );
 		}
 		for( i= 0; i< chunk_number_x_; i++ )
 			AddLightToBorderChunk( i, chunk_number_y_ - 1 );
@@ -778,9 +777,7 @@ void h_World::MoveWorld( h_WorldMoveDirection dir )
 		for( i= 0; i< chunk_number_x_; i++ )
 		{
 			h_Chunk* deleted_chunk= chunks_[ i | ( (chunk_number_y_-1) << H_MAX_CHUNKS_LOG2 ) ];
-			SaveChunk( deleted_chunk );
-			chunk_loader_.FreeChunkData( deleted_chunk->Longitude(), deleted_chunk->Latitude() );
-			delete deleted_chunk;
+			ReleaseChunk( deleted_chunk );
 			for( j= chunk_number_y_-1; j> 0; j-- )
 			{
 				chunks_[ i | ( j << H_MAX_CHUNKS_LOG2 ) ]=
@@ -788,7 +785,7 @@ void h_World::MoveWorld( h_WorldMoveDirection dir )
 			}
 
 			chunks_[ i | ( 0 << H_MAX_CHUNKS_LOG2 ) ]=
-				LoadChunk( i + longitude_,  latitude_-1 );
+				AcquireChunk( i + longitude_,  latitude_-1 );
 		}
 		for( i= 0; i< chunk_number_x_; i++ )
 			AddLightToBorderChunk( i, 0 );
@@ -800,16 +797,14 @@ void h_World::MoveWorld( h_WorldMoveDirection dir )
 		for( j= 0; j< chunk_number_y_; j++ )
 		{
 			h_Chunk* deleted_chunk= chunks_[ 0 | ( j << H_MAX_CHUNKS_LOG2 ) ];
-			SaveChunk( deleted_chunk );
-			chunk_loader_.FreeChunkData( deleted_chunk->Longitude(), deleted_chunk->Latitude() );
-			delete deleted_chunk;
+			ReleaseChunk( deleted_chunk );
 			for( i= 1; i< chunk_number_x_; i++ )
 			{
 				chunks_[ (i-1) | ( j << H_MAX_CHUNKS_LOG2 ) ]=
 					chunks_[ i | ( j << H_MAX_CHUNKS_LOG2 ) ];
 			}
 			chunks_[ ( chunk_number_x_-1) | ( j << H_MAX_CHUNKS_LOG2 ) ]=
-				LoadChunk( longitude_+chunk_number_x_, latitude_ + j );
+				AcquireChunk( longitude_+chunk_number_x_, latitude_ + j );
 		}
 		for( j= 0; j< chunk_number_y_; j++ )
 			AddLightToBorderChunk( chunk_number_x_-1, j );
@@ -821,16 +816,14 @@ void h_World::MoveWorld( h_WorldMoveDirection dir )
 		for( j= 0; j< chunk_number_y_; j++ )
 		{
 			h_Chunk* deleted_chunk= chunks_[ ( chunk_number_x_-1) | ( j << H_MAX_CHUNKS_LOG2 ) ];
-			SaveChunk( deleted_chunk );
-			chunk_loader_.FreeChunkData( deleted_chunk->Longitude(), deleted_chunk->Latitude() );
-			delete deleted_chunk;
+			ReleaseChunk( deleted_chunk );
 			for( i= chunk_number_x_-1; i> 0; i-- )
 			{
 				chunks_[ i | ( j << H_MAX_CHUNKS_LOG2 ) ]=
 					chunks_[ (i-1) | ( j << H_MAX_CHUNKS_LOG2 ) ];
 			}
 			chunks_[ 0 | ( j << H_MAX_CHUNKS_LOG2 ) ]=
-				LoadChunk( longitude_-1, latitude_ + j );
+				AcquireChunk( longitude_-1, latitude_ + j );
 		}
 		for( j= 0; j< chunk_number_y_; j++ )
 			AddLightToBorderChunk( 0, j );
@@ -878,40 +871,85 @@ void h_World::MoveWorld( h_WorldMoveDirection dir )
 	};
 }
 
-void h_World::SaveChunk( h_Chunk* ch )
+void h_World::SerializeChunk( const h_Chunk* ch, h_BinaryStorage& out ) const
 {
-	h_BinaryStorage data_uncompressed;
-	h_BinaryOuptutStream stream( data_uncompressed );
+	h_BinaryOuptutStream stream( out );
 
 	HEXCHUNK_header header;
 
+	std::memcpy( header.format_key, H_CHUNK_FORMAT_HEADER, sizeof(header.format_key) );
+	header.version= H_CHUNK_FORMAT_VERSION;
+	header.datalen= 0;
+	header.blocks_data.offset= header.blocks_data.size= 0;
 	header.water_block_count= ch->GetWaterList().size();
 	header.longitude= ch->Longitude();
 	header.latitude= ch->Latitude();
 
 	header.Write( stream );
 	ch->SaveChunkToFile( stream );
+}
 
-	CompressChunkData(
-		data_uncompressed,
-		chunk_loader_.GetChunkData( ch->Longitude(), ch->Latitude() ) );
+bool h_World::SaveChunk( h_Chunk* ch, ChunkDataBuffers& buffers )
+{
+	// Chunk snapshot may be not written yet. Write newer data only after it.
+	WaitForChunkAutosave( ch->Longitude(), ch->Latitude() );
+	// Snapshot is lost - data in chunk loader is outdated.
+	if( TakeFailedAutosaveChunk( ch->Longitude(), ch->Latitude() ) )
+		ch->saved_generation_= ch->ModificationGeneration() - 1u;
+
+	// Data in chunk loader is actual.
+	if( !ch->IsModified() )
+		return true;
+
+	// Chunk can be modified in world thread during saving, so, remember generation before serialization.
+	const unsigned int generation= ch->ModificationGeneration();
+
+	SerializeChunk( ch, buffers.uncompressed );
+
+	// Compress outside loader lock. On failure keep chunk modified and old data in chunk loader.
+	if( !hCompressChunkData( buffers.uncompressed, chunk_codec_, buffers.compressed ) )
+		return false;
+
+	std::lock_guard<std::mutex> lock( chunk_loader_mutex_ );
+	if( !chunk_loader_.SetChunkData(
+			ch->Longitude(), ch->Latitude(),
+			buffers.compressed.data(), buffers.compressed.size() ) )
+		return false;
+
+	ch->saved_generation_= generation;
+	return true;
 }
 
-h_Chunk* h_World::LoadChunk( int lon, int lat )
+h_Chunk* h_World::LoadChunk( int lon, int lat, ChunkDataBuffers& buffers )
 {
-	const h_BinaryStorage& chunk_data_compressed= chunk_loader_.GetChunkData( lon, lat );
-	if( chunk_data_compressed.empty() )
-		return new h_Chunk( this, lon, lat, world_generator_.get() );
+	// Data in chunk loader may be outdated, while chunk snapshot is not written.
+	WaitForChunkAutosave( lon, lat );
 
-	if( !DecompressChunkData( chunk_data_compressed, decompressed_chunk_data_buffer_ ) )
-		return new h_Chunk( this, lon, lat, world_generator_.get() );
+	// Pin data under lock and decompress it straight from region file mapping without lock.
+	h_ChunkLoader::ChunkData chunk_data;
+	{
+		std::lock_guard<std::mutex> lock( chunk_loader_mutex_ );
+		chunk_data= chunk_loader_.GetPinnedChunkData( lon, lat );
+	}
+
+	const bool decompressed=
+		chunk_data.size > 0 &&
+		hDecompressChunkData( chunk_data.data, chunk_data.size, buffers.uncompressed );
+
+	{
+		std::lock_guard<std::mutex> lock( chunk_loader_mutex_ );
+		chunk_loader_.UnpinChunkData( lon, lat );
+	}
+
+	if( !decompressed )
+		return chunk_pool_.New( this, lon, lat, world_generator_.get() );
 
-	h_BinaryInputStream stream( decompressed_chunk_data_buffer_ );
+	h_BinaryInputStream stream( buffers.uncompressed );
 
 	HEXCHUNK_header header;
 	header.Read( stream );
 
-	return new h_Chunk( this, header, stream );
+	return chunk_pool_.New( this, header, stream );
 }
 
 void h_World::UpdatePhysMesh( int x_min, int x_max, int y_min, int y_max, int z_min, int z_max )
@@ -996,15 +1034,14 @@ void h_World::UpdatePhysMesh( int x_min, int x_max, int y_min, int y_max, int z_
 	for( int y= y_min; y< y_max; y++ )
 	{
 		h_Chunk* chunk= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
-		const h_Block* const* blocks=
-			chunk->GetBlocksData() +
-			BlockAddr( x&(H_CHUNK_WIDTH-1), y&(H_CHUNK_WIDTH-1), 0 );
+		const unsigned int column_addr= BlockAddr( x&(H_CHUNK_WIDTH-1), y&(H_CHUNK_WIDTH-1), 0 );
+		const unsigned short* const block_ids= chunk->GetBlockIdsData() + column_addr;
 
 		for( int z= z_min; z < z_max; z++ )
 		{
-			if( blocks[z]->Type() == h_BlockType::Water )
+			if( hBlockIdType( block_ids[z] ) == h_BlockType::Water )
 			{
-				const h_LiquidBlock* water_block= static_cast<const h_LiquidBlock*>( blocks[z] );
+				const h_LiquidBlock* water_block= static_cast<const h_LiquidBlock*>( chunk->GetBlock( column_addr + z ) );
 
 				p_WaterBlock water_phys_block;
 				water_phys_block.x= x + X;
@@ -1014,9 +1051,9 @@ void h_World::UpdatePhysMesh( int x_min, int x_max, int y_min, int y_max, int z_
 
 				phys_mesh.water_blocks.push_back( water_phys_block );
 			}
-			else if( h_Block::Form( blocks[z]->Type()) == h_BlockForm::Plate )
+			else if( h_Block::Form( hBlockIdType( block_ids[z] ) ) == h_BlockForm::Plate )
 			{
-				auto nonstandatd_form_block= static_cast<const h_NonstandardFormBlock*>(blocks[z]);
+				auto nonstandatd_form_block= static_cast<const h_NonstandardFormBlock*>( chunk->GetBlock( column_addr + z ) );
 				float z0= float(z);
 				float z1= z0 + 0.5f;
 				if( nonstandatd_form_block->Direction() == h_Direction::Down )
@@ -1039,9 +1076,9 @@ void h_World::UpdatePhysMesh( int x_min, int x_max, int y_min, int y_max, int z_
 						static_cast<h_Direction>(d + (unsigned int)h_Direction::Forward) );
 				}
 			}
-			else if( h_Block::Form( blocks[z]->Type()) == h_BlockForm::Bisected )
+			else if( h_Block::Form( hBlockIdType( block_ids[z] ) ) == h_BlockForm::Bisected )
 			{
-				auto nonstandatd_form_block= static_cast<const h_NonstandardFormBlock*>(blocks[z]);
+				auto nonstandatd_form_block= static_cast<const h_NonstandardFormBlock*>( chunk->GetBlock( column_addr + z ) );
 
 				p_UpperBlockFace help_face( x + X, y + Y, float(z), h_Direction::Up );
 
@@ -1111,8 +1148,15 @@ void h_World::BlastBlock_r( int x, int y, int z, int blast_power )
 	unsigned int addr;
 
 	addr= BlockAddr( x&(H_CHUNK_WIDTH-1), y&(H_CHUNK_WIDTH-1), z );
-	if( ch->blocks_[addr]->Type() != h_BlockType::Water )
+	const h_BlockType block_type= ch->GetBlockType( addr );
+	// Light sources are owned by chunk lists, so, they must be removed from them.
+	if( block_type == h_BlockType::FireStone || block_type == h_BlockType::Fire )
+		ch->DeleteLightSource( static_cast<h_LightSource*>( ch->GetBlock( addr ) ) );
+	if( block_type != h_BlockType::Water )
+	{
 		ch->SetBlock( addr, NormalBlock(h_BlockType::Air) );
+		WakeWater( x, y, z );
+	}
 
 	//BlastBlock_r( x, y, z + 1, blast_power-1 );
 	//BlastBlock_r( x, y, z - 1, blast_power-1 );
@@ -1137,7 +1181,7 @@ bool h_World::CanBuild( int x, int y, int z ) const
 {
 	return
 		GetChunk( x>> H_CHUNK_WIDTH_LOG2, y>> H_CHUNK_WIDTH_LOG2 )->
-		GetBlock( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), z )->Type() == h_BlockType::Air;
+		GetBlockType( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), z ) == h_BlockType::Air;
 }
 
 void h_World::PhysTick()
@@ -1145,7 +1189,12 @@ void h_World::PhysTick()
 	while(!phys_thread_need_stop_.load())
 	{
 		while(phys_thread_paused_.load())
+		{
+			// World is not modified during pause, but saving is possible.
+			if( snapshot_requested_.load() )
+				TakeChunksSnapshot();
 			hSleep( g_sleep_interval_on_pause );
+		}
 
 		H_ASSERT( player_ );
 		H_ASSERT( renderer_ );
@@ -1186,6 +1235,13 @@ void h_World::PhysTick()
 				player_coord[1] - 6, player_coord[1] + 6,
 				player_coord[2] - 5, player_coord[2] + 5 );
 
+			// Start loading of chunks in direction of player movement.
+			const float c_prefetch_prediction_time_s= 3.0f;
+			const m_Vec3 player_speed= ( player_pos - prev_player_pos_ ) * float(g_updates_frequency);
+			prev_player_pos_= player_pos;
+			PrefetchChunks( player_pos + player_speed * c_prefetch_prediction_time_s );
+			DropUnneededPrefetchedChunks();
+
 			int player_chunk_x= ( player_coord[0] + (H_CHUNK_WIDTH>>1) ) >> H_CHUNK_WIDTH_LOG2;
 			int player_chunk_y= ( player_coord[1] + (H_CHUNK_WIDTH>>1) ) >> H_CHUNK_WIDTH_LOG2;
 
@@ -1204,6 +1260,11 @@ void h_World::PhysTick()
 			phys_tick_count_++;
 		}
 
+		// Take snapshot at tick boundary, when all chunks are consistent. Chunks writing is performed in background.
+		if( snapshot_requested_.load() ||
+			( autosave_interval_ticks_ != 0 && phys_tick_count_ - last_autosave_tick_ >= autosave_interval_ticks_ ) )
+			TakeChunksSnapshot();
+
 		renderer_->Update();
 
 		uint64_t t1_ms= hGetTimeMS();
@@ -1271,105 +1332,137 @@ void h_World::WaterPhysTick()
 		if( ( (cluster_x ^ cluster_y) & 1 ) == ( phys_tick_count_ & 1 ) )
 			continue;
 
-		bool chunk_modifed= false;
-		h_Chunk* ch= GetChunk( i, j );
+		ChunkWaterPhysTick( i, j );
+	}//for chunks
+}
+
+void h_World::ChunkWaterPhysTick( const unsigned int X, const unsigned int Y )
+{
+	h_Chunk* ch= GetChunk( X, Y );
+
+	// Simulate only unsettled water. Still water costs nothing.
+	std::vector<unsigned short>& unsettled= ch->unsettled_water_;
+	if( unsettled.empty() )
+		return;
 
-		int X= i << H_CHUNK_WIDTH_LOG2;
-		int Y= j << H_CHUNK_WIDTH_LOG2;
+	bool chunk_modifed= false;
 
-		std::vector< h_LiquidBlock* >& list= ch->water_block_list_;
-		for( unsigned int k= 0; k < list.size(); )
+	const int chunk_global_x= X << H_CHUNK_WIDTH_LOG2;
+	const int chunk_global_y= Y << H_CHUNK_WIDTH_LOG2;
+
+	// Water, woken in this tick, is added to list end and simulated in next tick.
+	const unsigned int unsettled_count= (unsigned int)unsettled.size();
+	for( unsigned int k= 0; k < unsettled_count; k++ )
+	{
+		const unsigned int block_addr= unsettled[k];
+		ch->unsettled_water_bits_[ block_addr >> 5 ]&= ~( 1u << ( block_addr & 31u ) );
+
+		// Water may fail, flow away or dry since waking.
+		if( ch->GetBlockType( block_addr ) != h_BlockType::Water )
+			continue;
+
+		h_LiquidBlock* b= static_cast<h_LiquidBlock*>( ch->GetBlock( block_addr ) );
+		H_ASSERT( BlockAddr( b->x_, b->y_, b->z_ ) == block_addr );
+
+		int global_x= chunk_global_x + b->x_;
+		int global_y= chunk_global_y + b->y_;
+
+		h_Block* lower_block= ch->GetBlock( block_addr - 1 );
+
+		// Try fail down.
+		if( lower_block->Type() == h_BlockType::Air )
 		{
-			h_LiquidBlock* b= list[k];
-			k++;
+			ch->SetBlock( block_addr, NormalBlock( h_BlockType::Air ) );
+			ch->SetBlock( block_addr - 1, b );
+			b->z_--;
 
-			H_ASSERT( ch->GetBlock( b->x_, b->y_, b->z_ ) == b );
+			ch->water_light_updates_.push_back( (unsigned short)block_addr );
+			ch->water_light_updates_.push_back( (unsigned short)( block_addr - 1 ) );
 
-			unsigned int block_addr= BlockAddr( b->x_, b->y_, b->z_ );
-			h_Block* lower_block= ch->GetBlock( block_addr - 1 );
+			WakeWater( global_x, global_y, b->z_ + 1 );
+			WakeWater( global_x, global_y, b->z_ );
 
-			// Try fail down.
-			if( lower_block->Type() == h_BlockType::Air )
-			{
-				ch->SetBlock( block_addr, NormalBlock( h_BlockType::Air ) );
-				ch->SetBlock( block_addr - 1, b );
-				b->z_--;
+			chunk_modifed= true;
 
-				chunk_modifed= true;
+			// If we fail, flow in next tick.
+			continue;
+		}
+		else
+		{
+			bool block_modified= false;
 
-				// If we fail, flow in next tick.
-				continue;
-			}
-			else
+			// Try flow down.
+			if( lower_block->Type() == h_BlockType::Water )
 			{
-				// Try flow down.
-				if( lower_block->Type() == h_BlockType::Water )
-				{
-					h_LiquidBlock* lower_water_block= static_cast<h_LiquidBlock*>(lower_block);
+				h_LiquidBlock* lower_water_block= static_cast<h_LiquidBlock*>(lower_block);
 
-					int level_delta= std::min(int(H_MAX_WATER_LEVEL - lower_water_block->LiquidLevel()), int(b->LiquidLevel()));
-					if( level_delta > 0 )
-					{
-						b->DecreaseLiquidLevel( level_delta );
-						lower_water_block->IncreaseLiquidLevel( level_delta );
-						chunk_modifed= true;
-					}
+				int level_delta= std::min(int(H_MAX_WATER_LEVEL - lower_water_block->LiquidLevel()), int(b->LiquidLevel()));
+				if( level_delta > 0 )
+				{
+					b->DecreaseLiquidLevel( level_delta );
+					lower_water_block->IncreaseLiquidLevel( level_delta );
+					WakeWater( global_x, global_y, b->z_ - 1 );
+					block_modified= true;
 				}
+			}
 
-				int global_x= X + b->x_;
-				int global_y= Y + b->y_;
+			int forward_side_y= global_y + ( (global_x^1) & 1 );
+			int back_side_y= global_y - (global_x & 1);
 
-				int forward_side_y= global_y + ( (global_x^1) & 1 );
-				int back_side_y= global_y - (global_x & 1);
+			int neighbors[6][2]=
+			{
+				{ global_x, global_y + 1 },
+				{ global_x, global_y - 1 },
+				{ global_x + 1, forward_side_y },
+				{ global_x + 1, back_side_y },
+				{ global_x - 1, forward_side_y },
+				{ global_x - 1, back_side_y },
+			};
 
-				int neighbors[6][2]=
+			for( unsigned int d= 0; d < 6; d++ )
+				if( WaterFlow( b, neighbors[d][0], neighbors[d][1], b->z_ ) )
 				{
-					{ global_x, global_y + 1 },
-					{ global_x, global_y - 1 },
-					{ global_x + 1, forward_side_y },
-					{ global_x + 1, back_side_y },
-					{ global_x - 1, forward_side_y },
-					{ global_x - 1, back_side_y },
-				};
-
-				for( unsigned int d= 0; d < 6; d++ )
-					if( WaterFlow( b, neighbors[d][0], neighbors[d][1], b->z_ ) )
-						chunk_modifed= true;
+					WakeWater( neighbors[d][0], neighbors[d][1], b->z_ );
+					block_modified= true;
+				}
 
-				if( b->LiquidLevel() == 0 ||
-					( b->LiquidLevel() < 16 && lower_block->Type() != h_BlockType::Water ) )
-				{
-					ch->SetBlock( block_addr, NormalBlock( h_BlockType::Air ) );
-					CheckBlockNeighbors( global_x, global_y, b->z_ );
+			if( b->LiquidLevel() == 0 ||
+				( b->LiquidLevel() < 16 && lower_block->Type() != h_BlockType::Water ) )
+			{
+				ch->SetBlock( block_addr, NormalBlock( h_BlockType::Air ) );
+				ch->water_light_updates_.push_back( (unsigned short)block_addr );
+				CheckBlockNeighbors( global_x, global_y, b->z_ );
 
-					ch->DeleteWaterBlock( b );
+				ch->DeleteWaterBlock( b );
+				block_modified= true;
+			}
 
-					k--;
-					list[k]= list.back();
-					list.pop_back();
+			if( block_modified )
+			{
+				WakeWater( global_x, global_y, block_addr & ( H_CHUNK_HEIGHT - 1 ) );
+				chunk_modifed= true;
+			}
+		}// if down block not air
+	}//for unsettled water blocks in chunk
 
-					chunk_modifed= true;
-				}
-			}// if down block not air
-		}//for all water blocks in chunk
+	unsettled.erase( unsettled.begin(), unsettled.begin() + unsettled_count );
 
-		if( chunk_modifed )
-		{
-			renderer_->UpdateChunkWater( i  , j   );
+	if( chunk_modifed )
+	{
+		renderer_->UpdateChunkWater( X  , Y   );
 
-			renderer_->UpdateChunkWater( i-1, j   );
-			renderer_->UpdateChunkWater( i+1, j   );
-			renderer_->UpdateChunkWater( i  , j-1 );
-			renderer_->UpdateChunkWater( i  , j+1 );
+		renderer_->UpdateChunkWater( X-1, Y   );
+		renderer_->UpdateChunkWater( X+1, Y   );
+		renderer_->UpdateChunkWater( X  , Y-1 );
+		renderer_->UpdateChunkWater( X  , Y+1 );
 
-			renderer_->UpdateChunkWater( i-1, j-1 );
-			renderer_->UpdateChunkWater( i-1, j+1 );
-			renderer_->UpdateChunkWater( i+1, j-1 );
-			renderer_->UpdateChunkWater( i+1, j+1 );
+		renderer_->UpdateChunkWater( X-1, Y-1 );
+		renderer_->UpdateChunkWater( X-1, Y+1 );
+		renderer_->UpdateChunkWater( X+1, Y-1 );
+		renderer_->UpdateChunkWater( X+1, Y+1 );
 
-			ch->need_update_light_= true;
-		}
-	}//for chunks
+		ch->MarkModified();
+	}
 }
 
 bool h_World::WaterFlow( h_LiquidBlock* from, int to_x, int to_y, int to_z )
@@ -1397,6 +1490,7 @@ bool h_World::WaterFlow( h_LiquidBlock* from, int to_x, int to_y, int to_z )
 			new_block->z_= to_z;
 			new_block->SetLiquidLevel( level_delta );
 			ch->SetBlock( addr, new_block );
+			ch->water_light_updates_.push_back( (unsigned short)addr );
 
 			CheckBlockNeighbors( to_x, to_y, to_z );
 			return true;
@@ -1412,12 +1506,44 @@ bool h_World::WaterFlow( h_LiquidBlock* from, int to_x, int to_y, int to_z )
 			water_level_delta/= 2;
 			from->DecreaseLiquidLevel( water_level_delta );
 			water_block->IncreaseLiquidLevel( water_level_delta );
+			ch->MarkModified();
 			return true;
 		}
 	}
 	return false;
 }
 
+void h_World::WakeWater( const int x, const int y, const int z )
+{
+	int forward_side_y= y + ( (x^1) & 1 );
+	int back_side_y= y - (x & 1);
+
+	int neighbors[6][2]=
+	{
+		{ x, y + 1 },
+		{ x, y - 1 },
+		{ x + 1, forward_side_y },
+		{ x + 1, back_side_y },
+		{ x - 1, forward_side_y },
+		{ x - 1, back_side_y },
+	};
+
+	h_Chunk* chunk= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
+	const unsigned int addr= BlockAddr( x & (H_CHUNK_WIDTH-1), y & (H_CHUNK_WIDTH-1), z );
+
+	chunk->WakeWater( addr );
+	if( z > 0 )
+		chunk->WakeWater( addr - 1 );
+	if( z < H_CHUNK_HEIGHT - 1 )
+		chunk->WakeWater( addr + 1 );
+
+	for( unsigned int n= 0; n < 6; n++ )
+	{
+		GetChunk( neighbors[n][0] >> H_CHUNK_WIDTH_LOG2, neighbors[n][1] >> H_CHUNK_WIDTH_LOG2 )->
+			WakeWater( BlockAddr( neighbors[n][0] & (H_CHUNK_WIDTH-1), neighbors[n][1] & (H_CHUNK_WIDTH-1), z ) );
+	}
+}
+
 void h_World::GrassPhysTick()
 {
 	const unsigned int c_reproducing_start_chance= m_Rand::max_rand / 32;
@@ -1445,14 +1571,15 @@ void h_World::GrassPhysTick()
 			int block_addr= BlockAddr( grass_block->GetX(), grass_block->GetY(), grass_block->GetZ() );
 			H_ASSERT( block_addr <= H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT );
 
-			H_ASSERT( chunk->blocks_[ block_addr ] == grass_block );
+			H_ASSERT( chunk->GetBlock( block_addr ) == grass_block );
 
 			// Grass fade, if upper block is full or it is water.
-			h_Block* upper_block= chunk->blocks_[ block_addr + 1 ];
+			h_Block* upper_block= chunk->GetBlock( block_addr + 1 );
 			if( ( upper_block->CombinedTransparency() & H_VISIBLY_TRANSPARENCY_BITS ) == TRANSPARENCY_SOLID ||
 				upper_block->Type() == h_BlockType::Water )
 			{
-				chunk->blocks_[ block_addr ]= NormalBlock( h_BlockType::Soil );
+				chunk->WriteBlock( block_addr, NormalBlock( h_BlockType::Soil ) );
+				chunk->MarkModified();
 
 				chunk->active_grass_blocks_allocator_.Delete( grass_block );
 
@@ -1465,15 +1592,15 @@ void h_World::GrassPhysTick()
 			}
 
 			unsigned char light=
-				chunk-> sun_light_map_[ block_addr + 1 ] * current_sun_multiplier +
-				chunk->fire_light_map_[ block_addr + 1 ];
+				chunk->SunLightLevel ( block_addr + 1 ) * current_sun_multiplier +
+				chunk->FireLightLevel( block_addr + 1 );
 
 			if( light >= c_min_light_for_grass_reproducing &&
 				phys_processes_rand_.Rand() <= c_reproducing_start_chance )
 			{
 				bool can_reproduce= false;
 
-				bool z_plus_2_block_is_air= chunk->blocks_[ block_addr + 2 ]->Type() == h_BlockType::Air;
+				bool z_plus_2_block_is_air= chunk->GetBlockType( block_addr + 2 ) == h_BlockType::Air;
 
 				int world_x= grass_block->GetX() + X;
 				int world_y= grass_block->GetY() + Y;
@@ -1503,10 +1630,10 @@ void h_World::GrassPhysTick()
 					int neighbor_addr= BlockAddr( local_x, local_y, grass_block->GetZ() );
 					H_ASSERT( neighbor_addr <= H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT );
 
-					h_BlockType z_minus_one_block_type= neighbor_chunk->blocks_[ neighbor_addr - 1 ]->Type();
-					h_BlockType neighbor_block_type   = neighbor_chunk->blocks_[ neighbor_addr     ]->Type();
-					h_BlockType z_plus_one_block_type = neighbor_chunk->blocks_[ neighbor_addr + 1 ]->Type();
-					h_BlockType z_plus_two_block_type = neighbor_chunk->blocks_[ neighbor_addr + 2 ]->Type();
+					h_BlockType z_minus_one_block_type= neighbor_chunk->GetBlockType( neighbor_addr - 1 );
+					h_BlockType neighbor_block_type   = neighbor_chunk->GetBlockType( neighbor_addr     );
+					h_BlockType z_plus_one_block_type = neighbor_chunk->GetBlockType( neighbor_addr + 1 );
+					h_BlockType z_plus_two_block_type = neighbor_chunk->GetBlockType( neighbor_addr + 2 );
 
 					if( z_minus_one_block_type == h_BlockType::Soil &&
 						neighbor_block_type    == h_BlockType::Air &&
@@ -1514,9 +1641,11 @@ void h_World::GrassPhysTick()
 					{
 						if( phys_processes_rand_.Rand() <= c_reproducing_do_chance )
 						{
-							neighbor_chunk->blocks_[ neighbor_addr - 1 ]=
+							neighbor_chunk->WriteBlock(
+								neighbor_addr - 1,
 								neighbor_chunk->NewActiveGrassBlock(
-									local_x, local_y, grass_block->GetZ() - 1 );
+									local_x, local_y, grass_block->GetZ() - 1 ) );
+							neighbor_chunk->MarkModified();
 
 							renderer_->UpdateChunk( neinghbor_chunk_x, neinghbor_chunk_y );
 						}
@@ -1527,9 +1656,11 @@ void h_World::GrassPhysTick()
 					{
 						if( phys_processes_rand_.Rand() <= c_reproducing_do_chance )
 						{
-							neighbor_chunk->blocks_[ neighbor_addr  ]=
+							neighbor_chunk->WriteBlock(
+								neighbor_addr,
 								neighbor_chunk->NewActiveGrassBlock(
-									local_x, local_y, grass_block->GetZ() );
+									local_x, local_y, grass_block->GetZ() ) );
+							neighbor_chunk->MarkModified();
 
 							renderer_->UpdateChunk( neinghbor_chunk_x, neinghbor_chunk_y );
 						}
@@ -1541,9 +1672,11 @@ void h_World::GrassPhysTick()
 					{
 						if( phys_processes_rand_.Rand() <= c_reproducing_do_chance )
 						{
-							neighbor_chunk->blocks_[ neighbor_addr + 1 ]=
+							neighbor_chunk->WriteBlock(
+								neighbor_addr + 1,
 								neighbor_chunk->NewActiveGrassBlock(
-									local_x, local_y, grass_block->GetZ() + 1 );
+									local_x, local_y, grass_block->GetZ() + 1 ) );
+							neighbor_chunk->MarkModified();
 
 							renderer_->UpdateChunk( neinghbor_chunk_x, neinghbor_chunk_y );
 						}
@@ -1555,7 +1688,8 @@ void h_World::GrassPhysTick()
 				if( !can_reproduce )
 				{
 					// Deactivate grass block
-					chunk->blocks_[ block_addr ]= &unactive_grass_block_;
+					chunk->WriteBlock( block_addr, &unactive_grass_block_ );
+					chunk->MarkModified();
 
 					chunk->active_grass_blocks_allocator_.Delete( grass_block );
 
@@ -1608,7 +1742,7 @@ void h_World::FirePhysTick()
 		int local_y= y & (H_CHUNK_WIDTH - 1);
 
 		int addr= BlockAddr( local_x, local_y, z );
-		H_ASSERT( ch->GetBlock(addr)->Type() == h_BlockType::Air );
+		H_ASSERT( ch->GetBlockType(addr) == h_BlockType::Air );
 
 		unsigned int max_flammability= 0;
 		max_flammability= std::max<unsigned int>( max_flammability, ch->GetBlock( addr + 1 )->Flammability() );
@@ -1635,17 +1769,11 @@ void h_World::FirePhysTick()
 			max_flammability * base_chance )
 			return;
 
-		h_Fire* new_fire= new h_Fire();
-		new_fire->x_= local_x;
-		new_fire->y_= local_y;
-		new_fire->z_= z;
-
-		ch->light_source_list_.push_back( new_fire );
-		ch->fire_list_.push_back( new_fire );
+		h_Fire* new_fire= ch->NewFire( local_x, local_y, z );
 		ch->SetBlock( addr, new_fire );
 
 		unsigned int light_level= new_fire->LightLevel();
-		AddFireLight_r( x, y, z, light_level );
+		AddFireLight( x, y, z, light_level );
 		UpdateInRadius( x, y, light_level );
 		UpdateWaterInRadius( x, y, light_level );
 	};
@@ -1694,19 +1822,13 @@ void h_World::FirePhysTick()
 		int local_y= y & (H_CHUNK_WIDTH - 1);
 
 		int addr= BlockAddr( local_x, local_y, z );
-		H_ASSERT( ch->GetBlock(addr)->Type() == h_BlockType::Air );
+		H_ASSERT( ch->GetBlockType(addr) == h_BlockType::Air );
 
-		h_Fire* new_fire= new h_Fire();
-		new_fire->x_= local_x;
-		new_fire->y_= local_y;
-		new_fire->z_= z;
-
-		ch->light_source_list_.push_back( new_fire );
-		ch->fire_list_.push_back( new_fire );
+		h_Fire* new_fire= ch->NewFire( local_x, local_y, z );
 		ch->SetBlock( addr, new_fire );
 
 		unsigned int light_level= new_fire->LightLevel();
-		AddFireLight_r( x, y, z, light_level );
+		AddFireLight( x, y, z, light_level );
 		UpdateInRadius( x, y, light_level );
 		UpdateWaterInRadius( x, y, light_level );
 	};
@@ -1719,13 +1841,16 @@ void h_World::FirePhysTick()
 		int X= x << H_CHUNK_WIDTH_LOG2;
 		int Y= y << H_CHUNK_WIDTH_LOG2;
 
-		std::vector< h_Fire* >& fire_list= chunk->fire_list_;
+		const std::vector<unsigned short>& fire_list= chunk->fire_list_;
 		for( unsigned int i= 0; i < fire_list.size(); i++ )
 		{
-			h_Fire* fire= fire_list[i];
+			h_Fire* fire= chunk->GetFire( fire_list[i] );
 
 			if( fire->power_ < h_Fire::c_max_power_ )
+			{
 				fire->power_++;
+				chunk->MarkModified();
+			}
 
 			if( fire->power_ < c_min_fire_activation_power ||
 				phys_processes_rand_.Rand() >= c_fire_activation_chanse * fire->power_ / h_Fire::c_max_power_ )
@@ -1737,8 +1862,8 @@ void h_World::FirePhysTick()
 			int fire_addr= BlockAddr( fire->x_, fire->y_, fire->z_ );
 			bool up_down_is_air[2]=
 			{
-				chunk->GetBlock( fire_addr - 1 )->Type() == h_BlockType::Air,
-				chunk->GetBlock( fire_addr + 1 )->Type() == h_BlockType::Air,
+				chunk->GetBlockType( fire_addr - 1 ) == h_BlockType::Air,
+				chunk->GetBlockType( fire_addr + 1 ) == h_BlockType::Air,
 			};
 
 			unsigned int current_up_down_burn_base_chance[2]=
@@ -1761,7 +1886,7 @@ void h_World::FirePhysTick()
 				int local_y= neighbors[n][1] & (H_CHUNK_WIDTH - 1);
 				int addr= BlockAddr( local_x, local_y, fire->z_ );
 
-				bool near_block_is_air= ch2->GetBlock( addr )->Type() == h_BlockType::Air;
+				bool near_block_is_air= ch2->GetBlockType( addr ) == h_BlockType::Air;
 
 				// Try burn near block.
 				if(
@@ -1789,7 +1914,7 @@ void h_World::FirePhysTick()
 					bool is_path= up_down_is_air[ z_index ] || near_block_is_air;
 
 					if( is_path &&
-						ch2->GetBlock( addr + dz )->Type() == h_BlockType::Air )
+						ch2->GetBlockType( addr + dz ) == h_BlockType::Air )
 						try_place_fire(
 							neighbors[n][0], neighbors[n][1], z,
 							current_up_down_burn_base_chance[ z_index ] );
@@ -1834,10 +1959,10 @@ void h_World::FirePhysTick()
 		int X= x << H_CHUNK_WIDTH_LOG2;
 		int Y= y << H_CHUNK_WIDTH_LOG2;
 
-		std::vector< h_Fire* >& fire_list= chunk->fire_list_;
+		const std::vector<unsigned short>& fire_list= chunk->fire_list_;
 		for( unsigned int i= 0; i < fire_list.size(); )
 		{
-			h_Fire* fire= fire_list[i];
+			h_Fire* fire= chunk->GetFire( fire_list[i] );
 			i++;
 
 			bool is_extinguished= false;
@@ -1847,9 +1972,9 @@ void h_World::FirePhysTick()
 			{
 				bool is_sky= true;
 
-				h_Block** blocks= chunk->blocks_ + BlockAddr( fire->x_, fire->y_, 0 );
+				const unsigned short* const block_ids= chunk->GetBlockIdsData() + BlockAddr( fire->x_, fire->y_, 0 );
 				for( int z= fire->z_ + 1; z < H_CHUNK_HEIGHT - 1; z++ )
-					if( blocks[z]->Type() != h_BlockType::Air )
+					if( hBlockIdType( block_ids[z] ) != h_BlockType::Air )
 					{
 						is_sky= false;
 						break;
@@ -1861,20 +1986,17 @@ void h_World::FirePhysTick()
 			int global_x= X + fire->x_;
 			int global_y= Y + fire->y_;
 			if( is_extinguished ||
-				chunk->GetBlock( fire->x_, fire->y_, fire->z_ + 1 )->Type() == h_BlockType::Water ||
+				chunk->GetBlockType( fire->x_, fire->y_, fire->z_ + 1 ) == h_BlockType::Water ||
 				!can_pace_fire( global_x, global_y, fire->z_ ) )
 			{
 				int local_x= fire->x_;
 				int local_y= fire->y_;
 				int z= fire->z_;
 
+				// Last fire of list is moved into place of deleted fire.
 				chunk->DeleteLightSource( fire );
 				chunk->SetBlock( local_x, local_y, z, NormalBlock( h_BlockType::Air ) );
-
 				i--;
-				if( i + 1 != fire_list.size() )
-					fire_list[i]= fire_list.back();
-				fire_list.pop_back();
 
 				int r= chunk->FireLightLevel( local_x, local_y, z );
 				RelightBlockAdd( global_x, global_y, z );
@@ -1882,6 +2004,8 @@ void h_World::FirePhysTick()
 
 				UpdateInRadius( global_x, global_y, r );
 				UpdateWaterInRadius( global_x, global_y, r );
+
+				CheckBlockNeighbors( global_x, global_y, z );
 			}
 		} // for fire blocks
 	} // for xy chunks
@@ -1957,5 +2081,10 @@ void h_World::RainTick()
 void h_World::InitNormalBlocks()
 {
 	for( size_t i= 0; i < size_t(h_BlockType::NumBlockTypes); i++ )
+	{
 		new ( normal_blocks_ + i ) h_Block( h_BlockType( static_cast<h_BlockType>(i) ) );
+		shared_blocks_[i]= normal_blocks_ + i;
+	}
+	// Grass block may be active or not, unactive grass is shared.
+	shared_blocks_[ size_t(h_BlockType::Grass) ]= &unactive_grass_block_;
 }
@@ -1,9 +1,13 @@
 #pragma once
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "hex.hpp"
 #include "fwd.hpp"
@@ -11,8 +15,11 @@
 #include "chunk.hpp"
 #include "math_lib/rand.hpp"
 #include "math_lib/assert.hpp"
+#include "math_lib/ring_buffer.hpp"
 #include "world_action.hpp"
 #include "chunk_loader.hpp"
+#include "chunk_pool.hpp"
+#include "chunk_compression.hpp"
 #include "calendar.hpp"
 
 #include "vec.hpp"
@@ -24,6 +31,8 @@ Methods without comments about thread-safety can be called only in world thread.
 class h_World
 {
 	friend class h_Chunk;
+	// Tests of world logic.
+	friend class t_WorldTestAccess;
 
 public:
 	h_World(
@@ -75,7 +84,9 @@ public:
 	// Can return nullptr.
 	p_WorldPhysMeshConstPtr GetPhysMesh() const;
 
-	void Save();//save world data to disk
+	// Save world data to disk. Call in ui thread.
+	// If world updates are started, chunks snapshot is taken in world thread, at tick boundary.
+	void Save();
 
 	unsigned char SunLightLevel( int x, int y, int z ) const;
 	unsigned char FireLightLevel( int x, int y, int z ) const;
@@ -83,6 +94,10 @@ public:
 	void GetForwardVertexLight( int x, int y, int z, unsigned char* out_light ) const;
 	//returns light level of back-backleft upper vertex of prism X16. coordinates - relative
 	void GetBackVertexLight( int x, int y, int z, unsigned char* out_light ) const;
+	// Same, as methods above, but for vertices with z in range [ z_begin; z_end ).
+	// out_light - array of ( z_end - z_begin ) pairs of sun and fire light. z_end must be less, than H_CHUNK_HEIGHT.
+	void GetForwardVertexLightColumn( int x, int y, int z_begin, int z_end, unsigned char* out_light ) const;
+	void GetBackVertexLightColumn( int x, int y, int z_begin, int z_end, unsigned char* out_light ) const;
 
 	// Get time, calendar, latitude. All methods thread safe.
 	// Time of year, in ticks. 0 - midnight of first year day.
@@ -94,6 +109,22 @@ public:
 	// Current rain intensity. Thread safe.
 	float GetRainIntensity() const;
 
+	// Generate and save chunks in rectangle [longitude_min; longitude_max] x [latitude_min; latitude_max],
+	// which are not generated yet. Chunks are generated in parallel, using all cores.
+	// Call only if world updates are not started. Returns number of generated chunks.
+	unsigned int PregenerateChunks( int longitude_min, int latitude_min, int longitude_max, int latitude_max );
+
+	// Total time, which world thread spent waiting for chunks loading. Thread safe.
+	unsigned int GetChunksLoadingBlockedTimeMS() const;
+	// Statistics of chunks memory recycling. Thread safe.
+	h_ChunkPool::Stats GetChunkPoolStats() const;
+
+	// Autosave statistics of last autosave. Thread safe.
+	// Time, which world thread spent for chunks snapshot.
+	unsigned int GetAutosaveSnapshotTimeUS() const;
+	// Time from snapshot to finish of chunks writing.
+	unsigned int GetAutosaveLatencyMS() const;
+
 	// Set global coordinates of test mob.
 	// THREAD UNSAFE. REMOVE THIS.
 	void TestMobSetTargetPosition( int x, int y, int z );
@@ -115,9 +146,52 @@ private:
 	void UpdateInRadius( int x, int y, int r );//update chunks in square [x-r;x+r] [y-r;x+r]
 	void UpdateWaterInRadius( int x, int y, int r );//update chunks water in square [x-r;x+r] [y-r;x+r]
 
+	// Buffers for chunks serialization and compression. Each thread, which loads or saves chunks, must have own buffers.
+	struct ChunkDataBuffers
+	{
+		h_BinaryStorage compressed;
+		h_BinaryStorage uncompressed;
+	};
+
 	void MoveWorld( h_WorldMoveDirection dir );
-	void SaveChunk( h_Chunk* ch );
-	h_Chunk* LoadChunk( int longitude, int lattude );
+	// Write chunk header and chunk data into storage.
+	void SerializeChunk( const h_Chunk* ch, h_BinaryStorage& out ) const;
+	// Methods is thread safe, but each thread must use own buffers.
+	// Returns false, if chunk is not saved. Chunk stays modified in this case.
+	bool SaveChunk( h_Chunk* ch, ChunkDataBuffers& buffers );
+	h_Chunk* LoadChunk( int longitude, int lattude, ChunkDataBuffers& buffers );
+
+	// Chunks streaming. Chunks outside chunks matrix loaded and saved in background threads.
+	void StartChunksStreaming();
+	// Finish all pending saves, drop prefetched chunks.
+	void StopChunksStreaming();
+	void ChunksStreamingThreadFunc();
+	// Request background loading of chunks, which will be needed after world moving.
+	// Player position - predicted, in world space.
+	void PrefetchChunks( const m_Vec3& player_pos );
+	void PrefetchChunk( int longitude, int latitude );
+	// Delete prefetched chunks, which are not adjacent to chunks matrix anymore.
+	void DropUnneededPrefetchedChunks();
+	// Returns chunk for chunks matrix. Takes prefetched chunk, if it is ready, or loads it.
+	h_Chunk* AcquireChunk( int longitude, int latitude );
+	// Enqueue saving and deletion of chunk, removed from chunks matrix.
+	void ReleaseChunk( h_Chunk* ch );
+	// Retry failed savings and wait, until all released chunks are saved or failed again.
+	void WaitForChunksSaving();
+
+	// Autosave. Snapshot of modified chunks is taken in world thread, compression and writing are performed in autosave thread.
+	void StartAutosave();
+	// Finish writing of all taken snapshots.
+	void StopAutosave();
+	void AutosaveThreadFunc();
+	// Serialize modified chunks of chunks matrix and enqueue them for writing.
+	void TakeChunksSnapshot();
+	// Returns true and forgets chunk, if writing of its snapshot failed.
+	bool TakeFailedAutosaveChunk( int longitude, int latitude );
+	// Wait, until all snapshots are written and flushed.
+	void WaitForAutosave();
+	// Wait, until snapshot of chunk is written. Snapshot writing must not be reordered with other accesses to chunk data.
+	void WaitForChunkAutosave( int longitude, int latitude );
 
 	//coordinates of chunks in chunk matrix
 	void AddLightToBorderChunk( unsigned int X, unsigned int Y );
@@ -133,21 +207,42 @@ private:
 	//safe versions of lighting methods.
 
 	//lighting. relative coordinates
-	void SetSunLightLevel( int x, int y, int z, unsigned char l );
-	void SetFireLightLevel( int x, int y, int z, unsigned char l );
-
+	// Spread light of all chunks. Chunks interiors are processed in parallel, than borders between chunks.
 	void LightWorld();
-	//return update radius
+	struct LightPropagationQueue;
+	// Spread light inside chunk only.
+	static void PropagateChunkLight( h_Chunk* ch, bool sun, LightPropagationQueue& queue );
+	// Spread light of chunk border cells into whole world. Coordinates - in chunks matrix.
+	void PropagateChunkBorderLight( unsigned int X, unsigned int Y, bool sun, LightPropagationQueue& queue );
+	//return update radius - max distance of cells with changed light
 	int RelightBlockAdd( int x, int y, int z );
 	void RelightBlockRemove( int x, int y, int z );
 
-	void AddSunLight_r( int x, int y, int z, unsigned char l );
-	void AddFireLight_r( int x, int y, int z, unsigned char l );
-	void AddSunLightSafe_r( int x, int y, int z, unsigned char l );
-	void AddFireLightSafe_r( int x, int y, int z, unsigned char l );
-
-	//add light from light sources in cube
-	void ShineFireLight( int x_min, int y_min, int z_min, int x_max, int y_max, int z_max );
+	// Light propagation queue entry. X, Y - coordinates of chunk in chunks matrix, addr - block address in chunk.
+	struct LightQueueEntry
+	{
+		h_Chunk* chunk;
+		unsigned short addr;
+		unsigned char X, Y;
+		unsigned char level;
+	};
+
+	// Raise light level of cell up to "l" and enqueue it for spreading. Cells outside world are ignored.
+	void EnqueueLight( bool sun, int x, int y, int z, unsigned char l );
+	// Spread light from all enqueued cells. Iterative breadth-first search, does not use recursion.
+	void SpreadLight( bool sun );
+	// Add light of fire light source and spread it.
+	void AddFireLight( int x, int y, int z, unsigned char l );
+	// Remove light, spread from cell, which became less transparent, and spread light from remaining cells back.
+	// Touches only cells, lit through changed cell. Returns max distance in xy plane of changed cells.
+	int RemoveLight( bool sun, int x, int y, int z );
+	template<class Func>
+	void ForEachLightNeighbor( const LightQueueEntry& entry, const Func& func );
+
+	// Columns of prisms around vertex columns. Coordinates - relative.
+	h_VertexLightColumns GetForwardVertexLightColumns( int x, int y ) const;
+	h_VertexLightColumns GetBackVertexLightColumns( int x, int y ) const;
+	h_VertexLightColumns GetVertexLightColumns( const int (&columns_xy)[3][2] ) const;
 
 	void BlastBlock_r( int x, int y, int z, int blast_power );
 	bool InBorders( int x, int y, int z ) const;
@@ -156,10 +251,14 @@ private:
 	void PhysTick();
 	void TestMobTick();
 
-	void RelightWaterModifedChunksLight();//relight chunks, where water was modifed in last ticks
+	void RelightWaterModifedChunksLight();//relight blocks, where water was modifed in last ticks
 	void WaterPhysTick();
+	// Simulate unsettled water of chunk. X, Y - coordinates of chunk in chunks matrix.
+	void ChunkWaterPhysTick( unsigned int X, unsigned int Y );
 	bool WaterFlow( h_LiquidBlock* from, int to_x, int to_y, int to_z ); //returns true if chunk was midifed
 	bool WaterFlowDown( h_LiquidBlock* from, int to_x, int to_y, int to_z );
+	// Something changed in cell. Water in this cell, upper, lower and side cells must be simulated again.
+	void WakeWater( int x, int y, int z );
 
 	void GrassPhysTick();
 	void FirePhysTick();
@@ -168,6 +267,8 @@ private:
 
 	h_Block* NormalBlock( h_BlockType block_type );
 	h_GrassBlock* UnactiveGrassBlock();
+	// Blocks without own state for each block type. Chunk cells store only type of such blocks.
+	h_Block* const* SharedBlocks();
 
 	void InitNormalBlocks();
 
@@ -178,6 +279,9 @@ private:
 	h_ChunkLoader chunk_loader_;
 	std::unique_ptr<g_WorldGenerator> world_generator_;
 
+	// All chunks are created and deleted via this pool.
+	h_ChunkPool chunk_pool_;
+
 	// Active area margins. Active area is centred rect of chunks, where world physics works.
 	// Outside active area chunks unactive.
 	unsigned int active_area_margins_[2];
@@ -186,8 +290,16 @@ private:
 	// Loaded zone beginning longitude and latitude.
 	int longitude_, latitude_;
 
+	// Codec for saving of chunks. Chunks, saved with any codec, can be loaded.
+	h_ChunkCodec chunk_codec_;
+
 	m_Rand phys_processes_rand_;
 
+	// Queues for light spreading. Stored here for reusing of memory.
+	RingBuffer<LightQueueEntry> sun_light_queue_;
+	RingBuffer<LightQueueEntry> fire_light_queue_;
+	RingBuffer<LightQueueEntry> light_removal_queue_;
+
 	const h_Calendar calendar_;
 
 	r_IWorldRenderer* renderer_= nullptr;
@@ -228,12 +340,74 @@ private:
 	unsigned int test_mob_last_think_tick_= 0;
 	m_Vec3 test_mob_pos_;
 
-	h_BinaryStorage decompressed_chunk_data_buffer_; // Cache buffer for chunks decompression.
+	// Buffers are reused between calls, so, chunks saving and loading does not allocate memory in steady state.
+	ChunkDataBuffers chunk_data_buffers_; // For world thread.
+
+	// Chunk loader is not thread safe, all accesses to it must be under this mutex.
+	std::mutex chunk_loader_mutex_;
+
+	struct StreamingChunk
+	{
+		enum class State
+		{
+			LoadQueued,
+			Loading,
+			Loaded,
+			SaveQueued,
+			Saving,
+			SaveFailed, // Chunk is kept modified. Saving is retried in WaitForChunksSaving and StopChunksStreaming.
+		};
+
+		State state;
+		int longitude, latitude;
+		h_Chunk* chunk; // Not null for "Loaded", "SaveQueued", "Saving", "SaveFailed" states.
+	};
+
+	// Chunks outside chunks matrix, processed by streaming threads. Not more, than one chunk per coordinates.
+	// Vector used as queue - streaming threads take first queued chunk.
+	std::vector<StreamingChunk> streaming_chunks_;
+	std::mutex streaming_mutex_;
+	std::condition_variable streaming_jobs_condition_; // Notified, when job added or stop requested.
+	std::condition_variable streaming_chunk_ready_condition_; // Notified, when job finished.
+	bool streaming_need_stop_= false;
+	std::vector<std::thread> streaming_threads_;
+
+	std::atomic<uint64_t> chunks_loading_blocked_time_us_{ 0 };
+
+	struct AutosaveChunk
+	{
+		int longitude, latitude;
+		h_BinaryStorage data; // Uncompressed. Empty, while chunk is written.
+	};
+
+	// Snapshots of chunks, which are not written yet. Vector used as queue - first chunk is written now.
+	std::vector<AutosaveChunk> autosave_chunks_;
+	// Storages of written snapshots, for reusing.
+	std::vector<h_BinaryStorage> autosave_free_buffers_;
+	// Coordinates of chunks, which snapshots are not written because of compression or writing errors.
+	std::vector< std::pair<int, int> > autosave_failed_chunks_;
+	std::mutex autosave_mutex_;
+	std::condition_variable autosave_jobs_condition_; // Notified, when snapshot taken or stop requested.
+	std::condition_variable autosave_done_condition_; // Notified, when chunk written or snapshot taken.
+	bool autosave_need_stop_= false;
+	std::unique_ptr< std::thread > autosave_thread_;
+	unsigned int autosave_snapshots_taken_= 0; // Guarded by autosave_mutex_.
+	std::chrono::steady_clock::time_point autosave_snapshot_time_; // Guarded by autosave_mutex_.
+
+	// Autosave interval in ticks. 0 - autosave disabled.
+	unsigned int autosave_interval_ticks_;
+	unsigned int last_autosave_tick_;
+	std::atomic<bool> snapshot_requested_{ false };
+
+	std::atomic<unsigned int> autosave_snapshot_time_us_{ 0 };
+	std::atomic<unsigned int> autosave_latency_ms_{ 0 };
+	m_Vec3 prev_player_pos_; // Player position in previous tick, for speed calculation.
 
 	// All arrays - put at the end of class.
 
 	h_Block normal_blocks_[ size_t(h_BlockType::NumBlockTypes) ];
 	h_GrassBlock unactive_grass_block_;
+	h_Block* shared_blocks_[ size_t(h_BlockType::NumBlockTypes) ];
 
 	// Chunks matrix. chunk(x, y)= chunks_[ x + y * H_MAX_CHUNKS ]
 	h_Chunk* chunks_[ H_MAX_CHUNKS * H_MAX_CHUNKS ];
@@ -259,6 +433,26 @@ inline int h_World::Latitude () const
 	return latitude_;
 }
 
+inline unsigned int h_World::GetChunksLoadingBlockedTimeMS() const
+{
+	return (unsigned int)( chunks_loading_blocked_time_us_.load() / 1000u );
+}
+
+inline h_ChunkPool::Stats h_World::GetChunkPoolStats() const
+{
+	return chunk_pool_.GetStats();
+}
+
+inline unsigned int h_World::GetAutosaveSnapshotTimeUS() const
+{
+	return autosave_snapshot_time_us_.load();
+}
+
+inline unsigned int h_World::GetAutosaveLatencyMS() const
+{
+	return autosave_latency_ms_.load();
+}
+
 inline h_Chunk* h_World::GetChunk( int X, int Y )
 {
 	H_ASSERT( X >= 0 && X < (int)chunk_number_x_ );
@@ -285,6 +479,11 @@ inline h_GrassBlock* h_World::UnactiveGrassBlock()
 	return &unactive_grass_block_;
 }
 
+inline h_Block* const* h_World::SharedBlocks()
+{
+	return shared_blocks_;
+}
+
 inline int h_World::ClampX( int x ) const
 {
 	if( x < 0 )
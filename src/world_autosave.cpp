@@ -0,0 +1,194 @@
+#include <algorithm>
+
+#include "world.hpp"
+
+void h_World::StartAutosave()
+{
+	H_ASSERT( !autosave_thread_ );
+
+	autosave_need_stop_= false;
+	autosave_thread_.reset( new std::thread( &h_World::AutosaveThreadFunc, this ) );
+}
+
+void h_World::StopAutosave()
+{
+	H_ASSERT( autosave_thread_ );
+
+	{
+		std::lock_guard<std::mutex> lock( autosave_mutex_ );
+		autosave_need_stop_= true;
+	}
+	autosave_jobs_condition_.notify_one();
+
+	autosave_thread_->join();
+	autosave_thread_.reset();
+
+	H_ASSERT( autosave_chunks_.empty() );
+}
+
+void h_World::AutosaveThreadFunc()
+{
+	ChunkDataBuffers buffers;
+
+	std::unique_lock<std::mutex> lock( autosave_mutex_ );
+	while(true)
+	{
+		if( autosave_chunks_.empty() )
+		{
+			// Stop only when all snapshots are written.
+			if( autosave_need_stop_ )
+				break;
+			autosave_jobs_condition_.wait( lock );
+			continue;
+		}
+
+		// Take data, but keep chunk in queue, while it is not written.
+		AutosaveChunk& c= autosave_chunks_.front();
+		const int longitude= c.longitude;
+		const int latitude = c.latitude ;
+		buffers.uncompressed.swap( c.data );
+		lock.unlock();
+
+		bool written= hCompressChunkData( buffers.uncompressed, chunk_codec_, buffers.compressed );
+		if( written )
+		{
+			std::lock_guard<std::mutex> loader_lock( chunk_loader_mutex_ );
+			written= chunk_loader_.SetChunkData( longitude, latitude, buffers.compressed.data(), buffers.compressed.size() );
+		}
+
+		lock.lock();
+		// Chunk must be saved again by world.
+		if( !written )
+			autosave_failed_chunks_.emplace_back( longitude, latitude );
+		autosave_free_buffers_.push_back( std::move( buffers.uncompressed ) );
+		autosave_chunks_.erase( autosave_chunks_.begin() );
+
+		if( autosave_chunks_.empty() )
+		{
+			// All snapshots are written - make them durable.
+			lock.unlock();
+			{
+				std::lock_guard<std::mutex> loader_lock( chunk_loader_mutex_ );
+				chunk_loader_.ForceSaveAllChunks();
+			}
+			lock.lock();
+
+			autosave_latency_ms_=
+				(unsigned int)std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::steady_clock::now() - autosave_snapshot_time_ ).count();
+		}
+
+		autosave_done_condition_.notify_all();
+	}
+}
+
+void h_World::TakeChunksSnapshot()
+{
+	const auto start_time= std::chrono::steady_clock::now();
+
+	std::vector<h_BinaryStorage> free_buffers;
+	{
+		std::lock_guard<std::mutex> lock( autosave_mutex_ );
+		free_buffers.swap( autosave_free_buffers_ );
+
+		// Snapshots of these chunks are lost, mark chunks of chunks matrix as modified.
+		// Other failed chunks are saved by SaveChunk.
+		for( unsigned int i= 0; i < autosave_failed_chunks_.size(); )
+		{
+			const int x= autosave_failed_chunks_[i].first  - longitude_;
+			const int y= autosave_failed_chunks_[i].second - latitude_ ;
+			if( x >= 0 && x < int(chunk_number_x_) && y >= 0 && y < int(chunk_number_y_) )
+			{
+				h_Chunk* ch= GetChunk( x, y );
+				ch->saved_generation_= ch->ModificationGeneration() - 1u;
+				autosave_failed_chunks_[i]= autosave_failed_chunks_.back();
+				autosave_failed_chunks_.pop_back();
+			}
+			else
+				i++;
+		}
+	}
+
+	// Serialize chunks without lock, autosave thread can write previous snapshots meanwhile.
+	std::vector<AutosaveChunk> snapshot_chunks;
+	for( unsigned int y= 0; y < chunk_number_y_; y++ )
+	for( unsigned int x= 0; x < chunk_number_x_; x++ )
+	{
+		h_Chunk* ch= GetChunk( x, y );
+		if( !ch->IsModified() )
+			continue;
+
+		snapshot_chunks.emplace_back();
+		AutosaveChunk& c= snapshot_chunks.back();
+		c.longitude= ch->Longitude();
+		c.latitude = ch->Latitude ();
+		if( !free_buffers.empty() )
+		{
+			c.data= std::move( free_buffers.back() );
+			free_buffers.pop_back();
+		}
+
+		SerializeChunk( ch, c.data );
+		// Snapshot will be written before any other data of this chunk.
+		ch->saved_generation_= ch->ModificationGeneration();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( autosave_mutex_ );
+
+		for( AutosaveChunk& c : snapshot_chunks )
+			autosave_chunks_.push_back( std::move(c) );
+		for( h_BinaryStorage& buffer : free_buffers )
+			autosave_free_buffers_.push_back( std::move(buffer) );
+
+		autosave_snapshots_taken_++;
+		autosave_snapshot_time_= start_time;
+		snapshot_requested_.store(false);
+	}
+	last_autosave_tick_= phys_tick_count_;
+
+	autosave_jobs_condition_.notify_one();
+	autosave_done_condition_.notify_all();
+
+	autosave_snapshot_time_us_=
+		(unsigned int)std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start_time ).count();
+}
+
+bool h_World::TakeFailedAutosaveChunk( const int longitude, const int latitude )
+{
+	std::lock_guard<std::mutex> lock( autosave_mutex_ );
+
+	const auto it=
+		std::find(
+			autosave_failed_chunks_.begin(), autosave_failed_chunks_.end(),
+			std::make_pair( longitude, latitude ) );
+	if( it == autosave_failed_chunks_.end() )
+		return false;
+
+	autosave_failed_chunks_.erase( it );
+	return true;
+}
+
+void h_World::WaitForAutosave()
+{
+	std::unique_lock<std::mutex> lock( autosave_mutex_ );
+	autosave_done_condition_.wait( lock, [this] { return autosave_chunks_.empty(); } );
+}
+
+void h_World::WaitForChunkAutosave( const int longitude, const int latitude )
+{
+	std::unique_lock<std::mutex> lock( autosave_mutex_ );
+	autosave_done_condition_.wait(
+		lock,
+		[this, longitude, latitude]
+		{
+			return
+				std::find_if(
+					autosave_chunks_.begin(), autosave_chunks_.end(),
+					[longitude, latitude]( const AutosaveChunk& c )
+					{
+						return c.longitude == longitude && c.latitude == latitude;
+					} ) == autosave_chunks_.end();
+		} );
+}
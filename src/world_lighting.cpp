@@ -1,20 +1,10 @@
+#include <algorithm>
+#include <cstdlib>
+
 #include "renderer/i_world_renderer.hpp"
 #include "world.hpp"
-
-// Table for replacement of division in vertex light calculation.
-// This method not precise, but fast.
-static const unsigned int g_vertex_light_div_shift= 16;
-static const unsigned int g_vertex_light_div_table_multiplier= 1 << g_vertex_light_div_shift;
-static const unsigned int g_vertex_light_div_table[]=
-{
-	0,
-	g_vertex_light_div_table_multiplier * (13+1)/1,
-	g_vertex_light_div_table_multiplier * (13+2)/2,
-	g_vertex_light_div_table_multiplier * (13+3)/3,
-	g_vertex_light_div_table_multiplier * (13+4)/4,
-	g_vertex_light_div_table_multiplier * (13+5)/5,
-	g_vertex_light_div_table_multiplier * (13+6)/6,
-};
+#include "vertex_light.hpp"
+#include "parallel_for.hpp"
 
 unsigned char h_World::SunLightLevel( int x, int y, int z ) const
 {
@@ -31,640 +21,485 @@ unsigned char h_World::FireLightLevel( int x, int y, int z ) const
 
 void h_World::GetForwardVertexLight( int x, int y, int z, unsigned char* out_light ) const
 {
-	unsigned int block_count= 0;
-	unsigned char light[2]= { 0, 0 };
-	int  x1, y1;
-	const h_Chunk* ch;
-	unsigned int addr;
-
-	//current block
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x& (H_CHUNK_WIDTH-1), y&(H_CHUNK_WIDTH-1), z );
-	if( ( ch->transparency_[addr] & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
-	{
-		light[0]+= ch->sun_light_map_ [ addr ];
-		light[1]+= ch->fire_light_map_[ addr ];
-		block_count++;
-	}
-	addr++;
-	if( ( ch->transparency_[addr] & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
-	{
-		light[0]+= ch->sun_light_map_ [ addr ];
-		light[1]+= ch->fire_light_map_[ addr ];
-		block_count++;
-	}
+	hCalculateVertexLightColumn( GetForwardVertexLightColumns( x, y ), z, z + 1, out_light );
+}
 
-	//forwar block
-	y1= y+1;
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x& (H_CHUNK_WIDTH-1), y1&(H_CHUNK_WIDTH-1), z );
-	if( ( ch->transparency_[addr] & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
-	{
-		light[0]+= ch->sun_light_map_ [ addr ];
-		light[1]+= ch->fire_light_map_[ addr ];
-		block_count++;
-	}
-	addr++;
-	if( ( ch->transparency_[addr] & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
-	{
-		light[0]+= ch->sun_light_map_ [ addr ];
-		light[1]+= ch->fire_light_map_[ addr ];
-		block_count++;
-	}
+void h_World::GetBackVertexLight( int x, int y, int z, unsigned char* out_light ) const
+{
+	hCalculateVertexLightColumn( GetBackVertexLightColumns( x, y ), z, z + 1, out_light );
+}
 
-	//forward right block
-	x1= x + 1;
-	y1= y + ((x+1)&1);
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1& (H_CHUNK_WIDTH-1), y1&(H_CHUNK_WIDTH-1), z );
-	if( ( ch->transparency_[addr] & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
-	{
-		light[0]+= ch->sun_light_map_ [ addr ];
-		light[1]+= ch->fire_light_map_[ addr ];
-		block_count++;
-	}
-	addr++;
-	if( ( ch->transparency_[addr] & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
-	{
-		light[0]+= ch->sun_light_map_ [ addr ];
-		light[1]+= ch->fire_light_map_[ addr ];
-		block_count++;
-	}
+void h_World::GetForwardVertexLightColumn( int x, int y, int z_begin, int z_end, unsigned char* out_light ) const
+{
+	hCalculateVertexLightColumn( GetForwardVertexLightColumns( x, y ), z_begin, z_end, out_light );
+}
 
-	out_light[0]= ( ( (unsigned int)light[0] ) * g_vertex_light_div_table[ block_count ] )>> g_vertex_light_div_shift;
-	out_light[1]= ( ( (unsigned int)light[1] ) * g_vertex_light_div_table[ block_count ] )>> g_vertex_light_div_shift;
+void h_World::GetBackVertexLightColumn( int x, int y, int z_begin, int z_end, unsigned char* out_light ) const
+{
+	hCalculateVertexLightColumn( GetBackVertexLightColumns( x, y ), z_begin, z_end, out_light );
 }
 
-void h_World::GetBackVertexLight( int x, int y, int z, unsigned char* out_light ) const
+h_VertexLightColumns h_World::GetForwardVertexLightColumns( int x, int y ) const
 {
-	unsigned int block_count= 0;
-	unsigned char light[2]= { 0, 0 };
-	int  x1, y1;
-	const h_Chunk* ch;
-	unsigned int addr;
-
-	//current block
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x& (H_CHUNK_WIDTH-1), y&(H_CHUNK_WIDTH-1), z );
-	if( ( ch->transparency_[addr] & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
-	{
-		light[0]+= ch->sun_light_map_ [ addr ];
-		light[1]+= ch->fire_light_map_[ addr ];
-		block_count++;
-	}
-	addr++;
-	if( ( ch->transparency_[addr] & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
-	{
-		light[0]+= ch->sun_light_map_ [ addr ];
-		light[1]+= ch->fire_light_map_[ addr ];
-		block_count++;
-	}
+	// Current, forward and forward right columns.
+	const int columns_xy[3][2]= { { x, y }, { x, y + 1 }, { x + 1, y + ((x+1)&1) } };
+	return GetVertexLightColumns( columns_xy );
+}
 
-	//back block
-	y1= y-1;
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x& (H_CHUNK_WIDTH-1), y1&(H_CHUNK_WIDTH-1), z );
-	if( ( ch->transparency_[addr] & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
-	{
-		light[0]+= ch->sun_light_map_ [ addr ];
-		light[1]+= ch->fire_light_map_[ addr ];
-		block_count++;
-	}
-	addr++;
-	if( ( ch->transparency_[addr] & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
-	{
-		light[0]+= ch->sun_light_map_ [ addr ];
-		light[1]+= ch->fire_light_map_[ addr ];
-		block_count++;
-	}
+h_VertexLightColumns h_World::GetBackVertexLightColumns( int x, int y ) const
+{
+	// Current, back and back left columns.
+	const int columns_xy[3][2]= { { x, y }, { x, y - 1 }, { x - 1, y - (x&1) } };
+	return GetVertexLightColumns( columns_xy );
+}
 
-	//back left block
-	x1= x - 1;
-	y1= y - (x&1);
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1& (H_CHUNK_WIDTH-1), y1&(H_CHUNK_WIDTH-1), z );
-	if( ( ch->transparency_[addr] & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
-	{
-		light[0]+= ch->sun_light_map_ [ addr ];
-		light[1]+= ch->fire_light_map_[ addr ];
-		block_count++;
-	}
-	addr++;
-	if( ( ch->transparency_[addr] & H_VISIBLY_TRANSPARENCY_BITS ) != TRANSPARENCY_SOLID )
+h_VertexLightColumns h_World::GetVertexLightColumns( const int (&columns_xy)[3][2] ) const
+{
+	h_VertexLightColumns columns;
+	for( unsigned int i= 0; i < 3; i++ )
 	{
-		light[0]+= ch->sun_light_map_ [ addr ];
-		light[1]+= ch->fire_light_map_[ addr ];
-		block_count++;
-	}
+		const int x= columns_xy[i][0], y= columns_xy[i][1];
+		const h_Chunk* const ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
+		const unsigned int addr= BlockAddr( x& (H_CHUNK_WIDTH-1), y&(H_CHUNK_WIDTH-1), 0 );
 
-	out_light[0]= ( ( (unsigned int)light[0] ) * g_vertex_light_div_table[ block_count ] )>> g_vertex_light_div_shift;
-	out_light[1]= ( ( (unsigned int)light[1] ) * g_vertex_light_div_table[ block_count ] )>> g_vertex_light_div_shift;
+		columns.transparency[i]= ch->transparency_ + addr;
+		columns.light       [i]= ch->light_map_    + addr;
+	}
+	return columns;
 }
 
-void h_World::SetSunLightLevel( int x, int y, int z, unsigned char l )
+static_assert( H_MAX_SUN_LIGHT <= H_MAX_FIRE_LIGHT, "Light propagation queue is too small" );
+
+// Light propagation queue. Cells are processed in order of decreasing light level,
+// so, each cell spreads light only once, with its final level.
+struct h_World::LightPropagationQueue
 {
-	GetChunk( x >> H_CHUNK_WIDTH_LOG2, y>> H_CHUNK_WIDTH_LOG2 )->
-	sun_light_map_[ BlockAddr(  x& (H_CHUNK_WIDTH-1), y& (H_CHUNK_WIDTH-1), z ) ]= l;
-}
+	std::vector<unsigned int> cells[ H_MAX_FIRE_LIGHT + 1 ];
+};
 
-void h_World::SetFireLightLevel( int x, int y, int z, unsigned char l )
+// Cells in propagation queue of whole world.
+static const unsigned int g_world_cell_y_shift= H_CHUNK_HEIGHT_LOG2;
+static const unsigned int g_world_cell_x_shift= H_CHUNK_HEIGHT_LOG2 + H_MAX_CHUNKS_LOG2 + H_CHUNK_WIDTH_LOG2;
+
+static unsigned int WorldCell( const unsigned int x, const unsigned int y, const unsigned int z )
 {
-	GetChunk( x >> H_CHUNK_WIDTH_LOG2, y>> H_CHUNK_WIDTH_LOG2 )->
-	fire_light_map_[ BlockAddr(  x& (H_CHUNK_WIDTH-1), y& (H_CHUNK_WIDTH-1), z ) ]= l;
+	return z | ( y << g_world_cell_y_shift ) | ( x << g_world_cell_x_shift );
 }
 
 void h_World::LightWorld()
 {
-	//main chunks. used fast lighting functions ( without coordinate clamping )
-	for( unsigned int i= 1; i< chunk_number_x_ - 1; i++ )
-	for( unsigned int j= 1; j< chunk_number_y_ - 1; j++ )
+	const unsigned int chunk_count= chunk_number_x_ * chunk_number_y_;
+	std::vector<LightPropagationQueue> queues( hParallelForThreadCount( chunk_count ) );
+
+	// Spread light inside each chunk. Chunks are independent here.
+	hParallelFor(
+		chunk_count,
+		[this, &queues]( const unsigned int index, const unsigned int thread_index )
+		{
+			h_Chunk* const ch= GetChunk( index % chunk_number_x_, index / chunk_number_x_ );
+			PropagateChunkLight( ch, true , queues[ thread_index ] );
+			PropagateChunkLight( ch, false, queues[ thread_index ] );
+		} );
+
+	// Spread light through chunks borders.
+	// Light spreads only into adjacent chunks, so, chunks with same coordinates modulo 3 do not touch
+	// same data and can be processed in parallel. Result of light propagation does not depend on order.
+	static_assert( H_MAX_SUN_LIGHT < H_CHUNK_WIDTH && H_MAX_FIRE_LIGHT < H_CHUNK_WIDTH, "Light spreads too far" );
+
+	for( unsigned int phase= 0; phase < 3 * 3; phase++ )
 	{
-		h_Chunk* ch= GetChunk( i, j );
-		int X= i * H_CHUNK_WIDTH, Y= j * H_CHUNK_WIDTH;
-		for( int x= 0; x< H_CHUNK_WIDTH; x++ )
-		for( int y= 0; y< H_CHUNK_WIDTH; y++ )
-		for( int z= 1; z< H_CHUNK_HEIGHT - 1; z++ )
-			AddSunLight_r( X+x, Y+y, z, ch->SunLightLevel(x,y,z) );
-
-		const std::vector< h_LightSource* >& light_sources= ch->GetLightSourceList();
-		for( const h_LightSource* source : light_sources )
-			AddFireLight_r( X + source->x_, Y + source->y_, source->z_, source->LightLevel() );
+		const unsigned int start_x= phase % 3, start_y= phase / 3;
+		const unsigned int count_x= ( chunk_number_x_ - start_x + 2 ) / 3;
+		const unsigned int count_y= ( chunk_number_y_ - start_y + 2 ) / 3;
+
+		hParallelFor(
+			count_x * count_y,
+			[this, &queues, start_x, start_y, count_x]( const unsigned int index, const unsigned int thread_index )
+			{
+				const unsigned int X= start_x + index % count_x * 3;
+				const unsigned int Y= start_y + index / count_x * 3;
+				PropagateChunkBorderLight( X, Y, true , queues[ thread_index ] );
+				PropagateChunkBorderLight( X, Y, false, queues[ thread_index ] );
+			} );
 	}
+}
 
-	//north and south chunks
-	for( unsigned int k= 0; k< 2; k++ )
-	for( unsigned int i= 0; i< chunk_number_x_; i++ )
+void h_World::PropagateChunkLight( h_Chunk* const ch, const bool sun, LightPropagationQueue& queue )
+{
+	const unsigned char transparency_bit= sun ? H_SECONDARY_SUN_LIGHT_TRANSPARENCY_BIT : H_FIRE_LIGHT_TRANSPARENCY_BIT;
+	const h_CombinedTransparency* const transparency= ch->transparency_;
+
+	if( !sun )
 	{
-		h_Chunk* ch= GetChunk( i, k * (chunk_number_y_-1) );
-		int X= i * H_CHUNK_WIDTH, Y=  H_CHUNK_WIDTH * k * (chunk_number_y_-1) ;
-		for( int x= 0; x< H_CHUNK_WIDTH; x++ )
-		for( int y= 0; y< H_CHUNK_WIDTH; y++ )
-		for( int z= 1; z< H_CHUNK_HEIGHT-1; z++ )
-			AddSunLightSafe_r( X+x, Y+y, z, ch->SunLightLevel(x,y,z) );
-
-		const std::vector< h_LightSource* >& light_sources= ch->GetLightSourceList();
-		for( const h_LightSource* source : light_sources )
-			AddFireLightSafe_r( X + source->x_, Y + source->y_, source->z_, source->LightLevel() );
+		for( const unsigned short addr : ch->GetLightSourceList() )
+			ch->SetLightLevel( addr, false, std::max( ch->LightLevel( addr, false ), ch->GetLightSource( addr )->LightLevel() ) );
 	}
 
-	//east and west chunks
-	for( unsigned int k= 0; k< 2; k++ )
-	for( unsigned int j= 0; j< chunk_number_y_; j++ )
+	for( unsigned int addr= 0; addr < H_CHUNK_WIDTH * H_CHUNK_WIDTH * H_CHUNK_HEIGHT; addr++ )
 	{
-		h_Chunk* ch= GetChunk( k*( chunk_number_x_ - 1), j );
-		int X= k*( chunk_number_x_ - 1) * H_CHUNK_WIDTH, Y=  j * H_CHUNK_WIDTH;
-		for( int x= 0; x< H_CHUNK_WIDTH; x++ )
-		for( int y= 0; y< H_CHUNK_WIDTH; y++ )
-		for( int z= 1; z< H_CHUNK_HEIGHT-1; z++ )
-			AddSunLightSafe_r( X+x, Y+y, z, ch->SunLightLevel(x,y,z) );
-
-		const std::vector< h_LightSource* >& light_sources= ch->GetLightSourceList();
-		for( const h_LightSource* source : light_sources )
-			AddFireLightSafe_r( X + source->x_, Y + source->y_, source->z_, source->LightLevel() );
+		const unsigned char l= ch->LightLevel( addr, sun );
+		if( l > 1 )
+			queue.cells[l].push_back( addr );
 	}
-}
 
-int h_World::RelightBlockAdd( int x, int y, int z )
-{
-	unsigned char l= SunLightLevel( x, y, z );
-	unsigned char fire_l= FireLightLevel( x, y, z );
-	SetSunLightLevel( x, y, z, 0 );
-	SetFireLightLevel( x, y, z, 0 );
-	if( l == 0 && fire_l == 0 )
-		return 1;
-
-	int x_min, x_max, y_min, y_max, z_min, z_max;
-	x_min= x + 1 - (int)(l);
-	x_max= x - 1 + (int)(l);
-	y_min= y + 1 - (int)(l);
-	y_max= y - 1 + (int)(l);
-	z_max= ClampZ( z - 1 + (int)(l) );
-
-	int i, j, k;
-	//remove all light
-	for( i= x_min; i<= x_max; i++ )
-	for( j= y_min; j<= y_max; j++ )
-	for( k= z_max; k> 0; k-- )
-		SetSunLightLevel( i, j, k, 0 );
-
-	//sun shine in square
-	for( i= x_min; i<= x_max; i++ )
-	for( j= y_min; j<= y_max; j++ )
+	for( unsigned int l= H_MAX_FIRE_LIGHT; l > 1; l-- )
 	{
-		h_Chunk* ch= GetChunk( i>> H_CHUNK_WIDTH_LOG2, j>> H_CHUNK_WIDTH_LOG2 );
-		int local_i= i & ( H_CHUNK_WIDTH-1), local_j= j & ( H_CHUNK_WIDTH-1);
-		unsigned char* sun_light_map= ch->sun_light_map_ + BlockAddr( local_i, local_j, H_CHUNK_HEIGHT-2 );
+		const unsigned char l1= (unsigned char)( l - 1 );
+		const auto spread=
+		[ch, sun, &queue, l1]( const unsigned int addr )
+		{
+			if( ch->LightLevel( addr, sun ) < l1 )
+			{
+				ch->SetLightLevel( addr, sun, l1 );
+				if( l1 > 1 )
+					queue.cells[l1].push_back( addr );
+			}
+		};
 
-		unsigned int addr= BlockAddr( local_i, local_j, 0 );
-		for( k= H_CHUNK_HEIGHT-2; k> 0; k--, sun_light_map-- )
+		for( const unsigned int addr : queue.cells[l] )
 		{
-			if( !( ch->transparency_[ addr + k ] & H_DIRECT_SUN_LIGHT_TRANSPARENCY_BIT ) )
-				break;
-			sun_light_map[0]= H_MAX_SUN_LIGHT;
+			if( ch->LightLevel( addr, sun ) != l || ( transparency[addr] & transparency_bit ) == 0 )
+				continue;
+
+			const int x= int( addr >> ( H_CHUNK_HEIGHT_LOG2 + H_CHUNK_WIDTH_LOG2 ) );
+			const int y= int( ( addr >> H_CHUNK_HEIGHT_LOG2 ) & ( H_CHUNK_WIDTH - 1 ) );
+			const int z= int( addr & ( H_CHUNK_HEIGHT - 1 ) );
+
+			spread( addr + 1 );
+			spread( addr - 1 );
+
+			// Light outside chunk is spread in borders pass.
+			const int forward_y= y + ((x+1)&1);
+			const int back_y= y - (x&1);
+			if( y + 1 < H_CHUNK_WIDTH )
+				spread( BlockAddr( x, y + 1, z ) );
+			if( y > 0 )
+				spread( BlockAddr( x, y - 1, z ) );
+			if( x + 1 < H_CHUNK_WIDTH )
+			{
+				if( forward_y < H_CHUNK_WIDTH )
+					spread( BlockAddr( x + 1, forward_y, z ) );
+				if( back_y >= 0 )
+					spread( BlockAddr( x + 1, back_y, z ) );
+			}
+			if( x > 0 )
+			{
+				if( forward_y < H_CHUNK_WIDTH )
+					spread( BlockAddr( x - 1, forward_y, z ) );
+				if( back_y >= 0 )
+					spread( BlockAddr( x - 1, back_y, z ) );
+			}
 		}
+		queue.cells[l].clear();
 	}
+}
 
-	//secondary sun shine
-	for( i= x_min; i<= x_max; i++ )
-	for( j= y_min; j<= y_max; j++ )
-	for( k= z_max; k> 0; k-- )
-		AddSunLight_r( i, j, k, SunLightLevel( i, j, k ) );
+void h_World::PropagateChunkBorderLight( const unsigned int X, const unsigned int Y, const bool sun, LightPropagationQueue& queue )
+{
+	const unsigned char transparency_bit= sun ? H_SECONDARY_SUN_LIGHT_TRANSPARENCY_BIT : H_FIRE_LIGHT_TRANSPARENCY_BIT;
+	const int max_x= int( chunk_number_x_ * H_CHUNK_WIDTH );
+	const int max_y= int( chunk_number_y_ * H_CHUNK_WIDTH );
 
-	//secondary sun shine from borders
-	for( i= x_min; i<= x_max; i++ )
-	for( k= z_max; k> 0; k-- )
+	// Only cells at chunk border can spread light into other chunks.
 	{
-		AddSunLight_r( i, y_min-1, k, SunLightLevel( i, y_min-1, k ) );
-		AddSunLight_r( i, y_max+1, k, SunLightLevel( i, y_max+1, k ) );
-	}
+		const h_Chunk* const ch= GetChunk( X, Y );
 
-	for( j= y_min; j<= y_max; j++ )
-	for( k= z_max; k> 0; k-- )
-	{
-		AddSunLight_r( x_min-1, j, k, SunLightLevel( x_min-1, j, k ) );
-		AddSunLight_r( x_max+1, j, k, SunLightLevel( x_max+1, j, k ) );
+		for( unsigned int x= 0; x < H_CHUNK_WIDTH; x++ )
+		for( unsigned int y= 0; y < H_CHUNK_WIDTH; y++ )
+		{
+			if( !( x == 0 || y == 0 || x == H_CHUNK_WIDTH - 1 || y == H_CHUNK_WIDTH - 1 ) )
+				continue;
+
+			const unsigned int global_x= X * H_CHUNK_WIDTH + x, global_y= Y * H_CHUNK_WIDTH + y;
+			for( unsigned int z= 1; z < H_CHUNK_HEIGHT - 1; z++ )
+			{
+				const unsigned char l= ch->LightLevel( BlockAddr( x, y, z ), sun );
+				if( l > 1 )
+					queue.cells[l].push_back( WorldCell( global_x, global_y, z ) );
+			}
+		}
 	}
 
-	for( i= x_min; i<= x_max; i++ )
-	for( j= y_min; j<= y_max; j++ )
-		AddSunLight_r( i, j, z_max+1, SunLightLevel( i, j, z_max+1 ) );
+	for( unsigned int l= H_MAX_FIRE_LIGHT; l > 1; l-- )
+	{
+		const unsigned char l1= (unsigned char)( l - 1 );
+		const auto spread=
+		[this, sun, &queue, l1, max_x, max_y]( const int x, const int y, const int z )
+		{
+			if( x < 0 || y < 0 || x >= max_x || y >= max_y )
+				return;
 
+			h_Chunk* const ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
+			const unsigned int addr= BlockAddr( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), z );
+			if( ch->LightLevel( addr, sun ) < l1 )
+			{
+				ch->SetLightLevel( addr, sun, l1 );
+				if( l1 > 1 )
+					queue.cells[l1].push_back( WorldCell( x, y, z ) );
+			}
+		};
 
-	x_min= x + 1 - (int)(fire_l);
-	x_max= x - 1 + (int)(fire_l);
-	y_min= y + 1 - (int)(fire_l);
-	y_max= y - 1 + (int)(fire_l);
-	z_min= ClampZ( z + 1 - (int)(fire_l) );
-	z_max= ClampZ( z - 1 + (int)(fire_l) );
+		for( const unsigned int cell : queue.cells[l] )
+		{
+			const int x= int( cell >> g_world_cell_x_shift );
+			const int y= int( ( cell >> g_world_cell_y_shift ) & ( ( 1u << ( g_world_cell_x_shift - g_world_cell_y_shift ) ) - 1u ) );
+			const int z= int( cell & ( H_CHUNK_HEIGHT - 1 ) );
+
+			const h_Chunk* const ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
+			const unsigned int addr= BlockAddr( x & (H_CHUNK_WIDTH - 1), y & (H_CHUNK_WIDTH - 1), z );
+			if( ch->LightLevel( addr, sun ) != l ||
+				( ch->transparency_[addr] & transparency_bit ) == 0 )
+				continue;
+
+			spread( x, y, z + 1 );
+			spread( x, y, z - 1 );
+			spread( x, y + 1, z );
+			spread( x, y - 1, z );
+			spread( x + 1, y + ((x+1)&1), z );
+			spread( x + 1, y - (x&1), z );
+			spread( x - 1, y + ((x+1)&1), z );
+			spread( x - 1, y - (x&1), z );
+		}
+		queue.cells[l].clear();
+	}
+}
 
-	//zero fire light in cube
-	for( i= x_min; i<= x_max; i++ )
-	for( j= y_min; j<= y_max; j++ )
-	for( k= z_min; k<= z_max; k++ )
-		SetFireLightLevel( i, j, k, 0 );
+int h_World::RelightBlockAdd( int x, int y, int z )
+{
+	const int sun_radius= RemoveLight( true, x, y, z );
+	const int fire_radius= RemoveLight( false, x, y, z );
+	return std::max( 1, std::max( sun_radius, fire_radius ) );
+}
 
-	//secondary fire shine from borders
-	for( i= x_min; i<= x_max; i++ )
-	for( k= z_min; k<= z_max; k++ )
-	{
-		AddFireLight_r( i, y_min-1, k, FireLightLevel( i, y_min-1, k ) );
-		AddFireLight_r( i, y_max+1, k, FireLightLevel( i, y_max+1, k ) );
-	}
+void h_World::RelightBlockRemove( int x, int y, int z )
+{
+	h_Chunk* ch= GetChunk( x>> H_CHUNK_WIDTH_LOG2, y>> H_CHUNK_WIDTH_LOG2 );
+	const int x1= x& ( H_CHUNK_WIDTH-1);
+	const int y1= y& ( H_CHUNK_WIDTH-1);
+	const int z0= ch->HeightMapValue( x1, y1 );
 
-	for( j= y_min; j<= y_max; j++ )
-	for( k= z_min; k<= z_max; k++ )
-	{
-		AddFireLight_r( x_min-1, j, k, FireLightLevel( x_min-1, j, k ) );
-		AddFireLight_r( x_max+1, j, k, FireLightLevel( x_max+1, j, k ) );
-	}
+	ch->SetSunLightLevelColumn( BlockAddr( x1, y1, 0 ), z0 + 1, H_CHUNK_HEIGHT - 1, H_MAX_SUN_LIGHT );
 
-	for( i= x_min; i<= x_max; i++ )
-	for( j= y_min; j<= y_max; j++ )
+	for( int z1= z; z1> z0; z1-- )
 	{
-		AddFireLight_r( i, j, z_min-1, FireLightLevel( i, j, z_min-1 ) );
-		AddFireLight_r( i, j, z_max+1, FireLightLevel( i, j, z_max+1 ) );
+		EnqueueLight( true, x, y, z1, SunLightLevel( x, y, z1) );
 	}
 
-	//shining from kight sources in cube
-	ShineFireLight( x_min, y_min, z_min, x_max, y_max, z_max );
+	EnqueueLight( true, x, y, z, SunLightLevel(x, y, z) );
+	SpreadLight( true );
 
-	return (int)std::max( l, fire_l );
+	AddFireLight( x, y, z, FireLightLevel(x, y, z) );
 }
 
-void h_World::RelightBlockRemove( int x, int y, int z )
+// Hex neighbors offsets ( dx, dy ) for even and odd x.
+static const int g_hex_neighbors_offsets[2][6][2]=
 {
-	int x1, y1, z1, z0;
-	h_Chunk* ch= GetChunk( x>> H_CHUNK_WIDTH_LOG2, y>> H_CHUNK_WIDTH_LOG2 );
-	x1= x& ( H_CHUNK_WIDTH-1);
-	y1= y& ( H_CHUNK_WIDTH-1);
-	unsigned char* lightmap= &ch->sun_light_map_[ BlockAddr( x1, y1, H_CHUNK_HEIGHT-2 ) ];
+	{ { 0, +1 }, { 0, -1 }, { +1, +1 }, { +1, 0 }, { -1, +1 }, { -1, 0 } },
+	{ { 0, +1 }, { 0, -1 }, { +1, 0 }, { +1, -1 }, { -1, 0 }, { -1, -1 } },
+};
+
+// Same offsets, but for block address inside chunk.
+#define HEX_NEIGHBOR_ADDR_OFFSET( parity, n )\
+	( g_hex_neighbors_offsets[parity][n][0] * ( 1 << ( H_CHUNK_HEIGHT_LOG2 + H_CHUNK_WIDTH_LOG2 ) ) +\
+	  g_hex_neighbors_offsets[parity][n][1] * ( 1 << H_CHUNK_HEIGHT_LOG2 ) )
 
-	unsigned int addr= BlockAddr( x1, y1, 0 );
-	for( z1= H_CHUNK_HEIGHT-2; z1>0 ; z1--, lightmap-- )
+static const int g_hex_neighbors_addr_offsets[2][6]=
+{
 	{
-		if( !( ch->transparency_[ addr + z1 ] & H_DIRECT_SUN_LIGHT_TRANSPARENCY_BIT ) )
-			break;
-		*lightmap= H_MAX_SUN_LIGHT;
-	}
-	z0= z1;
-	for( z1= z; z1> z0; z1-- )
+		HEX_NEIGHBOR_ADDR_OFFSET( 0, 0 ), HEX_NEIGHBOR_ADDR_OFFSET( 0, 1 ), HEX_NEIGHBOR_ADDR_OFFSET( 0, 2 ),
+		HEX_NEIGHBOR_ADDR_OFFSET( 0, 3 ), HEX_NEIGHBOR_ADDR_OFFSET( 0, 4 ), HEX_NEIGHBOR_ADDR_OFFSET( 0, 5 ),
+	},
 	{
-		AddSunLight_r( x, y, z1, SunLightLevel( x, y, z1) );
-	}
+		HEX_NEIGHBOR_ADDR_OFFSET( 1, 0 ), HEX_NEIGHBOR_ADDR_OFFSET( 1, 1 ), HEX_NEIGHBOR_ADDR_OFFSET( 1, 2 ),
+		HEX_NEIGHBOR_ADDR_OFFSET( 1, 3 ), HEX_NEIGHBOR_ADDR_OFFSET( 1, 4 ), HEX_NEIGHBOR_ADDR_OFFSET( 1, 5 ),
+	},
+};
+
+#undef HEX_NEIGHBOR_ADDR_OFFSET
 
-	AddSunLight_r( x, y, z, SunLightLevel(x, y, z) );
-
-	/*
-	AddSunLight_r( x, y, z+ 1, SunLightLevel(x, y, z+ 1) );
-	AddSunLight_r( x, y, z-1, SunLightLevel(x, y, z-1) );
-	AddSunLight_r( x, y+1, z, SunLightLevel(x, y+1, z) );
-	AddSunLight_r( x, y-1, z, SunLightLevel(x, y-1, z) );
-	AddSunLight_r( x+1, y+((1+x)&1), z, SunLightLevel(x+1, y+((1+x)&1), z) );
-	AddSunLight_r( x+1, y- (x&1), z, SunLightLevel(x+1, y- (x&1), z) );
-	AddSunLight_r( x-1, y+((1+x)&1), z, SunLightLevel(x-1, y+((1+x)&1), z) );
-	AddSunLight_r( x-1, y- (x&1), z , SunLightLevel(x-1, y- (x&1), z) );
-	*/
-
-	AddFireLight_r( x, y, z, FireLightLevel(x, y, z) );
-
-	/*
-	AddFireLight_r( x, y, z+ 1, FireLightLevel(x, y, z+ 1) );
-	AddFireLight_r( x, y, z-1, FireLightLevel(x, y, z-1) );
-	AddFireLight_r( x, y+1, z, FireLightLevel(x, y+1, z) );
-	AddFireLight_r( x, y-1, z, FireLightLevel(x, y-1, z) );
-	AddFireLight_r( x+1, y+((1+x)&1), z, FireLightLevel(x+1, y+((1+x)&1), z) );
-	AddFireLight_r( x+1, y- (x&1), z, FireLightLevel(x+1, y- (x&1), z) );
-	AddFireLight_r( x-1, y+((1+x)&1), z, FireLightLevel(x-1, y+((1+x)&1), z) );
-	AddFireLight_r( x-1, y- (x&1), z , FireLightLevel(x-1, y- (x&1), z) );
-	*/
+void h_World::AddFireLight( const int x, const int y, const int z, const unsigned char l )
+{
+	EnqueueLight( false, x, y, z, l );
+	SpreadLight( false );
 }
 
-void h_World::AddSunLight_r( int x, int y, int z, unsigned char l )
+void h_World::EnqueueLight( const bool sun, const int x, const int y, const int z, const unsigned char l )
 {
-	h_Chunk* ch;
-	int x1, y1;
-	unsigned int addr;
+	if( x < 0 || y < 0 || z < 0 ||
+		x >= int( chunk_number_x_ * H_CHUNK_WIDTH ) ||
+		y >= int( chunk_number_y_ * H_CHUNK_WIDTH ) ||
+		z >= H_CHUNK_HEIGHT )
+		return;
 
-	addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y & ( H_CHUNK_WIDTH - 1 ), z );
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
-	ch->sun_light_map_[ addr ]= l;
+	const unsigned int X= x >> H_CHUNK_WIDTH_LOG2, Y= y >> H_CHUNK_WIDTH_LOG2;
+	h_Chunk* const ch= GetChunk( X, Y );
+	const unsigned int addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y & ( H_CHUNK_WIDTH - 1 ), z );
 
-	if( l <= 1 ||
-		( ch->transparency_[addr] & H_SECONDARY_SUN_LIGHT_TRANSPARENCY_BIT ) == 0 )
+	if( ch->LightLevel( addr, sun ) > l )
 		return;
-	unsigned char l1= l-1;
-
-	//upper block
-	addr++;
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLight_r( x, y, z + 1, l1 );
-	//lower block
-	addr-= 2;
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLight_r( x, y, z - 1, l1 );
-	//forward block
-	y1= y + 1;
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLight_r( x, y1, z, l1 );
-	//back block
-	y1= y - 1;
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLight_r( x, y1, z, l1 );
-	//forwad right
-	x1= x+1;
-	y1= y +((x+1)&1);
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLight_r( x1, y1, z, l1 );
-	//back right
-	x1= x+1;
-	y1= y -(x&1);
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLight_r( x1, y1, z, l1 );
-	//forwad left
-	x1= x-1;
-	y1= y +((x+1)&1);
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLight_r( x1, y1, z, l1 );
-	//back left
-	x1= x-1;
-	y1= y -(x&1);
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLight_r( x1, y1, z, l1 );
+	ch->SetLightLevel( addr, sun, l );
+
+	const unsigned char transparency_bit= sun ? H_SECONDARY_SUN_LIGHT_TRANSPARENCY_BIT : H_FIRE_LIGHT_TRANSPARENCY_BIT;
+	if( l > 1 && ( ch->transparency_[ addr ] & transparency_bit ) != 0 )
+		( sun ? sun_light_queue_ : fire_light_queue_ ).push_back( LightQueueEntry{ ch, (unsigned short)addr, (unsigned char)X, (unsigned char)Y, l } );
 }
 
-void h_World::AddFireLight_r( int x, int y, int z, unsigned char l )
+template<class Func>
+void h_World::ForEachLightNeighbor( const LightQueueEntry& entry, const Func& func )
 {
-	h_Chunk* ch;
-	int x1, y1;
-	unsigned int addr;
-
-	addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y & ( H_CHUNK_WIDTH - 1 ), z );
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
-	ch->fire_light_map_[ addr ]= l;
+	const int z= int( entry.addr & ( H_CHUNK_HEIGHT - 1 ) );
+	if( z < H_CHUNK_HEIGHT - 1 )
+		func( entry.chunk, entry.X, entry.Y, entry.addr + 1u );
+	if( z > 0 )
+		func( entry.chunk, entry.X, entry.Y, entry.addr - 1u );
+
+	const int x= int( entry.addr >> ( H_CHUNK_HEIGHT_LOG2 + H_CHUNK_WIDTH_LOG2 ) );
+	const int y= int( ( entry.addr >> H_CHUNK_HEIGHT_LOG2 ) & ( H_CHUNK_WIDTH - 1 ) );
+	if( x > 0 && y > 0 && x < H_CHUNK_WIDTH - 1 && y < H_CHUNK_WIDTH - 1 )
+	{
+		// All neighbors are in same chunk.
+		const int* const addr_offsets= g_hex_neighbors_addr_offsets[ x & 1 ];
+		for( unsigned int n= 0; n < 6; n++ )
+			func( entry.chunk, entry.X, entry.Y, (unsigned int)( int(entry.addr) + addr_offsets[n] ) );
+	}
+	else
+	{
+		const int (* const offsets)[2]= g_hex_neighbors_offsets[ x & 1 ];
+		for( unsigned int n= 0; n < 6; n++ )
+		{
+			const int neighbor_x= x + offsets[n][0];
+			const int neighbor_y= y + offsets[n][1];
 
-	if( l <= 1 ||
-		( ch->transparency_[addr] & H_FIRE_LIGHT_TRANSPARENCY_BIT ) == 0 )
-		return;
-	unsigned char l1= l-1;
-
-	//upper block
-	addr++;
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLight_r( x, y, z + 1, l1 );
-	//lower block
-	addr-= 2;
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLight_r( x, y, z - 1, l1 );
-	//forward block
-	y1= y + 1;
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLight_r( x, y1, z, l1 );
-	//back block
-	y1= y - 1;
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLight_r( x, y1, z, l1 );
-	//forwad right
-	x1= x+1;
-	y1= y +((x+1)&1);
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLight_r( x1, y1, z, l1 );
-	//back right
-	x1= x+1;
-	y1= y -(x&1);
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLight_r( x1, y1, z, l1 );
-	//forwad left
-	x1= x-1;
-	y1= y +((x+1)&1);
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLight_r( x1, y1, z, l1 );
-	//back left
-	x1= x-1;
-	y1= y -(x&1);
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLight_r( x1, y1, z, l1 );
+			h_Chunk* ch= entry.chunk;
+			int X= entry.X, Y= entry.Y;
+			if( neighbor_x < 0 || neighbor_y < 0 || neighbor_x >= H_CHUNK_WIDTH || neighbor_y >= H_CHUNK_WIDTH )
+			{
+				X+= neighbor_x < 0 ? -1 : ( neighbor_x >= H_CHUNK_WIDTH ? 1 : 0 );
+				Y+= neighbor_y < 0 ? -1 : ( neighbor_y >= H_CHUNK_WIDTH ? 1 : 0 );
+				if( X < 0 || Y < 0 || X >= int(chunk_number_x_) || Y >= int(chunk_number_y_) )
+					continue;
+				ch= GetChunk( X, Y );
+			}
+
+			func(
+				ch, X, Y,
+				BlockAddr( neighbor_x & ( H_CHUNK_WIDTH - 1 ), neighbor_y & ( H_CHUNK_WIDTH - 1 ), z ) );
+		}
+	}
 }
 
-void h_World::AddSunLightSafe_r( int x, int y, int z, unsigned char l )
+void h_World::SpreadLight( const bool sun )
 {
-	h_Chunk* ch;
-	int x1, y1, z1;
-	unsigned int addr;
+	RingBuffer<LightQueueEntry>& queue= sun ? sun_light_queue_ : fire_light_queue_;
+	const unsigned char transparency_bit= sun ? H_SECONDARY_SUN_LIGHT_TRANSPARENCY_BIT : H_FIRE_LIGHT_TRANSPARENCY_BIT;
 
-	addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y & ( H_CHUNK_WIDTH - 1 ), z );
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
-	ch->sun_light_map_[ addr ]= l;
+	while( !queue.empty() )
+	{
+		const LightQueueEntry entry= queue.pop_front();
 
-	if( l <= 1 ||
-		( ch->transparency_[addr] & H_SECONDARY_SUN_LIGHT_TRANSPARENCY_BIT ) == 0 )
-		return;
-	unsigned char l1= l-1;
-
-	//upper block
-	z1= z+1;
-	addr= BlockAddr(  x & ( H_CHUNK_WIDTH - 1 ), y & ( H_CHUNK_WIDTH - 1 ), z1 );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLightSafe_r( x, y, z1, l1 );
-	//lower block
-	z1= z-1;
-	addr= BlockAddr(  x & ( H_CHUNK_WIDTH - 1 ), y & ( H_CHUNK_WIDTH - 1 ), z1 );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLightSafe_r( x, y, z1, l1 );
-	//forward block
-	y1= ClampY(y + 1);
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLightSafe_r( x, y1, z, l1 );
-	//back block
-	y1= ClampY( y - 1 );
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLightSafe_r( x, y1, z, l1 );
-	//forwad right
-	x1= ClampX( x+1 );
-	y1= ClampY( y +((x+1)&1) );
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLightSafe_r( x1, y1, z, l1 );
-	//back right
-	x1= ClampX( x+1 );
-	y1= ClampY( y -(x&1) );
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLightSafe_r( x1, y1, z, l1 );
-	//forwad left
-	x1= ClampX( x-1 );
-	y1= ClampY( y +((x+1)&1) );
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLightSafe_r( x1, y1, z, l1 );
-	//back left
-	x1= ClampX( x-1 );
-	y1= ClampY( y -(x&1) );
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->sun_light_map_[addr] < l1 )
-		AddSunLightSafe_r( x1, y1, z, l1 );
+		// Cell was lit again with greater level after enqueuing. Skip it, it is in queue again.
+		if( entry.chunk->LightLevel( entry.addr, sun ) != entry.level )
+			continue;
+
+		const unsigned char l1= (unsigned char)( entry.level - 1 );
+		ForEachLightNeighbor(
+			entry,
+			[&queue, sun, transparency_bit, l1]( h_Chunk* const ch, const unsigned int X, const unsigned int Y, const unsigned int addr )
+			{
+				if( ch->LightLevel( addr, sun ) < l1 )
+				{
+					ch->SetLightLevel( addr, sun, l1 );
+					if( l1 > 1 && ( ch->transparency_[ addr ] & transparency_bit ) != 0 )
+						queue.push_back( LightQueueEntry{ ch, (unsigned short)addr, (unsigned char)X, (unsigned char)Y, l1 } );
+				}
+			} );
+	}
 }
 
-void h_World::AddFireLightSafe_r( int x, int y, int z, unsigned char l )
+int h_World::RemoveLight( const bool sun, const int x, const int y, const int z )
 {
-	h_Chunk* ch;
-	int x1, y1, z1;
-	unsigned int addr;
+	RingBuffer<LightQueueEntry>& queue= sun ? sun_light_queue_ : fire_light_queue_;
+	const unsigned char transparency_bit= sun ? H_SECONDARY_SUN_LIGHT_TRANSPARENCY_BIT : H_FIRE_LIGHT_TRANSPARENCY_BIT;
 
-	addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y & ( H_CHUNK_WIDTH - 1 ), z );
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y >> H_CHUNK_WIDTH_LOG2 );
-	ch->fire_light_map_[ addr ]= l;
+	const unsigned int start_X= x >> H_CHUNK_WIDTH_LOG2, start_Y= y >> H_CHUNK_WIDTH_LOG2;
+	h_Chunk* const start_ch= GetChunk( start_X, start_Y );
+	const unsigned int column_addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y & ( H_CHUNK_WIDTH - 1 ), 0 );
+	const unsigned int start_addr= column_addr + (unsigned int)z;
 
-	if( l <= 1 ||
-		( ch->transparency_[addr] & H_FIRE_LIGHT_TRANSPARENCY_BIT ) == 0 )
-		return;
-	unsigned char l1= l-1;
-
-	//upper block
-	z1= z+1;
-	addr= BlockAddr(  x & ( H_CHUNK_WIDTH - 1 ), y & ( H_CHUNK_WIDTH - 1 ), z1 );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLightSafe_r( x, y, z1, l1 );
-	//lower block
-	z1= z-1;
-	addr= BlockAddr(  x & ( H_CHUNK_WIDTH - 1 ), y & ( H_CHUNK_WIDTH - 1 ), z1 );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLightSafe_r( x, y, z1, l1 );
-	//forward block
-	y1= ClampY(y + 1);
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLightSafe_r( x, y1, z, l1 );
-	//back block
-	y1= ClampY( y - 1 );
-	ch= GetChunk( x >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLightSafe_r( x, y1, z, l1 );
-	//forwad right
-	x1= ClampX( x+1 );
-	y1= ClampY( y +((x+1)&1) );
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLightSafe_r( x1, y1, z, l1 );
-	//back right
-	x1= ClampX( x+1 );
-	y1= ClampY( y -(x&1) );
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLightSafe_r( x1, y1, z, l1 );
-	//forwad left
-	x1= ClampX( x-1 );
-	y1= ClampY( y +((x+1)&1) );
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->fire_light_map_[addr] < l1  )
-		AddFireLightSafe_r( x1, y1, z, l1 );
-	//back left
-	x1= ClampX( x-1 );
-	y1= ClampY( y -(x&1) );
-	ch= GetChunk( x1 >> H_CHUNK_WIDTH_LOG2, y1 >> H_CHUNK_WIDTH_LOG2 );
-	addr= BlockAddr( x1 & ( H_CHUNK_WIDTH - 1 ), y1 & ( H_CHUNK_WIDTH - 1 ), z );
-	if( ch->fire_light_map_[addr] < l1 )
-		AddFireLightSafe_r( x1, y1, z, l1 );
-}
+	int radius= 0;
 
-void h_World::ShineFireLight( int x_min, int y_min, int z_min, int x_max, int y_max, int z_max )
-{
-	(void)z_min;
-	(void)z_max;
+	// Set light of cell to zero and enqueue it for removal.
+	// Light sources keep own light level, they are enqueued for spreading too.
+	const auto unlight=
+	[this, sun, &queue, &radius, x, y]( h_Chunk* const ch, const unsigned int X, const unsigned int Y, const unsigned int addr )
+	{
+		light_removal_queue_.push_back( LightQueueEntry{ ch, (unsigned short)addr, (unsigned char)X, (unsigned char)Y, ch->LightLevel( addr, sun ) } );
+		ch->SetLightLevel( addr, sun, 0 );
+
+		const int cell_x= int( ( X << H_CHUNK_WIDTH_LOG2 ) + ( addr >> ( H_CHUNK_HEIGHT_LOG2 + H_CHUNK_WIDTH_LOG2 ) ) );
+		const int cell_y= int( ( Y << H_CHUNK_WIDTH_LOG2 ) + ( ( addr >> H_CHUNK_HEIGHT_LOG2 ) & ( H_CHUNK_WIDTH - 1 ) ) );
+		radius= std::max( radius, std::max( std::abs( cell_x - x ), std::abs( cell_y - y ) ) );
 
-	x_min>>= H_CHUNK_WIDTH_LOG2;
-	x_max>>= H_CHUNK_WIDTH_LOG2;
-	y_min>>= H_CHUNK_WIDTH_LOG2;
-	y_max>>= H_CHUNK_WIDTH_LOG2;
+		if( !sun )
+		{
+			const h_BlockType block_type= ch->GetBlockType( addr );
+			if( block_type == h_BlockType::FireStone || block_type == h_BlockType::Fire )
+			{
+				const unsigned char light= static_cast<const h_LightSource*>( ch->GetBlock( addr ) )->LightLevel();
+				ch->SetLightLevel( addr, false, light );
+				queue.push_back( LightQueueEntry{ ch, (unsigned short)addr, (unsigned char)X, (unsigned char)Y, light } );
+			}
+		}
+	};
 
-	int i, j;
-	for( i= x_min; i<= x_max; i++ )
-	for( j= y_min; j<= y_max; j++ )
+	// Direct sun light stops at first not transparent for direct light block.
+	// Cells below it with max light level were lit directly before, unlight them.
+	const int shaft_bottom_z= start_ch->height_map_[ column_addr >> H_CHUNK_HEIGHT_LOG2 ];
+	if( sun )
 	{
-		int X, Y;
-		X= i<< H_CHUNK_WIDTH_LOG2;
-		Y= j<< H_CHUNK_WIDTH_LOG2;
+		for( int k= shaft_bottom_z; k > 0 && start_ch->SunLightLevel( column_addr + k ) == H_MAX_SUN_LIGHT; k-- )
+			unlight( start_ch, start_X, start_Y, column_addr + k );
+	}
+
+	if( start_ch->LightLevel( start_addr, sun ) != 0 )
+		unlight( start_ch, start_X, start_Y, start_addr );
 
-		const std::vector< h_LightSource* >& light_sources= GetChunk( i, j )->GetLightSourceList();
-		for( const h_LightSource* source : light_sources )
-			AddFireLight_r( source->x_ + X, source->y_ + Y, source->z_, source->LightLevel() );
+	// Remove light, which was spread from unlit cells. Neighbors with greater or equal light level
+	// were lit from other cells, enqueue them for spreading light back into unlit area.
+	while( !light_removal_queue_.empty() )
+	{
+		const LightQueueEntry entry= light_removal_queue_.pop_front();
+
+		// Changed block itself may be opaque now, but it was transparent before.
+		const bool spreads_light=
+			( entry.chunk->transparency_[ entry.addr ] & transparency_bit ) != 0 ||
+			( entry.chunk == start_ch && entry.addr == start_addr );
+
+		ForEachLightNeighbor(
+			entry,
+			[&queue, &unlight, sun, transparency_bit, spreads_light, &entry]( h_Chunk* const ch, const unsigned int X, const unsigned int Y, const unsigned int addr )
+			{
+				const unsigned char light= ch->LightLevel( addr, sun );
+				if( light == 0 )
+					return;
+
+				if( spreads_light && light < entry.level )
+					unlight( ch, X, Y, addr );
+				else if( light > 1 && ( ch->transparency_[ addr ] & transparency_bit ) != 0 )
+					queue.push_back( LightQueueEntry{ ch, (unsigned short)addr, (unsigned char)X, (unsigned char)Y, light } );
+			} );
 	}
+
+	// Restore direct sun light in column of changed block.
+	if( sun )
+	{
+		for( int k= H_CHUNK_HEIGHT - 2; k > shaft_bottom_z; k-- )
+			EnqueueLight( true, x, y, k, H_MAX_SUN_LIGHT );
+	}
+
+	SpreadLight( sun );
+
+	return radius;
 }
 
 void h_World::AddLightToBorderChunk( unsigned int X, unsigned int Y )
@@ -677,69 +512,59 @@ void h_World::AddLightToBorderChunk( unsigned int X, unsigned int Y )
 	for( int i= 0; i< H_CHUNK_WIDTH; i++ )
 	for( int j= 0; j< H_CHUNK_WIDTH; j++ )
 	for( int k= 1; k< H_CHUNK_HEIGHT-1; k++ )
-		AddSunLightSafe_r( x+i, y+j, k, ch->SunLightLevel( i, j, k ) );
+		EnqueueLight( true, x+i, y+j, k, ch->SunLightLevel( i, j, k ) );
+	SpreadLight( true );
 
 	//add fire lights to border chunk
-	const std::vector< h_LightSource* >& light_sources= ch->GetLightSourceList();
-	for( const h_LightSource* source : light_sources )
-		AddFireLightSafe_r( source->x_ + x, source->y_ + y, source->z_, source->LightLevel() );
+	for( const unsigned short addr : ch->GetLightSourceList() )
+	{
+		const h_LightSource* source= ch->GetLightSource( addr );
+		EnqueueLight( false, source->x_ + x, source->y_ + y, source->z_, source->LightLevel() );
+	}
+	SpreadLight( false );
 }
 
 void h_World::RelightWaterModifedChunksLight()
 {
-	const unsigned int c_inv_desiret_chunk_update_chance = 2;
-
-	unsigned int chunk_count= 0;
-	h_Chunk* ch;
-
-	for( unsigned int i= 1; i< ChunkNumberX()-1; i++ )
-	for( unsigned int j= 1; j< ChunkNumberY()-1; j++ )
-	{
-		ch= GetChunk( i, j );
-		if( ch->need_update_light_ )
-			chunk_count++;
-	}
-
-	for( unsigned int i= 1; i< ChunkNumberX()-1; i++ )
-	for( unsigned int j= 1; j< ChunkNumberY()-1; j++ )
+	// Water blocks only direct sun light, so, only direct sun light in columns of changed blocks may change.
+	for( unsigned int i= 0; i< ChunkNumberX(); i++ )
+	for( unsigned int j= 0; j< ChunkNumberY(); j++ )
 	{
-		ch= GetChunk( i, j );
-		if( ch->need_update_light_ )
+		h_Chunk* ch= GetChunk( i, j );
+		for( const unsigned short addr : ch->water_light_updates_ )
 		{
-			// Chance of one chunk water updating per one phys tick.
-			if( phys_processes_rand_.Rand() <=
-				phys_processes_rand_.max_rand / ( chunk_count * c_inv_desiret_chunk_update_chance ) )
+			const int x= int( ( i << H_CHUNK_WIDTH_LOG2 ) + ( addr >> ( H_CHUNK_HEIGHT_LOG2 + H_CHUNK_WIDTH_LOG2 ) ) );
+			const int y= int( ( j << H_CHUNK_WIDTH_LOG2 ) + ( ( addr >> H_CHUNK_HEIGHT_LOG2 ) & ( H_CHUNK_WIDTH - 1 ) ) );
+			const int z= int( addr & ( H_CHUNK_HEIGHT - 1 ) );
+
+			int radius;
+			if( ( ch->transparency_[ addr ] & H_DIRECT_SUN_LIGHT_TRANSPARENCY_BIT ) == 0 )
 			{
-				int X= i<<H_CHUNK_WIDTH_LOG2;
-				int Y= j<<H_CHUNK_WIDTH_LOG2;
-				ch->SunRelight();//zero light in chunk and add vertical sun light
-				for( int x= 0; x< H_CHUNK_WIDTH; x++ )
-				for( int y=0; y< H_CHUNK_WIDTH; y++ )
-				for( int z= 1; z< H_CHUNK_HEIGHT-1; z++ )
-					AddSunLight_r( X+x, Y+y, z, SunLightLevel( X+x, Y+y, z) );
-
-				for( int x= 0; x< H_CHUNK_WIDTH; x++ )
-				for( int z= 1; z< H_CHUNK_HEIGHT-1; z++ )
-				{
-					AddSunLight_r( X+x, Y-1, z, SunLightLevel( X+x, Y-1, z) );
-					AddSunLight_r( X+x, Y+H_CHUNK_WIDTH, z, SunLightLevel( X+x, Y+H_CHUNK_WIDTH, z) );
-				}
+				// Only direct sun light has max level. Remove it, if block now is not transparent for it.
+				if( ch->SunLightLevel( addr ) != H_MAX_SUN_LIGHT )
+					continue;
+				radius= RemoveLight( true, x, y, z );
+			}
+			else
+			{
+				if( ch->SunLightLevel( addr ) == H_MAX_SUN_LIGHT )
+					continue;
 
-				for( int y= 0; y< H_CHUNK_WIDTH; y++ )
-				for( int z= 1; z< H_CHUNK_HEIGHT-1; z++ )
-				{
-					AddSunLight_r( X-1, Y+y, z, SunLightLevel( X-1, Y+y, z) );
-					AddSunLight_r( X+H_CHUNK_WIDTH, Y+y, z, SunLightLevel( X+H_CHUNK_WIDTH, Y+y, z) );
-				}
-				ch->need_update_light_= false;
-
-				renderer_->UpdateChunk( i, j );
-				renderer_->UpdateChunk( i+1, j+1 );
-				renderer_->UpdateChunk( i+1, j-1 );
-				renderer_->UpdateChunk( i-1, j+1 );
-				renderer_->UpdateChunk( i-1, j-1 );
-				renderer_->UpdateChunkWater( i, j );
-			}//if rand
-		}//if need update light
-	} // for ij
+				const int height= ch->height_map_[ addr >> H_CHUNK_HEIGHT_LOG2 ];
+				if( z < height )
+					continue; // Block is in shadow.
+
+				for( int k= z; k > height; k-- )
+					EnqueueLight( true, x, y, k, H_MAX_SUN_LIGHT );
+				SpreadLight( true );
+
+				radius= H_MAX_SUN_LIGHT - 1;
+			}
+
+			// Vertex light depends on light of neighbor blocks, so, update meshes in greater radius.
+			UpdateInRadius( x, y, radius + 1 );
+			UpdateWaterInRadius( x, y, radius + 1 );
+		}
+		ch->water_light_updates_.clear();
+	}
 }
@@ -3,8 +3,8 @@
 #include "hex.hpp"
 #include "math_lib/binary_stream.hpp"
 
-#define H_CHUNK_FORMAT_VERSION 1
-#define H_REGION_FORMAT_VERSION 1
+#define H_CHUNK_FORMAT_VERSION 2
+#define H_REGION_FORMAT_VERSION 3
 #define H_WORLD_FORMAT_VERSION 1
 
 #define H_CHUNK_FORMAT_HEADER	"HEXchunk"
@@ -39,8 +39,17 @@ struct HEXCHUNK_header
 	void Write( h_BinaryOuptutStream& stream ) const;
 };
 
+// Region file layout: header, then chunks data. Chunks data placed in any order, with holes.
+// Each lump contains uint32_t crc32 of chunk data, then chunk data.
+// Version 2 files have no checksums.
+// Version 1 files have uninitialized header fields (except coordinates and lumps sizes) and chunks data placed sequentially.
 struct HEXREGION_header
 {
+	// Size of header in file.
+	static constexpr const unsigned int c_serialized_size=
+		8 * sizeof(signed char) + 2 * sizeof(int) + 2 * sizeof(short) +
+		H_WORLD_REGION_SIZE_X * H_WORLD_REGION_SIZE_Y * 2 * sizeof(int);
+
 	signed char format_key[8];
 	int version;
 	int datalen;
@@ -50,6 +59,7 @@ struct HEXREGION_header
 	short latitude ;
 
 	//if lump.size is zero, chunk does not exist
+	//lump.offset - from end of header
 	FileLump chunk_lumps[ H_WORLD_REGION_SIZE_X * H_WORLD_REGION_SIZE_Y ];
 
 	//if struct changed, this must be changed too
@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <chrono>
+
+#include "world.hpp"
+#include "block_collision.hpp"
+#include "console.hpp"
+#include "parallel_for.hpp"
+
+// Leave cores for ui and world threads.
+static unsigned int GetStreamingThreadCount()
+{
+	const unsigned int c_max_threads= 4;
+
+	unsigned int hardware_threads= std::thread::hardware_concurrency();
+	if( hardware_threads <= 3 )
+		return 1;
+	return std::min( hardware_threads - 2, c_max_threads );
+}
+
+void h_World::StartChunksStreaming()
+{
+	H_ASSERT( streaming_threads_.empty() );
+
+	streaming_need_stop_= false;
+
+	unsigned int thread_count= GetStreamingThreadCount();
+	for( unsigned int i= 0; i < thread_count; i++ )
+		streaming_threads_.emplace_back( &h_World::ChunksStreamingThreadFunc, this );
+
+	h_Console::Info( "Chunks streaming started with ", thread_count, " threads" );
+}
+
+void h_World::StopChunksStreaming()
+{
+	{
+		std::lock_guard<std::mutex> lock( streaming_mutex_ );
+
+		// Not started loadings are not needed anymore. Saving jobs must be finished.
+		streaming_chunks_.erase(
+			std::remove_if(
+				streaming_chunks_.begin(), streaming_chunks_.end(),
+				[]( const StreamingChunk& c ) { return c.state == StreamingChunk::State::LoadQueued; } ),
+			streaming_chunks_.end() );
+
+		// Last chance for failed savings.
+		for( StreamingChunk& c : streaming_chunks_ )
+			if( c.state == StreamingChunk::State::SaveFailed )
+				c.state= StreamingChunk::State::SaveQueued;
+
+		streaming_need_stop_= true;
+	}
+	streaming_jobs_condition_.notify_all();
+
+	for( std::thread& thread : streaming_threads_ )
+		thread.join();
+	streaming_threads_.clear();
+
+	// Only prefetched chunks and chunks, which saving failed again, remain here.
+	// Prefetched chunks are not modified, so, just drop them. Failed chunks can not be saved anymore.
+	for( const StreamingChunk& c : streaming_chunks_ )
+	{
+		H_ASSERT( c.state == StreamingChunk::State::Loaded || c.state == StreamingChunk::State::SaveFailed );
+		if( c.state == StreamingChunk::State::SaveFailed )
+			h_Console::Error( "Can not save chunk ", c.longitude, " ", c.latitude, ". Chunk changes are lost." );
+
+		{
+			std::lock_guard<std::mutex> lock( chunk_loader_mutex_ );
+			chunk_loader_.FreeChunkData( c.longitude, c.latitude );
+		}
+		chunk_pool_.Delete( c.chunk );
+	}
+	streaming_chunks_.clear();
+}
+
+void h_World::ChunksStreamingThreadFunc()
+{
+	ChunkDataBuffers buffers;
+
+	std::unique_lock<std::mutex> lock( streaming_mutex_ );
+	while(true)
+	{
+		auto it=
+			std::find_if(
+				streaming_chunks_.begin(), streaming_chunks_.end(),
+				[]( const StreamingChunk& c )
+				{
+					return
+						c.state == StreamingChunk::State::LoadQueued ||
+						c.state == StreamingChunk::State::SaveQueued;
+				} );
+
+		if( it == streaming_chunks_.end() )
+		{
+			// Stop only when all jobs are done.
+			if( streaming_need_stop_ )
+				break;
+			streaming_jobs_condition_.wait( lock );
+			continue;
+		}
+
+		const int longitude= it->longitude;
+		const int latitude = it->latitude ;
+
+		if( it->state == StreamingChunk::State::LoadQueued )
+		{
+			it->state= StreamingChunk::State::Loading;
+			lock.unlock();
+
+			h_Chunk* ch= LoadChunk( longitude, latitude, buffers );
+
+			lock.lock();
+			for( StreamingChunk& c : streaming_chunks_ )
+				if( c.longitude == longitude && c.latitude == latitude )
+				{
+					H_ASSERT( c.state == StreamingChunk::State::Loading );
+					c.state= StreamingChunk::State::Loaded;
+					c.chunk= ch;
+					break;
+				}
+		}
+		else
+		{
+			h_Chunk* ch= it->chunk;
+			it->state= StreamingChunk::State::Saving;
+			lock.unlock();
+
+			const bool saved= SaveChunk( ch, buffers );
+			if( saved )
+			{
+				{
+					std::lock_guard<std::mutex> loader_lock( chunk_loader_mutex_ );
+					chunk_loader_.FreeChunkData( longitude, latitude );
+				}
+				chunk_pool_.Delete( ch );
+			}
+
+			lock.lock();
+			const auto saved_it=
+				std::find_if(
+					streaming_chunks_.begin(), streaming_chunks_.end(),
+					[longitude, latitude]( const StreamingChunk& c )
+					{
+						return c.longitude == longitude && c.latitude == latitude;
+					} );
+			H_ASSERT( saved_it->state == StreamingChunk::State::Saving );
+
+			// Keep modified chunk in memory. It can be taken back by world or saved later.
+			if( saved )
+				streaming_chunks_.erase( saved_it );
+			else
+				saved_it->state= StreamingChunk::State::SaveFailed;
+		}
+
+		streaming_chunk_ready_condition_.notify_all();
+	}
+}
+
+void h_World::PrefetchChunks( const m_Vec3& player_pos )
+{
+	int player_coord_global[2];
+	pGetHexogonCoord( player_pos.xy(), &player_coord_global[0], &player_coord_global[1] );
+
+	int player_chunk_x= ( player_coord_global[0] - Longitude() * H_CHUNK_WIDTH + (H_CHUNK_WIDTH>>1) ) >> H_CHUNK_WIDTH_LOG2;
+	int player_chunk_y= ( player_coord_global[1] - Latitude () * H_CHUNK_WIDTH + (H_CHUNK_WIDTH>>1) ) >> H_CHUNK_WIDTH_LOG2;
+
+	// Same thresholds, as in world moving, but one chunk earlier.
+	if( player_chunk_y >= int(chunk_number_y_/2+2) )
+		for( unsigned int i= 0; i < chunk_number_x_; i++ )
+			PrefetchChunk( longitude_ + int(i), latitude_ + int(chunk_number_y_) );
+	else if( player_chunk_y <= int(chunk_number_y_/2-2) )
+		for( unsigned int i= 0; i < chunk_number_x_; i++ )
+			PrefetchChunk( longitude_ + int(i), latitude_ - 1 );
+
+	if( player_chunk_x >= int(chunk_number_x_/2+2) )
+		for( unsigned int j= 0; j < chunk_number_y_; j++ )
+			PrefetchChunk( longitude_ + int(chunk_number_x_), latitude_ + int(j) );
+	else if( player_chunk_x <= int(chunk_number_x_/2-2) )
+		for( unsigned int j= 0; j < chunk_number_y_; j++ )
+			PrefetchChunk( longitude_ - 1, latitude_ + int(j) );
+}
+
+void h_World::PrefetchChunk( int longitude, int latitude )
+{
+	std::lock_guard<std::mutex> lock( streaming_mutex_ );
+
+	for( const StreamingChunk& c : streaming_chunks_ )
+		if( c.longitude == longitude && c.latitude == latitude )
+			return;
+
+	StreamingChunk c;
+	c.state= StreamingChunk::State::LoadQueued;
+	c.longitude= longitude;
+	c.latitude = latitude ;
+	c.chunk= nullptr;
+	streaming_chunks_.push_back(c);
+
+	streaming_jobs_condition_.notify_one();
+}
+
+void h_World::DropUnneededPrefetchedChunks()
+{
+	std::vector<StreamingChunk> dropped_chunks;
+	{
+		std::lock_guard<std::mutex> lock( streaming_mutex_ );
+
+		const int lon_min= longitude_ - 1, lon_max= longitude_ + int(chunk_number_x_);
+		const int lat_min= latitude_  - 1, lat_max= latitude_  + int(chunk_number_y_);
+
+		for( unsigned int i= 0; i < streaming_chunks_.size(); )
+		{
+			const StreamingChunk& c= streaming_chunks_[i];
+			if(
+				( c.state == StreamingChunk::State::LoadQueued || c.state == StreamingChunk::State::Loaded ) &&
+				( c.longitude < lon_min || c.longitude > lon_max || c.latitude < lat_min || c.latitude > lat_max ) )
+			{
+				if( c.state == StreamingChunk::State::Loaded )
+					dropped_chunks.push_back(c);
+				streaming_chunks_.erase( streaming_chunks_.begin() + i );
+			}
+			else
+				i++;
+		}
+	}
+
+	// Prefetched chunks are not modified, so, we can just delete them.
+	for( const StreamingChunk& c : dropped_chunks )
+	{
+		{
+			std::lock_guard<std::mutex> lock( chunk_loader_mutex_ );
+			chunk_loader_.FreeChunkData( c.longitude, c.latitude );
+		}
+		chunk_pool_.Delete( c.chunk );
+	}
+}
+
+h_Chunk* h_World::AcquireChunk( int longitude, int latitude )
+{
+	const auto start_time= std::chrono::steady_clock::now();
+	const auto add_blocked_time=
+	[this, start_time]
+	{
+		chunks_loading_blocked_time_us_+=
+			std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start_time ).count();
+	};
+
+	std::unique_lock<std::mutex> lock( streaming_mutex_ );
+
+	bool waited= false;
+	while(true)
+	{
+		auto it=
+			std::find_if(
+				streaming_chunks_.begin(), streaming_chunks_.end(),
+				[longitude, latitude]( const StreamingChunk& c )
+				{
+					return c.longitude == longitude && c.latitude == latitude;
+				} );
+
+		if( it == streaming_chunks_.end() )
+			break;
+
+		if( it->state == StreamingChunk::State::Loaded ||
+			it->state == StreamingChunk::State::SaveQueued ||
+			it->state == StreamingChunk::State::SaveFailed )
+		{
+			// Chunk is ready, or it was removed from matrix recently and not saved yet - take it back.
+			h_Chunk* ch= it->chunk;
+			streaming_chunks_.erase(it);
+			if( waited )
+				add_blocked_time();
+			return ch;
+		}
+		if( it->state == StreamingChunk::State::LoadQueued )
+		{
+			// Do not wait for queue, load chunk right now.
+			streaming_chunks_.erase(it);
+			break;
+		}
+
+		// Loading or saving in progress - wait for it.
+		waited= true;
+		streaming_chunk_ready_condition_.wait( lock );
+	}
+	lock.unlock();
+
+	h_Chunk* ch= LoadChunk( longitude, latitude, chunk_data_buffers_ );
+	add_blocked_time();
+	return ch;
+}
+
+void h_World::ReleaseChunk( h_Chunk* ch )
+{
+	StreamingChunk c;
+	c.state= StreamingChunk::State::SaveQueued;
+	c.longitude= ch->Longitude();
+	c.latitude = ch->Latitude ();
+	c.chunk= ch;
+
+	{
+		std::lock_guard<std::mutex> lock( streaming_mutex_ );
+		streaming_chunks_.push_back(c);
+	}
+	streaming_jobs_condition_.notify_one();
+}
+
+void h_World::WaitForChunksSaving()
+{
+	std::unique_lock<std::mutex> lock( streaming_mutex_ );
+
+	bool has_failed_chunks= false;
+	for( StreamingChunk& c : streaming_chunks_ )
+		if( c.state == StreamingChunk::State::SaveFailed )
+		{
+			c.state= StreamingChunk::State::SaveQueued;
+			has_failed_chunks= true;
+		}
+	if( has_failed_chunks )
+		streaming_jobs_condition_.notify_all();
+
+	streaming_chunk_ready_condition_.wait(
+		lock,
+		[this]
+		{
+			for( const StreamingChunk& c : streaming_chunks_ )
+				if( c.state == StreamingChunk::State::SaveQueued || c.state == StreamingChunk::State::Saving )
+					return false;
+			return true;
+		} );
+}
+
+unsigned int h_World::PregenerateChunks( int longitude_min, int latitude_min, int longitude_max, int latitude_max )
+{
+	H_ASSERT( !phys_thread_ );
+
+	if( longitude_max < longitude_min || latitude_max < latitude_min )
+		return 0;
+
+	const unsigned int size_x= (unsigned int)( longitude_max - longitude_min + 1 );
+	const unsigned int size_y= (unsigned int)( latitude_max  - latitude_min  + 1 );
+	const unsigned int chunk_count= size_x * size_y;
+
+	std::atomic<unsigned int> generated_chunks{ 0 };
+	std::vector<ChunkDataBuffers> threads_buffers( hParallelForThreadCount( chunk_count ) );
+
+	hParallelFor(
+		chunk_count,
+		[&]( const unsigned int i, const unsigned int thread_index )
+		{
+			// Go along latitude first - neighbor chunks are usually placed in same region.
+			const int longitude= longitude_min + int( i / size_y );
+			const int latitude = latitude_min  + int( i % size_y );
+
+			// Chunks of chunks matrix are owned by world.
+			if( longitude >= longitude_ && longitude < longitude_ + int(chunk_number_x_) &&
+				latitude  >= latitude_  && latitude  < latitude_  + int(chunk_number_y_) )
+				return;
+
+			bool chunk_exists;
+			{
+				std::lock_guard<std::mutex> lock( chunk_loader_mutex_ );
+				chunk_exists= chunk_loader_.GetChunkData( longitude, latitude ).size > 0;
+				if( chunk_exists )
+					chunk_loader_.FreeChunkData( longitude, latitude );
+			}
+			if( chunk_exists )
+				return;
+
+			// Chunk is not modified by anyone, so, if saving fails, it is just generated again later.
+			h_Chunk* ch= chunk_pool_.New( this, longitude, latitude, world_generator_.get() );
+			const bool saved= SaveChunk( ch, threads_buffers[ thread_index ] );
+			{
+				std::lock_guard<std::mutex> lock( chunk_loader_mutex_ );
+				chunk_loader_.FreeChunkData( longitude, latitude );
+			}
+			chunk_pool_.Delete( ch );
+
+			if( saved )
+				generated_chunks++;
+		} );
+
+	std::lock_guard<std::mutex> lock( chunk_loader_mutex_ );
+	chunk_loader_.ForceSaveAllChunks();
+
+	return generated_chunks.load();
+}